@@ -0,0 +1,736 @@
+// basicfloat.cpp - C64 BASIC floating point routines run natively
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "basicfloat.h"
+
+#include <string.h>
+
+// entry points, with their first bytes in BASIC V2
+static const struct
+{
+	ushort addr;
+	BasicFloat::Routine routine;
+	const char* name;
+	byte code[4];
+} entries[] =
+{
+	{ 0xB850, BasicFloat::FSUB, "FSUB", { 0x20, 0x8C, 0xBA, 0xA5 } },
+	{ 0xB853, BasicFloat::FSUBT, "FSUBT", { 0xA5, 0x66, 0x49, 0xFF } },
+	{ 0xB867, BasicFloat::FADD, "FADD", { 0x20, 0x8C, 0xBA, 0xD0 } },
+	{ 0xB86A, BasicFloat::FADDT, "FADDT", { 0xD0, 0x03, 0x4C, 0xFC } },
+	{ 0xBA28, BasicFloat::FMULT, "FMULT", { 0x20, 0x8C, 0xBA, 0xD0 } },
+	{ 0xBA2B, BasicFloat::FMULTT, "FMULTT", { 0xD0, 0x03, 0x4C, 0x8B } },
+	{ 0xBB0F, BasicFloat::FDIV, "FDIV", { 0x20, 0x8C, 0xBA, 0xF0 } },
+	{ 0xBB12, BasicFloat::FDIVT, "FDIVT", { 0xF0, 0x76, 0x20, 0x1B } },
+	{ 0xBCCC, BasicFloat::INT, "INT", { 0xA5, 0x61, 0xC9, 0xA0 } },
+};
+static const int entry_count = sizeof(entries) / sizeof(entries[0]);
+static const ushort basic_addr = 0xA000;
+
+// INTEGR, INDEX, RESHO-RESLO and the quotient guard byte, OLDOV, BITS, FAC1, ARG, ARISGN, FACOV
+const byte BasicFloat::used[] = { 0x07, 0x22, 0x23, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x56,
+	0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70 };
+
+BasicFloat::BasicFloat(Emu6502* emu)
+	: emu(emu)
+{
+	a = x = y = 0;
+	n = v = z = c = b = false;
+	pushed_n = pushed_v = pushed_z = pushed_c = false;
+}
+
+bool BasicFloat::IsBasicV2(const byte* basic_rom)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (memcmp(&basic_rom[entries[i].addr - basic_addr], entries[i].code, sizeof(entries[i].code)) != 0)
+			return false;
+	return true;
+}
+
+int BasicFloat::Find(ushort addr)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (entries[i].addr == addr)
+			return entries[i].routine;
+	return -1;
+}
+
+const char* BasicFloat::GetName(int routine)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (entries[i].routine == routine)
+			return entries[i].name;
+	return "?";
+}
+
+bool BasicFloat::IsUsed(ushort addr)
+{
+	for (size_t i = 0; i < sizeof(used); ++i)
+		if (used[i] == addr)
+			return true;
+	return false;
+}
+
+bool BasicFloat::Run(Routine routine, byte A, byte X, byte Y, byte P)
+{
+	if (P & 0x08)
+		return false; // decimal mode
+
+	a = A;
+	x = X;
+	y = Y;
+	n = (P & 0x80) != 0;
+	v = (P & 0x40) != 0;
+	z = (P & 0x02) != 0;
+	c = (P & 0x01) != 0;
+	b = (P & 0x10) != 0;
+	for (size_t i = 0; i < sizeof(used); ++i)
+		zp[used[i]] = zp_before[used[i]] = emu->GetMemory(used[i]);
+
+	bool ok = false;
+	switch (routine)
+	{
+	case FSUB: Conupk(); ok = Fsubt(); break;
+	case FSUBT: ok = Fsubt(); break;
+	case FADD: Conupk(); ok = Faddt(); break;
+	case FADDT: ok = Faddt(); break;
+	case FMULT: Conupk(); ok = Fmultt(); break;
+	case FMULTT: ok = Fmultt(); break;
+	case FDIV: Conupk(); ok = Fdivt(); break;
+	case FDIVT: ok = Fdivt(); break;
+	case INT: ok = Int(); break;
+	}
+	return ok; // if not, ROM raises the error
+}
+
+void BasicFloat::Store(byte& A, byte& X, byte& Y, byte& P)
+{
+	for (size_t i = 0; i < sizeof(used); ++i)
+		if (zp[used[i]] != zp_before[used[i]])
+			emu->SetMemory(used[i], zp[used[i]]);
+	A = a;
+	X = x;
+	Y = y;
+	P = (byte)((P & 0x2C) | (n ? 0x80 : 0) | (v ? 0x40 : 0) | (b ? 0x10 : 0) | (z ? 0x02 : 0) | (c ? 0x01 : 0));
+}
+
+// CONUPK $BA8C: ARG from packed float at A/Y, ARISGN, returns with A = FACEXP
+void BasicFloat::Conupk()
+{
+	M(0x22) = a;
+	M(0x23) = y;
+	ushort index = (ushort)(M(0x22) | (M(0x23) << 8));
+	y = 4;
+	M(0x6D) = a = Ld(Read((ushort)(index + y)));
+	y = Ld((byte)(y - 1));
+	M(0x6C) = a = Ld(Read((ushort)(index + y)));
+	y = Ld((byte)(y - 1));
+	M(0x6B) = a = Ld(Read((ushort)(index + y)));
+	y = Ld((byte)(y - 1));
+	M(0x6E) = a = Ld(Read((ushort)(index + y)));
+	M(0x6F) = a = Ld(a ^ M(0x66));
+	a = Ld(M(0x6E));
+	M(0x6A) = a = Ld(a | 0x80);
+	y = Ld((byte)(y - 1));
+	M(0x69) = a = Ld(Read((ushort)(index + y)));
+	a = Ld(M(0x61));
+}
+
+// FSUBT $B853: FAC = ARG - FAC
+bool BasicFloat::Fsubt()
+{
+	M(0x66) = a = Ld(M(0x66) ^ 0xFF);
+	M(0x6F) = a = Ld(a ^ M(0x6E));
+	a = Ld(M(0x61));
+	return Faddt();
+}
+
+// FADDT $B86A: FAC = ARG + FAC, Z from FACEXP
+bool BasicFloat::Faddt()
+{
+	if (z)
+	{
+		Movfa();
+		return true;
+	}
+	M(0x56) = x = Ld(M(0x70));
+	x = Ld(0x69);
+	a = Ld(M(0x69));
+
+	// FADD1: align the operand with the smaller exponent
+	y = Ld(a);
+	if (z)
+		return true;
+	c = true;
+	Sbc(M(0x61));
+	if (!z)
+	{
+		if (c)
+		{
+			M(0x61) = y;
+			M(0x66) = y = Ld(M(0x6E));
+			a = Ld(a ^ 0xFF);
+			Adc(0x00);
+			M(0x56) = y = Ld(0x00);
+			x = Ld(0x61);
+		}
+		else
+			M(0x70) = y = Ld(0x00);
+
+		// FADD3
+		Cmp(a, 0xF9);
+		if (n)
+			Shift(SHIFTR); // FADD5, returns carry clear
+		else
+		{
+			y = Ld(a);
+			a = Ld(M(0x70));
+			M(x + 1) = Lsr(M(x + 1));
+			Shift(ROLSHF);
+		}
+	}
+
+	// FADD4
+	Bit(M(0x6F));
+	if (!n)
+	{
+		// FADD2: signs the same, add mantissas
+		Adc(M(0x56));
+		M(0x70) = a;
+		a = Ld(M(0x65));
+		Adc(M(0x6D));
+		M(0x65) = a;
+		a = Ld(M(0x64));
+		Adc(M(0x6C));
+		M(0x64) = a;
+		a = Ld(M(0x63));
+		Adc(M(0x6B));
+		M(0x63) = a;
+		a = Ld(M(0x62));
+		Adc(M(0x6A));
+		M(0x62) = a;
+		return Squeez();
+	}
+	y = Ld(0x61);
+	Cmp(x, 0x69);
+	if (!z)
+		y = Ld(0x69);
+
+	// SUBIT: subtract the shifted mantissa from the other
+	c = true;
+	a = Ld(a ^ 0xFF);
+	Adc(M(0x56));
+	M(0x70) = a;
+	a = Ld(M(y + 4));
+	Sbc(M(x + 4));
+	M(0x65) = a;
+	a = Ld(M(y + 3));
+	Sbc(M(x + 3));
+	M(0x64) = a;
+	a = Ld(M(y + 2));
+	Sbc(M(x + 2));
+	M(0x63) = a;
+	a = Ld(M(y + 1));
+	Sbc(M(x + 1));
+	M(0x62) = a;
+	return Fadflt();
+}
+
+// FADFLT $B8D2: negate if carry clear, then normalize
+bool BasicFloat::Fadflt()
+{
+	if (!c)
+		Negfac();
+	return Normal();
+}
+
+// NORMAL $B8D7: shift FAC mantissa left until its top bit is set
+bool BasicFloat::Normal()
+{
+	y = Ld(0x00);
+	a = Ld(y);
+	c = false;
+	while (true)
+	{
+		x = Ld(M(0x62));
+		if (!z)
+			break;
+		M(0x62) = x = Ld(M(0x63));
+		M(0x63) = x = Ld(M(0x64));
+		M(0x64) = x = Ld(M(0x65));
+		M(0x65) = x = Ld(M(0x70));
+		M(0x70) = y;
+		Adc(0x08);
+		Cmp(a, 0x20);
+		if (z)
+		{
+			Zerofc();
+			return true;
+		}
+	}
+
+	// NORM1, NORM2
+	while (!n)
+	{
+		Adc(0x01);
+		M(0x70) = Asl(M(0x70));
+		M(0x65) = Rol(M(0x65));
+		M(0x64) = Rol(M(0x64));
+		M(0x63) = Rol(M(0x63));
+		M(0x62) = Rol(M(0x62));
+	}
+	c = true;
+	Sbc(M(0x61));
+	if (c)
+	{
+		Zerofc();
+		return true;
+	}
+	a = Ld(a ^ 0xFF);
+	Adc(0x01);
+	M(0x61) = a;
+	return Squeez();
+}
+
+// ZEROFC $B8F7
+void BasicFloat::Zerofc()
+{
+	a = Ld(0x00);
+	M(0x61) = a;
+	M(0x66) = a;
+}
+
+// SQUEEZ $B936: shift right for carry out of the mantissa
+bool BasicFloat::Squeez()
+{
+	if (!c)
+		return true;
+	return Rndshf();
+}
+
+// RNDSHF $B938, false for OVERFLOW
+bool BasicFloat::Rndshf()
+{
+	M(0x61) = Inc(M(0x61));
+	if (z)
+		return false;
+	M(0x62) = Ror(M(0x62));
+	M(0x63) = Ror(M(0x63));
+	M(0x64) = Ror(M(0x64));
+	M(0x65) = Ror(M(0x65));
+	M(0x70) = Ror(M(0x70));
+	return true;
+}
+
+// NEGFAC $B947
+void BasicFloat::Negfac()
+{
+	M(0x66) = a = Ld(M(0x66) ^ 0xFF);
+	Negfch();
+}
+
+// NEGFCH $B94D: two's complement of mantissa and FACOV
+void BasicFloat::Negfch()
+{
+	M(0x62) = a = Ld(M(0x62) ^ 0xFF);
+	M(0x63) = a = Ld(M(0x63) ^ 0xFF);
+	M(0x64) = a = Ld(M(0x64) ^ 0xFF);
+	M(0x65) = a = Ld(M(0x65) ^ 0xFF);
+	M(0x70) = a = Ld(M(0x70) ^ 0xFF);
+	M(0x70) = Inc(M(0x70));
+	if (!z)
+		return;
+	Incfac();
+}
+
+// INCFAC $B96F
+void BasicFloat::Incfac()
+{
+	M(0x65) = Inc(M(0x65));
+	if (!z)
+		return;
+	M(0x64) = Inc(M(0x64));
+	if (!z)
+		return;
+	M(0x63) = Inc(M(0x63));
+	if (!z)
+		return;
+	M(0x62) = Inc(M(0x62));
+}
+
+// SHIFTR $B999: shift mantissa at X+1 right -A bits, whole bytes through FACOV, A the bits
+// shifted out; SHFTR4 $B985 (MULSHF $B983 sets X) a byte first; ROLSHF $B9B0 enters the bit loop
+void BasicFloat::Shift(ShiftEntry entry)
+{
+	if (entry == SHFTR4)
+		goto shftr4;
+	if (entry == ROLSHF)
+		goto rolshf;
+
+shiftr:
+	Adc(0x08);
+	if (n || z)
+		goto shftr4;
+	Sbc(0x08);
+	y = Ld(a);
+	a = Ld(M(0x70));
+	if (c)
+		goto shftrt;
+
+shftr2:
+	M(x + 1) = Asl(M(x + 1));
+	if (c)
+		M(x + 1) = Inc(M(x + 1));
+	M(x + 1) = Ror(M(x + 1));
+	M(x + 1) = Ror(M(x + 1));
+
+rolshf:
+	M(x + 2) = Ror(M(x + 2));
+	M(x + 3) = Ror(M(x + 3));
+	M(x + 4) = Ror(M(x + 4));
+	a = Ror(a);
+	y = Ld((byte)(y + 1));
+	if (!z)
+		goto shftr2;
+
+shftrt:
+	c = false;
+	return;
+
+shftr4:
+	M(0x70) = y = Ld(M(x + 4));
+	M(x + 4) = y = Ld(M(x + 3));
+	M(x + 3) = y = Ld(M(x + 2));
+	M(x + 2) = y = Ld(M(x + 1));
+	M(x + 1) = y = Ld(M(0x68));
+	goto shiftr;
+}
+
+// FMULTT $BA2B: FAC = ARG * FAC, Z from FACEXP
+bool BasicFloat::Fmultt()
+{
+	if (z)
+		return true;
+	MuldivResult result = Muldiv();
+	if (result == MuldivOverflow)
+		return false;
+	if (result == MuldivZero)
+		return true;
+	a = Ld(0x00);
+	M(0x26) = M(0x27) = M(0x28) = M(0x29) = a;
+	a = Ld(M(0x70));
+	Mltply(false);
+	a = Ld(M(0x65));
+	Mltply(false);
+	a = Ld(M(0x64));
+	Mltply(false);
+	a = Ld(M(0x63));
+	Mltply(false);
+	a = Ld(M(0x62));
+	Mltply(true);
+	return Movfr();
+}
+
+// MLTPLY $BA59: add ARG into RESHO for each bit of A, shifting right; MLTPL1 $BA5E if nonzero
+void BasicFloat::Mltply(bool nonzero)
+{
+	if (!nonzero && z)
+	{
+		// MULSHF
+		x = Ld(0x25);
+		Shift(SHFTR4);
+		return;
+	}
+	a = Lsr(a);
+	a = Ld(a | 0x80);
+	do
+	{
+		y = Ld(a);
+		if (c)
+		{
+			c = false;
+			a = Ld(M(0x29));
+			Adc(M(0x6D));
+			M(0x29) = a;
+			a = Ld(M(0x28));
+			Adc(M(0x6C));
+			M(0x28) = a;
+			a = Ld(M(0x27));
+			Adc(M(0x6B));
+			M(0x27) = a;
+			a = Ld(M(0x26));
+			Adc(M(0x6A));
+			M(0x26) = a;
+		}
+		M(0x26) = Ror(M(0x26));
+		M(0x27) = Ror(M(0x27));
+		M(0x28) = Ror(M(0x28));
+		M(0x29) = Ror(M(0x29));
+		M(0x70) = Ror(M(0x70));
+		a = Ld(y);
+		a = Lsr(a);
+	} while (!z);
+}
+
+// MULDIV $BAB7: add exponents, sign from ARISGN
+BasicFloat::MuldivResult BasicFloat::Muldiv()
+{
+	a = Ld(M(0x69));
+	if (z)
+	{
+		Zerofc(); // ZEREMV, returns from the caller too
+		return MuldivZero;
+	}
+	c = false;
+	Adc(M(0x61));
+	if (c)
+	{
+		if (n)
+			return MuldivOverflow;
+		c = false; // then BIT skips TRYOFF, flags it sets are overwritten
+	}
+	else if (!n)
+	{
+		Zerofc();
+		return MuldivZero;
+	}
+	Adc(0x80);
+	M(0x61) = a;
+	if (z)
+		M(0x66) = a; // ZEROML
+	else
+		M(0x66) = a = Ld(M(0x6F));
+	return MuldivContinue;
+}
+
+// MOVFR $BB8F: FAC mantissa from RESHO, normalized
+bool BasicFloat::Movfr()
+{
+	M(0x62) = a = Ld(M(0x26));
+	M(0x63) = a = Ld(M(0x27));
+	M(0x64) = a = Ld(M(0x28));
+	M(0x65) = a = Ld(M(0x29));
+	return Normal();
+}
+
+// MOVFA $BBFC: FAC = ARG
+void BasicFloat::Movfa()
+{
+	M(0x66) = a = Ld(M(0x6E));
+	x = Ld(0x05);
+	do
+	{
+		M(0x60 + x) = a = Ld(M(0x68 + x));
+		x = Ld((byte)(x - 1));
+	} while (!z);
+	M(0x70) = x;
+}
+
+// FDIVT $BB12: FAC = ARG / FAC, Z from FACEXP
+bool BasicFloat::Fdivt()
+{
+	if (z)
+		return false; // DIVISION BY ZERO
+	if (!Round())
+		return false;
+	a = Ld(0x00);
+	c = true;
+	Sbc(M(0x61));
+	M(0x61) = a;
+	MuldivResult result = Muldiv();
+	if (result == MuldivOverflow)
+		return false;
+	if (result == MuldivZero)
+		return true;
+	M(0x61) = Inc(M(0x61));
+	if (z)
+		return false;
+	x = Ld(0xFC);
+	a = Ld(0x01);
+
+divide:
+	y = Ld(M(0x6A));
+	Cmp(y, M(0x62));
+	if (z)
+	{
+		y = Ld(M(0x6B));
+		Cmp(y, M(0x63));
+		if (z)
+		{
+			y = Ld(M(0x6C));
+			Cmp(y, M(0x64));
+			if (z)
+			{
+				y = Ld(M(0x6D));
+				Cmp(y, M(0x65));
+			}
+		}
+	}
+
+savquo:
+	pushed_n = n;
+	pushed_v = v;
+	pushed_z = z;
+	pushed_c = c;
+	a = Rol(a);
+	if (c)
+	{
+		x = Ld((byte)(x + 1));
+		M(0x29 + x) = a;
+		if (z)
+		{
+			a = Ld(0x40); // LD100
+			goto qshft;
+		}
+		if (!n)
+		{
+			// DIVNRM
+			a = Asl(a);
+			a = Asl(a);
+			a = Asl(a);
+			a = Asl(a);
+			a = Asl(a);
+			a = Asl(a);
+			M(0x70) = a;
+			n = pushed_n;
+			v = pushed_v;
+			z = pushed_z;
+			c = pushed_c;
+			b = true;
+			return Movfr();
+		}
+		a = Ld(0x01);
+	}
+
+qshft:
+	n = pushed_n;
+	v = pushed_v;
+	z = pushed_z;
+	c = pushed_c;
+	b = true;
+	if (c)
+		goto divsub;
+
+shfarg:
+	M(0x6D) = Asl(M(0x6D));
+	M(0x6C) = Rol(M(0x6C));
+	M(0x6B) = Rol(M(0x6B));
+	M(0x6A) = Rol(M(0x6A));
+	if (c)
+		goto savquo;
+	if (n)
+		goto divide;
+	goto savquo;
+
+divsub:
+	y = Ld(a);
+	a = Ld(M(0x6D));
+	Sbc(M(0x65));
+	M(0x6D) = a;
+	a = Ld(M(0x6C));
+	Sbc(M(0x64));
+	M(0x6C) = a;
+	a = Ld(M(0x6B));
+	Sbc(M(0x63));
+	M(0x6B) = a;
+	a = Ld(M(0x6A));
+	Sbc(M(0x62));
+	M(0x6A) = a;
+	a = Ld(y);
+	goto shfarg;
+}
+
+// ROUND $BC1B: round FAC by FACOV's top bit, false for OVERFLOW
+bool BasicFloat::Round()
+{
+	a = Ld(M(0x61));
+	if (z)
+		return true;
+	M(0x70) = Asl(M(0x70));
+	if (!c)
+		return true;
+	Incfac();
+	if (!z)
+		return true;
+	return Rndshf();
+}
+
+// INT $BCCC: FAC = greatest integer not above FAC
+bool BasicFloat::Int()
+{
+	a = Ld(M(0x61));
+	Cmp(a, 0xA0);
+	if (c)
+		return true;
+	Qint();
+	M(0x70) = y;
+	a = Ld(M(0x66));
+	M(0x66) = y;
+	a = Ld(a ^ 0x80);
+	a = Rol(a);
+	M(0x61) = a = Ld(0xA0);
+	M(0x07) = a = Ld(M(0x65));
+	return Fadflt();
+}
+
+// QINT $BC9B: FAC mantissa as a 32 bit signed integer
+void BasicFloat::Qint()
+{
+	a = Ld(M(0x61));
+	if (z)
+	{
+		// CLRFAC
+		M(0x62) = M(0x63) = M(0x64) = M(0x65) = a;
+		y = Ld(a);
+		return;
+	}
+	c = true;
+	Sbc(0xA0);
+	Bit(M(0x66));
+	if (n)
+	{
+		x = Ld(a);
+		M(0x68) = a = Ld(0xFF);
+		Negfch();
+		a = Ld(x);
+	}
+	x = Ld(0x61);
+	Cmp(a, 0xF9);
+	if (n)
+	{
+		Shift(SHIFTR);
+		M(0x68) = y;
+		return;
+	}
+	y = Ld(a);
+	a = Ld(M(0x66) & 0x80);
+	M(0x62) = Lsr(M(0x62));
+	M(0x62) = a = Ld(a | M(0x62));
+	Shift(ROLSHF);
+	M(0x68) = y;
+}
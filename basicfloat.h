@@ -0,0 +1,84 @@
+#pragma once
+
+#include "emu6502.h"
+
+// C64 BASIC V2 floating point arithmetic (FADD, FSUB, FMULT, FDIV, INT) run natively.
+// Each routine is transliterated instruction for instruction from the ROM, so FAC1 ($61-$66),
+// ARG ($69-$6E), FACOV, the work bytes and A, X, Y and flags end exactly as the ROM leaves them,
+// including its rounding quirks.  SQR, LOG, EXP, SIN, FIN and FOUT are built from these and
+// speed up through them.  A routine that would raise an error, or runs in decimal mode, is left
+// to the ROM.  The stack page below S is not written.
+class BasicFloat
+{
+public:
+	enum Routine { FSUB, FSUBT, FADD, FADDT, FMULT, FMULTT, FDIV, FDIVT, INT };
+
+	BasicFloat(Emu6502* emu);
+
+	static bool IsBasicV2(const byte* basic_rom); // entry points hold the expected code
+	static int Find(ushort addr); // Routine at ROM entry point, -1 if none
+	static const char* GetName(int routine);
+
+	bool Run(Routine routine, byte A, byte X, byte Y, byte P); // false if the ROM must run it
+	void Store(byte& A, byte& X, byte& Y, byte& P); // result of Run() to memory and registers
+
+private:
+	// ROM routines, named for their labels
+	void Conupk();
+	bool Fsubt();
+	bool Faddt();
+	bool Fmultt();
+	bool Fdivt();
+	bool Int();
+	bool Fadflt();
+	bool Normal();
+	void Zerofc();
+	bool Squeez();
+	bool Rndshf();
+	void Negfac();
+	void Negfch();
+	void Incfac();
+	enum ShiftEntry { SHIFTR, SHFTR4, ROLSHF };
+	void Shift(ShiftEntry entry);
+	void Mltply(bool nonzero);
+	enum MuldivResult { MuldivContinue, MuldivZero, MuldivOverflow };
+	MuldivResult Muldiv();
+	bool Movfr();
+	void Movfa();
+	bool Round();
+	void Qint();
+
+	// 6502 operations on the registers below
+	byte Ld(byte value) { n = (value & 0x80) != 0; z = (value == 0); return value; }
+	void Adc(byte value)
+	{
+		int sum = a + value + (c ? 1 : 0);
+		v = ((~(a ^ value) & (a ^ sum) & 0x80) != 0);
+		c = (sum > 0xFF);
+		a = Ld((byte)sum);
+	}
+	void Sbc(byte value) { Adc((byte)~value); } // binary mode only
+	void Cmp(byte reg, byte value) { c = (reg >= value); Ld((byte)(reg - value)); }
+	void Bit(byte value) { n = (value & 0x80) != 0; v = (value & 0x40) != 0; z = ((a & value) == 0); }
+	byte Asl(byte value) { c = (value & 0x80) != 0; return Ld((byte)(value << 1)); }
+	byte Lsr(byte value) { c = (value & 1) != 0; return Ld((byte)(value >> 1)); }
+	byte Rol(byte value) { bool carry = (value & 0x80) != 0; value = (byte)((value << 1) | (c ? 1 : 0)); c = carry; return Ld(value); }
+	byte Ror(byte value) { bool carry = (value & 1) != 0; value = (byte)((value >> 1) | (c ? 0x80 : 0)); c = carry; return Ld(value); }
+	byte Inc(byte value) { return Ld((byte)(value + 1)); }
+	byte& M(int addr) { return zp[(byte)addr]; } // zero page, indexed wraps
+	byte Read(ushort addr) { return (addr < 0x100 && IsUsed(addr)) ? zp[addr] : emu->GetMemory(addr); }
+	static bool IsUsed(ushort addr);
+
+	Emu6502* emu;
+	byte a, x, y;
+	bool n, v, z, c;
+	bool b; // as the emulator keeps it, set by PLP of what PHP pushed
+	bool pushed_n, pushed_v, pushed_z, pushed_c; // PHP in DIVIDE
+	byte zp[256]; // zero page locations used, read before, written back if changed after
+	byte zp_before[256];
+	static const byte used[];
+
+private:
+	BasicFloat(const BasicFloat& other); // disabled
+	bool operator==(const BasicFloat& other) const; // disabled
+};
@@ -0,0 +1,441 @@
+// basicmemory.cpp - C64 BASIC garbage collection and block move run natively
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "basicmemory.h"
+
+#include <string.h>
+
+// entry points, with the whole routine as in BASIC V2
+static const byte bltu_code[] = // $A3BF-$A3FA
+{
+	0x38, 0xA5, 0x5A, 0xE5, 0x5F, 0x85, 0x22, 0xA8, 0xA5, 0x5B, 0xE5, 0x60, 0xAA, 0xE8, 0x98, 0xF0,
+	0x23, 0xA5, 0x5A, 0x38, 0xE5, 0x22, 0x85, 0x5A, 0xB0, 0x03, 0xC6, 0x5B, 0x38, 0xA5, 0x58, 0xE5,
+	0x22, 0x85, 0x58, 0xB0, 0x08, 0xC6, 0x59, 0x90, 0x04, 0xB1, 0x5A, 0x91, 0x58, 0x88, 0xD0, 0xF9,
+	0xB1, 0x5A, 0x91, 0x58, 0xC6, 0x5B, 0xC6, 0x59, 0xCA, 0xD0, 0xF2, 0x60,
+};
+static const byte garbag_code[] = // $B526-$B63C
+{
+	0xA6, 0x37, 0xA5, 0x38, 0x86, 0x33, 0x85, 0x34, 0xA0, 0x00, 0x84, 0x4F, 0x84, 0x4E, 0xA5, 0x31,
+	0xA6, 0x32, 0x85, 0x5F, 0x86, 0x60, 0xA9, 0x19, 0xA2, 0x00, 0x85, 0x22, 0x86, 0x23, 0xC5, 0x16,
+	0xF0, 0x05, 0x20, 0xC7, 0xB5, 0xF0, 0xF7, 0xA9, 0x07, 0x85, 0x53, 0xA5, 0x2D, 0xA6, 0x2E, 0x85,
+	0x22, 0x86, 0x23, 0xE4, 0x30, 0xD0, 0x04, 0xC5, 0x2F, 0xF0, 0x05, 0x20, 0xBD, 0xB5, 0xF0, 0xF3,
+	0x85, 0x58, 0x86, 0x59, 0xA9, 0x03, 0x85, 0x53, 0xA5, 0x58, 0xA6, 0x59, 0xE4, 0x32, 0xD0, 0x07,
+	0xC5, 0x31, 0xD0, 0x03, 0x4C, 0x06, 0xB6, 0x85, 0x22, 0x86, 0x23, 0xA0, 0x00, 0xB1, 0x22, 0xAA,
+	0xC8, 0xB1, 0x22, 0x08, 0xC8, 0xB1, 0x22, 0x65, 0x58, 0x85, 0x58, 0xC8, 0xB1, 0x22, 0x65, 0x59,
+	0x85, 0x59, 0x28, 0x10, 0xD3, 0x8A, 0x30, 0xD0, 0xC8, 0xB1, 0x22, 0xA0, 0x00, 0x0A, 0x69, 0x05,
+	0x65, 0x22, 0x85, 0x22, 0x90, 0x02, 0xE6, 0x23, 0xA6, 0x23, 0xE4, 0x59, 0xD0, 0x04, 0xC5, 0x58,
+	0xF0, 0xBA, 0x20, 0xC7, 0xB5, 0xF0, 0xF3, 0xB1, 0x22, 0x30, 0x35, 0xC8, 0xB1, 0x22, 0x10, 0x30,
+	0xC8, 0xB1, 0x22, 0xF0, 0x2B, 0xC8, 0xB1, 0x22, 0xAA, 0xC8, 0xB1, 0x22, 0xC5, 0x34, 0x90, 0x06,
+	0xD0, 0x1E, 0xE4, 0x33, 0xB0, 0x1A, 0xC5, 0x60, 0x90, 0x16, 0xD0, 0x04, 0xE4, 0x5F, 0x90, 0x10,
+	0x86, 0x5F, 0x85, 0x60, 0xA5, 0x22, 0xA6, 0x23, 0x85, 0x4E, 0x86, 0x4F, 0xA5, 0x53, 0x85, 0x55,
+	0xA5, 0x53, 0x18, 0x65, 0x22, 0x85, 0x22, 0x90, 0x02, 0xE6, 0x23, 0xA6, 0x23, 0xA0, 0x00, 0x60,
+	0xA5, 0x4F, 0x05, 0x4E, 0xF0, 0xF5, 0xA5, 0x55, 0x29, 0x04, 0x4A, 0xA8, 0x85, 0x55, 0xB1, 0x4E,
+	0x65, 0x5F, 0x85, 0x5A, 0xA5, 0x60, 0x69, 0x00, 0x85, 0x5B, 0xA5, 0x33, 0xA6, 0x34, 0x85, 0x58,
+	0x86, 0x59, 0x20, 0xBF, 0xA3, 0xA4, 0x55, 0xC8, 0xA5, 0x58, 0x91, 0x4E, 0xAA, 0xE6, 0x59, 0xA5,
+	0x59, 0xC8, 0x91, 0x4E, 0x4C, 0x2A, 0xB5,
+};
+static const struct
+{
+	ushort addr;
+	BasicMemory::Routine routine;
+	const char* name;
+	const byte* code;
+	size_t size;
+} entries[] =
+{
+	{ 0xA3BF, BasicMemory::BLTU, "BLTU", bltu_code, sizeof(bltu_code) },
+	{ 0xB526, BasicMemory::GARBAG, "GARBAG", garbag_code, sizeof(garbag_code) },
+};
+static const int entry_count = sizeof(entries) / sizeof(entries[0]);
+static const ushort basic_addr = 0xA000;
+
+BasicMemory::BasicMemory(Emu6502* emu)
+	: emu(emu)
+{
+	a = x = y = s = 0;
+	n = v = z = c = i = b = false;
+	pushed_n = pushed_v = pushed_z = pushed_c = false;
+}
+
+bool BasicMemory::IsBasicV2(const byte* basic_rom)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (memcmp(&basic_rom[entries[i].addr - basic_addr], entries[i].code, entries[i].size) != 0)
+			return false;
+	return true;
+}
+
+int BasicMemory::Find(ushort addr)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (entries[i].addr == addr)
+			return entries[i].routine;
+	return -1;
+}
+
+const char* BasicMemory::GetName(int routine)
+{
+	for (int i = 0; i < entry_count; ++i)
+		if (entries[i].routine == routine)
+			return entries[i].name;
+	return "?";
+}
+
+void BasicMemory::Run(Routine routine, byte& A, byte& X, byte& Y, byte& P, byte S)
+{
+	a = A;
+	x = X;
+	y = Y;
+	s = S;
+	n = (P & 0x80) != 0;
+	v = (P & 0x40) != 0;
+	b = (P & 0x10) != 0;
+	i = (P & 0x04) != 0;
+	z = (P & 0x02) != 0;
+	c = (P & 0x01) != 0;
+	for (int addr = 0; addr < 0x100; ++addr)
+		zp[addr] = zp_before[addr] = (addr == 0xA2) ? 0 : emu->GetMemory((ushort)addr);
+
+	switch (routine)
+	{
+	case BLTU: Bltu(); break;
+	case GARBAG: Garbag(); break;
+	}
+
+	for (int addr = 0; addr < 0x100; ++addr)
+		if (zp[addr] != zp_before[addr])
+			emu->SetMemory((ushort)addr, zp[addr]);
+	A = a;
+	X = x;
+	Y = y;
+	P = (byte)((P & 0x2C) | (n ? 0x80 : 0) | (v ? 0x40 : 0) | (b ? 0x10 : 0) | (z ? 0x02 : 0) | (c ? 0x01 : 0));
+}
+
+void BasicMemory::Write(ushort addr, byte value)
+{
+	if (addr < 0x100 && addr != 0xA2)
+		zp[addr] = value;
+	else
+		emu->SetMemory(addr, value);
+}
+
+void BasicMemory::Jsr(ushort addr)
+{
+	ushort ret = (ushort)(addr + 2);
+	emu->SetMemory((ushort)(0x100 + s), (byte)(ret >> 8));
+	emu->SetMemory((ushort)(0x100 + (byte)(s - 1)), (byte)ret);
+}
+
+void BasicMemory::Php()
+{
+	emu->SetMemory((ushort)(0x100 + s), (byte)(0x30 | (n ? 0x80 : 0) | (v ? 0x40 : 0) | (i ? 0x04 : 0) | (z ? 0x02 : 0) | (c ? 0x01 : 0)));
+	pushed_n = n;
+	pushed_v = v;
+	pushed_z = z;
+	pushed_c = c;
+}
+
+void BasicMemory::Plp()
+{
+	n = pushed_n;
+	v = pushed_v;
+	z = pushed_z;
+	c = pushed_c;
+	b = true;
+}
+
+// GARBAG $B526: repeatedly finds the highest string below FRETOP still referenced by a temporary,
+// simple variable or array descriptor, moves it up to FRETOP and points the descriptor at it
+void BasicMemory::Garbag()
+{
+	x = Ld(M(0x37));
+	a = Ld(M(0x38));
+
+fndhi:
+	M(0x33) = x;
+	M(0x34) = a;
+	y = Ld(0x00);
+	M(0x4F) = y;
+	M(0x4E) = y;
+	a = Ld(M(0x31));
+	x = Ld(M(0x32));
+	M(0x5F) = a;
+	M(0x60) = x;
+	a = Ld(0x19);
+	x = Ld(0x00);
+	M(0x22) = a;
+	M(0x23) = x;
+	for (;;) // TVAR, temporary descriptors
+	{
+		Cmp(a, M(0x16));
+		if (z)
+			break;
+		Jsr(0xB548);
+		Dvar();
+	}
+
+	// SVARS, simple variables
+	a = Ld(0x07);
+	M(0x53) = a;
+	a = Ld(M(0x2D));
+	x = Ld(M(0x2E));
+	M(0x22) = a;
+	M(0x23) = x;
+	for (;;)
+	{
+		Cmp(x, M(0x30));
+		if (z)
+		{
+			Cmp(a, M(0x2F));
+			if (z)
+				break;
+		}
+		Jsr(0xB561);
+		Svar1();
+	}
+
+	// ARYVAR, arrays
+	M(0x58) = a;
+	M(0x59) = x;
+	a = Ld(0x03);
+	M(0x53) = a;
+
+aryva2:
+	a = Ld(M(0x58));
+	x = Ld(M(0x59));
+
+aryva3:
+	Cmp(x, M(0x32));
+	if (z)
+	{
+		Cmp(a, M(0x31));
+		if (z)
+			goto movstr;
+	}
+	M(0x22) = a;
+	M(0x23) = x;
+	y = Ld(0x00);
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	x = Ld(a);
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	Php();
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	Adc(M(0x58));
+	M(0x58) = a;
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	Adc(M(0x59));
+	M(0x59) = a;
+	Plp();
+	if (!n)
+		goto aryva2; // not a string array
+	a = Ld(x);
+	if (n)
+		goto aryva2;
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	y = Ld(0x00);
+	c = (a & 0x80) != 0;
+	a = Ld((byte)(a << 1));
+	Adc(0x05);
+	Adc(M(0x22));
+	M(0x22) = a;
+	if (c)
+		M(0x23) = Inc(M(0x23));
+	x = Ld(M(0x23));
+	for (;;) // ARYST1, elements
+	{
+		Cmp(x, M(0x59));
+		if (z)
+		{
+			Cmp(a, M(0x58));
+			if (z)
+				goto aryva3;
+		}
+		Jsr(0xB5B8);
+		Dvar();
+	}
+
+movstr:
+	a = Ld(M(0x4F));
+	a = Ld(a | M(0x4E));
+	if (z)
+	{
+		// GRBRTS, none left below FRETOP
+		x = Ld(M(0x23));
+		y = Ld(0x00);
+		return;
+	}
+	a = Ld(M(0x55));
+	a = Ld(a & 0x04);
+	c = (a & 0x01) != 0;
+	a = Ld((byte)(a >> 1));
+	y = Ld(a);
+	M(0x55) = a;
+	a = Ld(Read((ushort)(Pointer(0x4E) + y)));
+	Adc(M(0x5F));
+	M(0x5A) = a;
+	a = Ld(M(0x60));
+	Adc(0x00);
+	M(0x5B) = a;
+	a = Ld(M(0x33));
+	x = Ld(M(0x34));
+	M(0x58) = a;
+	M(0x59) = x;
+	Jsr(0xB628);
+	Bltu();
+	y = Ld(M(0x55));
+	y = Ld((byte)(y + 1));
+	a = Ld(M(0x58));
+	Write((ushort)(Pointer(0x4E) + y), a);
+	x = Ld(a);
+	M(0x59) = Inc(M(0x59));
+	a = Ld(M(0x59));
+	y = Ld((byte)(y + 1));
+	Write((ushort)(Pointer(0x4E) + y), a);
+	goto fndhi;
+}
+
+// SVAR1 $B5BD: simple variable at INDEX is a string if only the second name byte has bit 7 set
+void BasicMemory::Svar1()
+{
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	if (n)
+		goto dvarts;
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	if (!n)
+		goto dvarts;
+	y = Ld((byte)(y + 1));
+	Dvar();
+	return;
+
+dvarts:
+	Dvarts();
+}
+
+// DVAR $B5C7: descriptor at INDEX+Y becomes the candidate if its string is not empty,
+// below FRETOP and at or above the highest so far (LOWTR)
+void BasicMemory::Dvar()
+{
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	if (z)
+		goto dvarts;
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	x = Ld(a);
+	y = Ld((byte)(y + 1));
+	a = Ld(Read((ushort)(Pointer(0x22) + y)));
+	Cmp(a, M(0x34));
+	if (c)
+	{
+		if (!z)
+			goto dvarts;
+		Cmp(x, M(0x33));
+		if (c)
+			goto dvarts;
+	}
+	Cmp(a, M(0x60));
+	if (!c)
+		goto dvarts;
+	if (z)
+	{
+		Cmp(x, M(0x5F));
+		if (!c)
+			goto dvarts;
+	}
+	M(0x5F) = x;
+	M(0x60) = a;
+	a = Ld(M(0x22));
+	x = Ld(M(0x23));
+	M(0x4E) = a;
+	M(0x4F) = x;
+	a = Ld(M(0x53));
+	M(0x55) = a;
+
+dvarts:
+	Dvarts();
+}
+
+// DVARTS $B5F6: INDEX to the next descriptor, returns with X = INDEX+1, Y = 0
+void BasicMemory::Dvarts()
+{
+	a = Ld(M(0x53));
+	c = false;
+	Adc(M(0x22));
+	M(0x22) = a;
+	if (c)
+		M(0x23) = Inc(M(0x23));
+	x = Ld(M(0x23));
+	y = Ld(0x00);
+}
+
+// BLTU $A3BF: LOWTR up to HIGHTR moved to end at HIGHDS, copied from the top down a page at
+// a time.  The loop leaves HIGHTR and HIGHDS one page below the start of each block, INDEX the
+// count mod 256, X and Y zero, A the byte read last and C, V from the last subtract.
+void BasicMemory::Bltu()
+{
+	ushort lowtr = Pointer(0x5F);
+	ushort hightr = Pointer(0x5A);
+	ushort highds = Pointer(0x58);
+	ushort count = (ushort)(hightr - lowtr);
+	ushort dest = (ushort)(highds - count);
+	byte minuend = (byte)highds; // HIGHDS - INDEX
+	byte subtrahend = (byte)count;
+	if (subtrahend == 0)
+	{
+		minuend = (byte)(hightr >> 8); // HIGHTR+1 - LOWTR+1, low bytes equal so no borrow
+		subtrahend = (byte)(lowtr >> 8);
+	}
+	byte difference = (byte)(minuend - subtrahend);
+	c = (minuend >= subtrahend);
+	v = (((minuend ^ subtrahend) & (minuend ^ difference) & 0x80) != 0);
+	M(0x22) = (byte)count;
+	a = (count != 0) ? Move(dest, lowtr, count) : 0;
+	M(0x5A) = (byte)lowtr;
+	M(0x5B) = (byte)((lowtr >> 8) - 1);
+	M(0x58) = (byte)dest;
+	M(0x59) = (byte)((dest >> 8) - 1);
+	x = Ld(0x00);
+	y = 0;
+}
+
+byte BasicMemory::Move(ushort dest, ushort src, unsigned count)
+{
+	if (src >= 0x100 && dest >= 0x100 && src + count <= 0x10000 && dest + count <= 0x10000)
+		return emu->MoveMemoryDown(dest, src, count);
+	byte value = 0;
+	while (count-- > 0) // zero page is worked on here
+	{
+		value = Read((ushort)(src + count));
+		Write((ushort)(dest + count), value);
+	}
+	return value;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "emu6502.h"
+
+// C64 BASIC V2 string garbage collection (GARBAG) and block move (BLTU) run natively.
+// GARBAG is transliterated instruction for instruction from the ROM, so strings, descriptors,
+// the pointers it works with, A, X, Y, flags and even the return addresses and status it leaves
+// on the stack page end exactly as the ROM leaves them.  BLTU's byte loop is a host memmove,
+// its pointers, registers and flags are computed as the loop would leave them.  Only used when
+// the whole of each routine in the ROM holds the expected code.
+class BasicMemory
+{
+public:
+	enum Routine { BLTU, GARBAG };
+
+	BasicMemory(Emu6502* emu);
+
+	static bool IsBasicV2(const byte* basic_rom); // routines hold the expected code
+	static int Find(ushort addr); // Routine at ROM entry point, -1 if none
+	static const char* GetName(int routine);
+
+	void Run(Routine routine, byte& A, byte& X, byte& Y, byte& P, byte S); // binary mode only
+
+private:
+	// ROM routines, named for their labels
+	void Garbag();
+	void Svar1();
+	void Dvar();
+	void Dvarts();
+	void Bltu();
+	byte Move(ushort dest, ushort src, unsigned count); // as BLTU's loop, returns the byte read last
+
+	// 6502 operations on the registers below
+	byte Ld(byte value) { n = (value & 0x80) != 0; z = (value == 0); return value; }
+	void Adc(byte value)
+	{
+		int sum = a + value + (c ? 1 : 0);
+		v = ((~(a ^ value) & (a ^ sum) & 0x80) != 0);
+		c = (sum > 0xFF);
+		a = Ld((byte)sum);
+	}
+	void Cmp(byte reg, byte value) { c = (reg >= value); Ld((byte)(reg - value)); }
+	byte Inc(byte value) { return Ld((byte)(value + 1)); }
+	void Jsr(ushort addr); // return address left on the stack page, S is unchanged when the call returns
+	void Php();
+	void Plp();
+	byte& M(int addr) { return zp[(byte)addr]; } // zero page
+	ushort Pointer(int addr) { return (ushort)(M(addr) | (M(addr + 1) << 8)); }
+	byte Read(ushort addr) { return (addr < 0x100 && addr != 0xA2) ? zp[addr] : emu->GetMemory(addr); }
+	void Write(ushort addr, byte value);
+
+	Emu6502* emu;
+	byte a, x, y, s;
+	bool n, v, z, c, i;
+	bool b; // as the emulator keeps it, set by PLP of what PHP pushed
+	bool pushed_n, pushed_v, pushed_z, pushed_c;
+	byte zp[256]; // read before except $A2 (read sets the clock), written back if changed after
+	byte zp_before[256];
+
+private:
+	BasicMemory(const BasicMemory& other); // disabled
+	bool operator==(const BasicMemory& other) const; // disabled
+};
@@ -0,0 +1,85 @@
+// basicprofiler.cpp - Cycles and executions per BASIC line
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "basicprofiler.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+static const int line_count = 0x10000;
+
+BasicProfiler::BasicProfiler(ushort curlin_addr, FILE* out)
+{
+	this->curlin_addr = curlin_addr;
+	this->out = out;
+	line_cycles = new unsigned long long[line_count];
+	line_executions = new unsigned long long[line_count];
+	Clear();
+}
+
+BasicProfiler::~BasicProfiler()
+{
+	delete[] line_cycles;
+	delete[] line_executions;
+}
+
+void BasicProfiler::Clear()
+{
+	memset(line_cycles, 0, line_count * sizeof(line_cycles[0]));
+	memset(line_executions, 0, line_count * sizeof(line_executions[0]));
+	last_line = direct_mode;
+	last_cycles = 0;
+	pending = false;
+	line_start = false;
+}
+
+void BasicProfiler::ProgramEnded()
+{
+	unsigned long long total_cycles = 0;
+	std::vector<int> lines;
+	for (int line = 0; line < direct_mode; ++line)
+	{
+		if (line_cycles[line] == 0 && line_executions[line] == 0)
+			continue;
+		lines.push_back(line);
+		total_cycles += line_cycles[line];
+	}
+	if (!lines.empty())
+	{
+		double percent = (total_cycles > 0) ? 100.0 / total_cycles : 0;
+		std::sort(lines.begin(), lines.end(), [this](int a, int b) { return line_cycles[a] > line_cycles[b] || (line_cycles[a] == line_cycles[b] && a < b); });
+		fprintf(out, "basic profile: %llu cycles, %u lines\n", total_cycles, (unsigned)lines.size());
+		fprintf(out, "cycles%%       cycles   executions  line\n");
+		for (size_t i = 0; i < lines.size(); ++i)
+			fprintf(out, "%6.2f %12llu %12llu %5d\n", line_cycles[lines[i]] * percent, line_cycles[lines[i]], line_executions[lines[i]], lines[i]);
+		fprintf(out, "\n");
+		fflush(out);
+	}
+	Clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <stdio.h>
+
+// Cycles and executions per BASIC line, from the interpreter's current line number (CURLIN).
+// A line execution is counted each time the interpreter stores the high byte of CURLIN
+// (STA/STX/STY zero page), which it does at the start of every line it runs, including
+// loops back to the same line.  Direct mode (line $FFxx) is not counted.
+// Like Profiler, attaching puts the CPU on its per-instruction slow path.
+class BasicProfiler
+{
+public:
+	BasicProfiler(ushort curlin_addr, FILE* out); // out receives a report each time a program ends, not owned
+	~BasicProfiler();
+
+	inline void Count(Emu6502* emu, ushort pc, unsigned long long cycles) // before each instruction
+	{
+		ushort line = (ushort)(emu->GetMemory(curlin_addr) | (emu->GetMemory((ushort)(curlin_addr + 1)) << 8));
+		if (line_start && line < direct_mode)
+			++line_executions[line];
+		if (pending && last_line < direct_mode)
+			line_cycles[last_line] += cycles - last_cycles;
+		last_line = line;
+		last_cycles = cycles;
+		pending = true;
+
+		byte opcode = emu->GetMemory(pc);
+		line_start = (opcode == 0x85 || opcode == 0x86 || opcode == 0x84) // STA/STX/STY zp
+			&& emu->GetMemory((ushort)(pc + 1)) == (byte)(curlin_addr + 1);
+	}
+
+	void ProgramEnded(); // at READY, reports lines run since last report, then clears
+	void Clear();
+
+private:
+	static const ushort direct_mode = 0xFF00;
+
+	ushort curlin_addr;
+	FILE* out;
+	unsigned long long* line_cycles; // 64K entries
+	unsigned long long* line_executions; // 64K entries
+	ushort last_line;
+	unsigned long long last_cycles;
+	bool pending; // last_line cycles not yet counted
+	bool line_start; // instruction about to run stores CURLIN high byte
+
+private:
+	BasicProfiler(const BasicProfiler& other); // disabled
+	bool operator==(const BasicProfiler& other) const; // disabled
+};
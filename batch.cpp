@@ -0,0 +1,98 @@
+// batch.cpp - Batch runner front end
+//
+// runs a manifest of headless jobs in parallel and writes a results file
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// c-simple-emu-cbm (C++ Portable Version)
+// C64/6502 Emulator for Microsoft Windows Console
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "batchrunner.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char* argv[])
+{
+	// options before manifest
+	while (argc > 1 && argv[1][0] == '-')
+	{
+		if (strcmp(argv[1], "-fastfloat") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastFloat;
+		else if (strcmp(argv[1], "-fastchrget") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastChrget;
+		else if (strcmp(argv[1], "-faststrings") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastStrings;
+		else if (strcmp(argv[1], "-fastkernal") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastKernal;
+		else if (strcmp(argv[1], "-verifyfast") == 0)
+			EmuCBM::DefaultVerifyFastPaths = true;
+		else
+			break;
+		++argv;
+		--argc;
+	}
+
+	if (argc < 3 || argc > 5)
+	{
+		fprintf(stderr, "usage: %s [options] manifest results [threads [snapshot_dir]]\n", argv[0]);
+		fprintf(stderr, "manifest lines: machine[,fast...] file budget [input]\n");
+		fprintf(stderr, "  machine  64, 128, 4, 16, 20, or 2001\n");
+		fprintf(stderr, "  fast     options below without the dash, or nofast, in place of the options for this job\n");
+		fprintf(stderr, "  file     PRG or D64 to auto-run, - for none\n");
+		fprintf(stderr, "  budget   instruction limit, 0 for unlimited\n");
+		fprintf(stderr, "  input    typed keys, \\r for RETURN, \\xHH for other codes, job ends when consumed\n");
+		fprintf(stderr, "threads defaults to number of processors (0)\n");
+		fprintf(stderr, "snapshot_dir keeps boot snapshots between batches\n");
+		fprintf(stderr, "options: -fastfloat  native C64 BASIC floating point\n");
+		fprintf(stderr, "         -fastchrget native BASIC CHRGET text scanner\n");
+		fprintf(stderr, "         -faststrings native C64 BASIC string garbage collection and block moves\n");
+		fprintf(stderr, "         -fastkernal native KERNAL RAM test and screen scrolling (64, 20, 4, 16)\n");
+		fprintf(stderr, "         -verifyfast also emulate each native routine, report differences\n");
+		return 1;
+	}
+
+	// each machine configuration boots once, later jobs start at READY
+	EmuCBM::BootSnapshots = true;
+	if (argc > 4)
+		EmuCBM::BootSnapshotDir = argv[4];
+
+	BatchRunner runner((argc > 3) ? atoi(argv[3]) : 0);
+	if (!runner.LoadManifest(argv[1]))
+		return 1;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	runner.Run();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "batch completed in %.2f seconds\n", seconds);
+
+	return runner.WriteResults(argv[2]) ? 0 : 1;
+}
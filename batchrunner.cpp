@@ -0,0 +1,412 @@
+// batchrunner.cpp - Parallel headless job runner
+//
+// each job runs on its own emulator instance with its own captured console
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// c-simple-emu-cbm (C++ Portable Version)
+// C64/6502 Emulator for Microsoft Windows Console
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "batchrunner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+extern "C" void* D64_CreateOrLoad(const char* filename);
+extern "C" void D64_Close(void* disk);
+
+CaptureConsole::CaptureConsole(const char* script)
+{
+	this->script = (script != 0) ? script : "";
+}
+
+CaptureConsole::~CaptureConsole()
+{
+}
+
+// keep what a terminal would show as text, drop cursor/color/screen controls
+void CaptureConsole::WriteChar(unsigned char c, bool /*supress_next_home*/)
+{
+	if (c == 0x0D)
+		output += '\n';
+	else if (c >= ' ' && c <= '~')
+		output += (char)c;
+}
+
+unsigned char CaptureConsole::ReadChar(void)
+{
+	if (buffer_count == 0)
+	{
+		if (*script == 0)
+			return 0x0D; // caller should have checked EndOfInput()
+		char next[2] = { *(script++), 0 };
+		Push(next);
+	}
+	return CBMConsole::ReadChar(); // buffer not empty, so does not block
+}
+
+bool CaptureConsole::EndOfInput()
+{
+	return buffer_count == 0 && *script == 0;
+}
+
+///////////////////////////////////////////////////////////////////////
+
+BatchRunner::BatchRunner(int threads)
+{
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+	this->threads = threads;
+	queues = new WorkQueue[threads];
+}
+
+BatchRunner::~BatchRunner()
+{
+	delete[] queues;
+}
+
+static bool IsValidMachine(int go_num)
+{
+	return go_num == 64 || go_num == 128 || go_num == 4 || go_num == 16 || go_num == 20 || go_num == 2001;
+}
+
+// comma separated fast paths after the machine, named as the options without the dash, nofast for none
+static bool ParseFastPaths(char* options, unsigned* fast_paths)
+{
+	*fast_paths = 0;
+	for (char* name = options; name != 0; )
+	{
+		char* next = strchr(name, ',');
+		if (next != 0)
+			*(next++) = 0;
+		if (strcmp(name, "fastfloat") == 0)
+			*fast_paths |= EmuCBM::FastFloat;
+		else if (strcmp(name, "fastchrget") == 0)
+			*fast_paths |= EmuCBM::FastChrget;
+		else if (strcmp(name, "faststrings") == 0)
+			*fast_paths |= EmuCBM::FastStrings;
+		else if (strcmp(name, "fastkernal") == 0)
+			*fast_paths |= EmuCBM::FastKernal;
+		else if (strcmp(name, "nofast") != 0)
+			return false;
+		name = next;
+	}
+	return true;
+}
+
+static bool HasExtension(const std::string& filename, const char* ext)
+{
+	size_t len = strlen(ext);
+	if (filename.length() < len)
+		return false;
+	for (size_t i = 0; i < len; ++i)
+	{
+		char c = filename[filename.length() - len + i];
+		if (c >= 'A' && c <= 'Z')
+			c = c - 'A' + 'a';
+		if (c != ext[i])
+			return false;
+	}
+	return true;
+}
+
+static int HexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+// \r or \n is RETURN, \\ is backslash, \xHH is any PETSCII code
+static std::string ExpandEscapes(const char* s)
+{
+	std::string result;
+	while (*s != 0)
+	{
+		if (*s != '\\' || s[1] == 0)
+			result += *(s++);
+		else if (s[1] == 'r' || s[1] == 'n')
+		{
+			result += '\r';
+			s += 2;
+		}
+		else if (s[1] == 'x' && HexDigit(s[2]) >= 0 && HexDigit(s[3]) >= 0)
+		{
+			result += (char)(HexDigit(s[2]) * 16 + HexDigit(s[3]));
+			s += 4;
+		}
+		else
+		{
+			result += s[1];
+			s += 2;
+		}
+	}
+	return result;
+}
+
+// one job per line: machine[,fast...] file budget [input...]
+// fast paths listed replace the defaults for the job, file is - for none, budget is instructions (0 for unlimited), input is rest of line with escapes
+// blank lines and lines starting with # are ignored
+bool BatchRunner::LoadManifest(const char* filename)
+{
+#ifdef WINDOWS
+	FILE* fp;
+	fopen_s(&fp, filename, "r");
+#else
+	FILE* fp = fopen(filename, "r");
+#endif
+	if (fp == 0)
+	{
+		fprintf(stderr, "unable to open manifest %s\n", filename);
+		return false;
+	}
+
+	char line[1024];
+	int line_num = 0;
+	bool success = true;
+	while (fgets(line, sizeof(line), fp) != 0)
+	{
+		++line_num;
+		size_t len = strlen(line);
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = 0;
+
+		char* s = line;
+		while (*s == ' ' || *s == '\t')
+			++s;
+		if (*s == 0 || *s == '#')
+			continue;
+
+		char machine[128];
+		char file[512];
+		unsigned long long budget;
+		int input_offset = 0;
+#ifdef WINDOWS
+		if (sscanf_s(s, "%127s %511s %llu %n", machine, (unsigned)sizeof(machine), file, (unsigned)sizeof(file), &budget, &input_offset) < 3)
+#else
+		if (sscanf(s, "%127s %511s %llu %n", machine, file, &budget, &input_offset) < 3)
+#endif
+		{
+			fprintf(stderr, "%s(%d): expected machine[,fast...] file budget [input]\n", filename, line_num);
+			success = false;
+			continue;
+		}
+
+		BatchJob job;
+		job.line = line_num;
+		job.go_num = atoi(machine);
+		job.fast_paths = EmuCBM::DefaultFastPaths;
+		job.filename = (strcmp(file, "-") == 0) ? "" : file;
+		job.budget = budget;
+		job.input = ExpandEscapes(s + input_offset);
+		job.exit_reason = "not run";
+		job.exit_go_num = 0;
+		job.instructions = 0;
+		job.cycles = 0;
+
+		if (!IsValidMachine(job.go_num))
+		{
+			fprintf(stderr, "%s(%d): unknown machine %s\n", filename, line_num, machine);
+			success = false;
+			continue;
+		}
+
+		char* options = strchr(machine, ',');
+		if (options != 0 && !ParseFastPaths(options + 1, &job.fast_paths))
+		{
+			fprintf(stderr, "%s(%d): unknown fast path in %s\n", filename, line_num, machine);
+			success = false;
+			continue;
+		}
+
+		if (!job.filename.empty())
+		{
+#ifdef WINDOWS
+			FILE* test;
+			fopen_s(&test, file, "rb");
+#else
+			FILE* test = fopen(file, "rb");
+#endif
+			if (test == 0)
+			{
+				fprintf(stderr, "%s(%d): file not found %s\n", filename, line_num, file);
+				success = false;
+				continue;
+			}
+			fclose(test);
+		}
+
+		jobs.push_back(job);
+	}
+	fclose(fp);
+	return success;
+}
+
+void BatchRunner::RunJob(BatchJob& job)
+{
+	CaptureConsole console(job.input.c_str());
+	EmuCBM* cbm = EmuCBM::Create(job.go_num, job.fast_paths);
+	cbm->console = &console;
+	cbm->go_num = job.go_num;
+	if (HasExtension(job.filename, ".d64"))
+	{
+		cbm->disk = D64_CreateOrLoad(job.filename.c_str());
+		cbm->StartupPRG = "*"; // first program on disk
+	}
+	else if (!job.filename.empty())
+		cbm->StartupPRG = job.filename.c_str();
+
+	cbm->Reset();
+	Emu6502::StopReason reason = (job.budget == 0) ? cbm->Run() : cbm->RunInstructions(job.budget);
+
+	if (reason == Emu6502::StopInstructions)
+		job.exit_reason = "budget";
+	else if (reason == Emu6502::StopInvalidOpcode)
+		job.exit_reason = "invalid opcode";
+	else if (console.EndOfInput())
+		job.exit_reason = "input";
+	else if (cbm->go_num != job.go_num)
+	{
+		job.exit_reason = "go";
+		job.exit_go_num = cbm->go_num;
+	}
+	else
+		job.exit_reason = "quit";
+	job.instructions = cbm->GetInstructions();
+	job.cycles = cbm->GetCycles();
+	job.output.swap(console.output);
+
+	if (cbm->disk != 0)
+		D64_Close(cbm->disk);
+	delete cbm;
+}
+
+// a PRG is auto-run from a D64 created beside it on first use, so create these before threads race to do so
+void BatchRunner::PrepareDisks()
+{
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		if (!HasExtension(jobs[i].filename, ".prg"))
+			continue;
+		bool seen = false;
+		for (size_t j = 0; !seen && j < i; ++j)
+			seen = (jobs[j].filename == jobs[i].filename);
+		if (!seen)
+			D64_Close(D64_CreateOrLoad(jobs[i].filename.c_str()));
+	}
+}
+
+void BatchRunner::Run()
+{
+	PrepareDisks();
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+		queues[i % threads].jobs.push_back((int)i);
+
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; ++i)
+		workers.push_back(std::thread(&BatchRunner::Worker, this, i));
+	Worker(0);
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+}
+
+void BatchRunner::Worker(int index)
+{
+	int job;
+	while (NextJob(index, job))
+		RunJob(jobs[job]);
+}
+
+// take oldest from own queue, otherwise steal newest from another queue
+bool BatchRunner::NextJob(int index, int& job)
+{
+	{
+		std::lock_guard<std::mutex> guard(queues[index].lock);
+		if (!queues[index].jobs.empty())
+		{
+			job = queues[index].jobs.front();
+			queues[index].jobs.pop_front();
+			return true;
+		}
+	}
+	for (int i = 1; i < threads; ++i)
+	{
+		WorkQueue& victim = queues[(index + i) % threads];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.back();
+			victim.jobs.pop_back();
+			return true;
+		}
+	}
+	return false; // jobs are never added while running, so all done
+}
+
+bool BatchRunner::WriteResults(const char* filename)
+{
+#ifdef WINDOWS
+	FILE* fp;
+	fopen_s(&fp, filename, "wb");
+#else
+	FILE* fp = fopen(filename, "wb");
+#endif
+	if (fp == 0)
+	{
+		fprintf(stderr, "unable to write results %s\n", filename);
+		return false;
+	}
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const BatchJob& job = jobs[i];
+		fprintf(fp, "job %d: machine %d, file %s\n", job.line, job.go_num, job.filename.empty() ? "-" : job.filename.c_str());
+		if (job.exit_go_num != 0)
+			fprintf(fp, "exit %s %d", job.exit_reason, job.exit_go_num);
+		else
+			fprintf(fp, "exit %s", job.exit_reason);
+		fprintf(fp, ", instructions %llu, cycles %llu, output %u bytes\n", job.instructions, job.cycles, (unsigned)job.output.length());
+		fwrite(job.output.data(), 1, job.output.length(), fp);
+		if (job.output.length() > 0 && job.output[job.output.length() - 1] != '\n')
+			fputc('\n', fp);
+		fputc('\n', fp);
+	}
+
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "emucbm.h"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Headless console for batch jobs: input comes from a script, CHROUT is captured instead of drawn
+class CaptureConsole : public CBMConsole
+{
+public:
+	CaptureConsole(const char* script);
+	virtual ~CaptureConsole();
+	virtual void WriteChar(unsigned char c, bool supress_next_home = false);
+	virtual unsigned char ReadChar(void);
+	virtual bool EndOfInput();
+
+	std::string output; // printable characters, carriage return translated to newline
+
+private:
+	const char* script; // remaining scripted input, consumed after anything Push()ed
+
+private:
+	CaptureConsole(const CaptureConsole& other); // disabled
+	bool operator==(const CaptureConsole& other) const; // disabled
+};
+
+struct BatchJob
+{
+	// from manifest
+	int line; // manifest line number, identifies job in results
+	int go_num; // machine, same numbers as GO/command line: 64, 128, 4, 16, 20, 2001
+	unsigned fast_paths; // EmuCBM::FastPath bits, DefaultFastPaths unless listed after the machine
+	std::string filename; // PRG or D64 to auto-run, empty for none
+	unsigned long long budget; // instructions, 0 for unlimited
+	std::string input; // scripted keyboard input, escapes already expanded
+
+	// results
+	const char* exit_reason;
+	int exit_go_num; // machine requested by GO, if exit_reason is "go"
+	unsigned long long instructions;
+	unsigned long long cycles;
+	std::string output;
+};
+
+// Runs jobs from a manifest on a pool of threads, each thread owning a queue and stealing from the others when empty
+class BatchRunner
+{
+public:
+	BatchRunner(int threads);
+	~BatchRunner();
+
+	bool LoadManifest(const char* filename);
+	void Run();
+	bool WriteResults(const char* filename);
+
+	static void RunJob(BatchJob& job);
+
+private:
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<int> jobs;
+	};
+
+	void Worker(int index);
+	bool NextJob(int index, int& job);
+	void PrepareDisks();
+
+	int threads;
+	WorkQueue* queues;
+	std::vector<BatchJob> jobs;
+
+private:
+	BatchRunner(const BatchRunner& other); // disabled
+	bool operator==(const BatchRunner& other) const; // disabled
+};
@@ -0,0 +1,180 @@
+// callgraph.cpp - Shadow call stack and call graph profile
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "callgraph.h"
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+
+static const int address_count = 0x10000;
+
+CallGraph::CallGraph()
+{
+	calls = new unsigned long long[address_count];
+	inclusive_cycles = new unsigned long long[address_count];
+	exclusive_cycles = new unsigned long long[address_count];
+	active = new int[address_count];
+	Clear();
+}
+
+CallGraph::~CallGraph()
+{
+	delete[] calls;
+	delete[] inclusive_cycles;
+	delete[] exclusive_cycles;
+	delete[] active;
+}
+
+void CallGraph::Clear()
+{
+	memset(calls, 0, address_count * sizeof(calls[0]));
+	memset(inclusive_cycles, 0, address_count * sizeof(inclusive_cycles[0]));
+	memset(exclusive_cycles, 0, address_count * sizeof(exclusive_cycles[0]));
+	memset(active, 0, address_count * sizeof(active[0]));
+	nodes.clear();
+	frames.clear();
+	nodes.push_back(Node(-1, 0));
+	last_cycles = 0;
+}
+
+void CallGraph::Charge(unsigned long long cycles)
+{
+	unsigned long long delta = cycles - last_cycles;
+	int node = Current();
+	nodes[node].self_cycles += delta;
+	if (node != 0)
+		exclusive_cycles[nodes[node].addr] += delta;
+	last_cycles = cycles;
+}
+
+void CallGraph::Pop(unsigned long long cycles)
+{
+	Frame frame = frames.back();
+	frames.pop_back();
+	ushort addr = nodes[frame.node].addr;
+	if (--active[addr] == 0)
+		inclusive_cycles[addr] += cycles - frame.start_cycles;
+}
+
+void CallGraph::Call(ushort addr, byte sp, unsigned long long cycles)
+{
+	Charge(cycles);
+	while (!frames.empty() && frames.back().sp <= sp)
+		Pop(cycles); // stack was reset under these frames, they never return
+
+	int parent = Current();
+	std::map<ushort, int>::iterator child = nodes[parent].children.find(addr);
+	int node;
+	if (child != nodes[parent].children.end())
+		node = child->second;
+	else
+	{
+		node = (int)nodes.size();
+		nodes[parent].children[addr] = node;
+		nodes.push_back(Node(parent, addr));
+	}
+
+	Frame frame = { node, sp, cycles };
+	frames.push_back(frame);
+	++calls[addr];
+	++active[addr];
+}
+
+void CallGraph::Return(byte sp, unsigned long long cycles)
+{
+	Charge(cycles);
+	if (frames.empty() || sp < frames.back().sp)
+		return; // returning to an address pushed by the code itself, a jump not a return
+	while (!frames.empty() && frames.back().sp < sp)
+		Pop(cycles); // return addresses discarded by code, so returning from an outer frame
+	if (!frames.empty() && frames.back().sp == sp)
+		Pop(cycles);
+}
+
+static std::string FrameName(Emu6502* emu, ushort addr)
+{
+	char name[32];
+	const char* region = emu->GetRegionName(addr);
+	if (region != 0)
+		snprintf(name, sizeof(name), "%s:%04X", region, addr);
+	else
+		snprintf(name, sizeof(name), "%04X", addr);
+	return name;
+}
+
+void CallGraph::Report(FILE* out, Emu6502* emu, int top)
+{
+	Charge(emu->GetCycles());
+
+	// frames still active have run since they were called
+	std::vector<unsigned long long> inclusive(inclusive_cycles, inclusive_cycles + address_count);
+	std::vector<bool> counted(address_count, false);
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		ushort addr = nodes[frames[i].node].addr;
+		if (!counted[addr])
+			inclusive[addr] += emu->GetCycles() - frames[i].start_cycles;
+		counted[addr] = true;
+	}
+
+	unsigned long long total_cycles = 0;
+	for (size_t i = 0; i < nodes.size(); ++i)
+		total_cycles += nodes[i].self_cycles;
+	double percent = (total_cycles > 0) ? 100.0 / total_cycles : 0;
+
+	std::vector<int> called;
+	for (int addr = 0; addr < address_count; ++addr)
+		if (calls[addr] != 0)
+			called.push_back(addr);
+	std::sort(called.begin(), called.end(), [&inclusive](int a, int b) { return inclusive[a] > inclusive[b] || (inclusive[a] == inclusive[b] && a < b); });
+
+	fprintf(out, "call graph: %llu cycles, %u subroutines, %u call paths\n", total_cycles, (unsigned)called.size(), (unsigned)nodes.size() - 1);
+	fprintf(out, "\nsubroutines:\n");
+	fprintf(out, "incl%%    inclusive    exclusive        calls region  address\n");
+	for (int i = 0; i < (int)called.size() && i < top; ++i)
+	{
+		int addr = called[i];
+		const char* region = emu->GetRegionName((ushort)addr);
+		fprintf(out, "%6.2f %12llu %12llu %12llu %-7s %04X\n", inclusive[addr] * percent, inclusive[addr], exclusive_cycles[addr], calls[addr], (region != 0) ? region : "", addr);
+	}
+}
+
+void CallGraph::WriteCollapsed(FILE* out, Emu6502* emu)
+{
+	Charge(emu->GetCycles());
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		if (nodes[i].self_cycles == 0)
+			continue;
+		std::string path;
+		for (int node = (int)i; node > 0; node = nodes[node].parent)
+			path = ";" + FrameName(emu, nodes[node].addr) + path;
+		fprintf(out, "top%s %llu\n", path.c_str(), nodes[i].self_cycles);
+	}
+}
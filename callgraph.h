@@ -0,0 +1,64 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <map>
+#include <stdio.h>
+#include <vector>
+
+// Shadow call stack kept by JSR/RTS/BRK/RTI while attached, attributing cycles to
+// subroutine entry addresses and to each distinct call path.
+// Frames are matched by stack pointer, so code that drops return addresses
+// (PLA/PLA, TXS) or uses RTS as a computed jump does not corrupt the stack.
+// Attach before running, cycles are charged from zero.
+class CallGraph
+{
+public:
+	CallGraph();
+	~CallGraph();
+
+	void Call(ushort addr, byte sp, unsigned long long cycles); // after return address pushed
+	void Return(byte sp, unsigned long long cycles); // before return address popped
+	void Clear();
+
+	// subroutines by inclusive cycles, with exclusive cycles and call counts
+	void Report(FILE* out, Emu6502* emu, int top = 25);
+	// one line per call path with its own cycles, "top;KERNAL:FFD2;... cycles", for flame graph tools
+	void WriteCollapsed(FILE* out, Emu6502* emu);
+
+private:
+	struct Node // distinct call path
+	{
+		int parent;
+		ushort addr; // entry address
+		unsigned long long self_cycles;
+		std::map<ushort, int> children;
+
+		Node(int parent, ushort addr) : parent(parent), addr(addr), self_cycles(0) {}
+	};
+
+	struct Frame
+	{
+		int node;
+		byte sp; // S after return address pushed
+		unsigned long long start_cycles;
+	};
+
+	void Charge(unsigned long long cycles); // cycles since last event to current path
+	void Pop(unsigned long long cycles);
+	int Current() { return frames.empty() ? 0 : frames.back().node; }
+
+	std::vector<Node> nodes; // 0 is top level, outside any call
+	std::vector<Frame> frames;
+	unsigned long long last_cycles;
+
+	// per entry address
+	unsigned long long* calls;
+	unsigned long long* inclusive_cycles; // outermost activation only, so recursion is not counted twice
+	unsigned long long* exclusive_cycles;
+	int* active; // activations on shadow stack
+
+private:
+	CallGraph(const CallGraph& other); // disabled
+	bool operator==(const CallGraph& other) const; // disabled
+};
@@ -40,13 +40,7 @@
 #include <windows.h>
 #endif
 
-int supress_first_clear = 1;
-static bool supress_next_home = false;
-
-static unsigned char buffer[256];
-int buffer_head = 0;
-int buffer_tail = 0;
-int buffer_count = 0;
+#include "cbmconsole.h"
 
 #ifdef WINDOWS
 static void cls(HANDLE hConsole);
@@ -56,11 +50,31 @@ static void cls(HANDLE hConsole);
 #define PERR(bSuccess, api){if(!(bSuccess)) printf("%s:Error %d from %s on line %d\n", __FILE__, GetLastError(), api, __LINE__);}
 #endif
 
-static void Console_Clear()
+CBMConsole::CBMConsole()
+{
+   buffer_head = 0;
+   buffer_tail = 0;
+   buffer_count = 0;
+   supress_first_clear = true;
+   supress_next_home = false;
+   reverse_active = false;
+}
+
+CBMConsole::~CBMConsole()
+{
+}
+
+CBMConsole* CBMConsole::Standard()
+{
+   static CBMConsole console;
+   return &console;
+}
+
+void CBMConsole::Clear()
 {
    if (supress_first_clear)
    {
-      supress_first_clear = 0;
+      supress_first_clear = false;
       return;
    }
 
@@ -179,7 +193,7 @@ static void Console_Cursor_Right()
 #endif
 }
 
-static void Console_Cursor_Home()
+void CBMConsole::CursorHome()
 {
     if (supress_next_home)
     {
@@ -196,36 +210,34 @@ static void Console_Cursor_Home()
 #endif
 }
 
-static int ReverseActive = 0;
-
-static void Console_Reverse_On()
+void CBMConsole::ReverseOn()
 {
-   if (!ReverseActive)
+   if (!reverse_active)
    {
       printf("\x1B[7m");
-      ReverseActive = 1;
+      reverse_active = true;
 	}
 }
 
-static void Console_Reverse_Off()
+void CBMConsole::ReverseOff()
 {
-   if (ReverseActive)
+   if (reverse_active)
    {
       printf("\x1B[m");
-      ReverseActive = 0;
+      reverse_active = false;
    }
 }
 
-extern void CBM_Console_WriteChar(unsigned char c, bool supress_next_home)
+void CBMConsole::WriteChar(unsigned char c, bool supress_next_home)
 {
     if (supress_next_home)
-        ::supress_next_home = true;
+        this->supress_next_home = true;
 
    // we're emulating, so draw character on local console window
    if (c == 0x0D)
    {
       putchar('\n');
-      Console_Reverse_Off();
+      ReverseOff();
    }
    else if (c >= ' ' && c <= '~')
    {
@@ -241,17 +253,17 @@ extern void CBM_Console_WriteChar(unsigned char c, bool supress_next_home)
    else if (c == 17) // down
       Console_Cursor_Down();
    else if (c == 19) // home
-      Console_Cursor_Home();
+      CursorHome();
    else if (c == 147)
-      Console_Clear();
+      Clear();
    else if (c == 18)
-      Console_Reverse_On();
+      ReverseOn();
    else if (c == 146)
-      Console_Reverse_Off();
+      ReverseOff();
 }
 
 // blocking read to get next typed character
-extern unsigned char CBM_Console_ReadChar(void)
+unsigned char CBMConsole::ReadChar(void)
 {
    if (buffer_count == 0)
    {
@@ -259,8 +271,13 @@ extern unsigned char CBM_Console_ReadChar(void)
       //ApplyColor ? .Invoke();
       while (1)
       {
-         fgets((char*)& buffer[0], sizeof(buffer) - 1, stdin); // save room for carriage return and null
-         buffer[strlen((char*)buffer)-1] = '\r'; // replace newline
+         if (fgets((char*)& buffer[0], sizeof(buffer) - 1, stdin) == NULL) // save room for carriage return and null
+            buffer[0] = 0; // end of input, as an empty line
+         size_t len = strlen((char*)buffer);
+         if (len > 0 && buffer[len - 1] == '\n')
+            --len;
+         buffer[len] = '\r'; // replace newline
+         buffer[len + 1] = 0;
          buffer_head = 0;
          buffer_tail = buffer_count = (int)strlen((char*)buffer);
          Console_Cursor_Up();
@@ -274,7 +291,7 @@ extern unsigned char CBM_Console_ReadChar(void)
    return c;
 }
 
-extern void CBM_Console_Push(const char* s)
+void CBMConsole::Push(const char* s)
 {
    while (s != 0 && *s != 0 && buffer_count < sizeof(buffer))
    {
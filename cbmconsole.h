@@ -32,6 +32,37 @@
 
 #pragma once
 
-extern void CBM_Console_WriteChar(unsigned char c, bool supress_next_home = false);
-extern unsigned char CBM_Console_ReadChar(void);
-extern void CBM_Console_Push(const char* s);
+// Console state is per instance, so machines on different threads can each have their own.
+// Base class is the terminal (stdin/stdout), derive to redirect input/output.
+class CBMConsole
+{
+public:
+	CBMConsole();
+	virtual ~CBMConsole();
+	virtual void WriteChar(unsigned char c, bool supress_next_home = false);
+	virtual unsigned char ReadChar(void); // blocking read to get next typed character
+	virtual bool EndOfInput() { return false; } // scripted consoles, no more input so machine should stop
+	void Push(const char* s);
+
+	static CBMConsole* Standard(); // shared terminal console for interactive machines
+
+protected:
+	unsigned char buffer[256]; // input ring buffer
+	int buffer_head;
+	int buffer_tail;
+	int buffer_count;
+
+private:
+	void Clear();
+	void CursorHome();
+	void ReverseOn();
+	void ReverseOff();
+
+	bool supress_first_clear;
+	bool supress_next_home;
+	bool reverse_active;
+
+private:
+	CBMConsole(const CBMConsole& other); // disabled
+	bool operator==(const CBMConsole& other) const; // disabled
+};
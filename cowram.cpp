@@ -0,0 +1,107 @@
+// cowram.cpp - Copy-on-write paged RAM
+//
+// RAM as 256 byte pages that forked machines share until one of them writes
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// c-simple-emu-cbm (C++ Portable Version)
+// C64/6502 Emulator for Microsoft Windows Console
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "cowram.h"
+
+#include <string.h>
+
+CowRam::CowRam(int size)
+{
+	page_count = (size + 0xFF) >> 8;
+	blocks = new Block*[page_count];
+	owned = new bool[page_count];
+	for (int i = 0; i < page_count; ++i)
+	{
+		blocks[i] = new Block();
+		blocks[i]->refs = 1;
+		memset(blocks[i]->data, 0, sizeof(blocks[i]->data));
+		owned[i] = true;
+	}
+}
+
+CowRam::CowRam(CowRam* parent)
+{
+	page_count = parent->page_count;
+	blocks = new Block*[page_count];
+	owned = new bool[page_count];
+	for (int i = 0; i < page_count; ++i)
+	{
+		blocks[i] = parent->blocks[i];
+		++blocks[i]->refs;
+		owned[i] = false;
+		parent->owned[i] = false; // parent must copy before writing too
+	}
+}
+
+CowRam::~CowRam()
+{
+	for (int i = 0; i < page_count; ++i)
+		Release(blocks[i]);
+	delete[] blocks;
+	delete[] owned;
+}
+
+void CowRam::Release(Block* block)
+{
+	if (--block->refs == 0)
+		delete block;
+}
+
+bool CowRam::Own(int page)
+{
+	if (owned[page])
+		return false;
+	Block* block = blocks[page];
+	if (block->refs > 1) // otherwise other machines have already let go of it
+	{
+		Block* copy = new Block();
+		copy->refs = 1;
+		memcpy(copy->data, block->data, sizeof(copy->data));
+		blocks[page] = copy;
+		Release(block);
+	}
+	owned[page] = true;
+	return true;
+}
+
+void CowRam::SerializeState(Emu6502::StateIO& io)
+{
+	for (int i = 0; i < page_count; ++i)
+	{
+		if (!io.IsSaving())
+			Own(i);
+		io.Bytes(blocks[i]->data, sizeof(blocks[i]->data));
+	}
+}
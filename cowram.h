@@ -0,0 +1,48 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <atomic>
+
+// RAM as 256 byte pages that forked machines share until one of them writes.
+// Each instance belongs to one machine (one thread), pages are reference counted
+// so parent and children may run and be deleted on different threads.
+// Memory classes map only owned pages for fast path writes, and remap when Write() reports
+// a page became owned, because its host address may have changed.
+class CowRam
+{
+public:
+	CowRam(int size); // zeroed, all pages owned
+	CowRam(CowRam* parent); // shares all of parent's pages, neither owns them afterwards
+	~CowRam();
+
+	int GetSize() { return page_count << 8; }
+	byte* Page(int page) { return blocks[page]->data; } // read only unless IsOwned()
+	bool IsOwned(int page) { return owned[page]; }
+	bool Own(int page); // copy if another machine still shares the page, returns true if newly owned
+	byte Read(int addr) { return blocks[addr >> 8]->data[addr & 0xFF]; }
+	bool Write(int addr, byte value) // returns true if page newly owned, so caller should remap
+	{
+		bool remap = !owned[addr >> 8] && Own(addr >> 8);
+		blocks[addr >> 8]->data[addr & 0xFF] = value;
+		return remap;
+	}
+	void SerializeState(Emu6502::StateIO& io);
+
+private:
+	struct Block
+	{
+		std::atomic<int> refs;
+		byte data[256];
+	};
+
+	static void Release(Block* block);
+
+	int page_count;
+	Block** blocks;
+	bool* owned;
+
+private:
+	CowRam(const CowRam& other); // disabled
+	bool operator==(const CowRam& other) const; // disabled
+};
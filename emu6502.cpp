@@ -39,47 +39,588 @@
 #endif
 
 #include "emu6502.h"
+#include "tracer.h"
+#include "profiler.h"
+#include "callgraph.h"
+#include "basicprofiler.h"
+#include "jit.h"
+#include "romcode.h"
 
-Emu6502::Emu6502(Memory* mem)
+static const unsigned long long no_limit = ~0ULL;
+
+byte* Emu6502::unmapped_pages[256];
+
+// decimal mode ADC/SBC outcome for every carry, A and operand, built once at startup
+// from the digit arithmetic, flags in status register positions (N, V, Z, C)
+struct DecimalEntry
+{
+	byte result;
+	byte flags;
+};
+
+static struct DecimalTables
+{
+	DecimalEntry adc[2][256][256]; // [carry][A][operand]
+	DecimalEntry sbc[2][256][256];
+
+	DecimalTables()
+	{
+		for (int carry = 0; carry < 2; ++carry)
+			for (int a = 0; a < 256; ++a)
+				for (int value = 0; value < 256; ++value)
+				{
+					int A_dec = (a & 0xF) + ((a >> 4) * 10);
+					int value_dec = (value & 0xF) + ((value >> 4) * 10);
+
+					int result_dec = A_dec + value_dec + carry;
+					byte result = (byte)((result_dec % 10) | (((result_dec / 10) % 10) << 4));
+					adc[carry][a][value].result = result;
+					adc[carry][a][value].flags = (byte)((result & 0x80) // N
+						| ((result_dec == 0) ? 0x02 : 0) // BCD quirk -- 100 doesn't set Z
+						| ((result_dec > 99) ? 0x01 : 0)); // V clear
+
+					result_dec = A_dec - value_dec - (carry ? 0 : 1);
+					bool borrow = (result_dec < 0);
+					if (borrow)
+						result_dec += 100; // wrap negative value
+					result = (byte)((result_dec % 10) | (((result_dec / 10) % 10) << 4));
+					sbc[carry][a][value].result = result;
+					sbc[carry][a][value].flags = (byte)(((result == 0) ? 0x02 : 0) // N and V undefined?, clear
+						| (borrow ? 0 : 0x01));
+				}
+	}
+} decimal_tables;
+
+Emu6502::Emu6502(Memory* mem, Engine engine)
 {
 	memory = mem;
+	this->engine = engine;
 	A = 0;
 	X = 0;
 	Y = 0;
 	S = 0xFF;
-	N = false;
+	NZ = 1; // N and Z clear
 	V = false;
 	B = false;
 	D = false;
 	I = false;
-	Z = false;
 	C = false;
 	PC = 0;
 
 	trace = false;
+	tracer = 0;
+	profiler = 0;
+	call_graph = 0;
+	basic_profiler = 0;
 	step = false;
 	quit = false;
+	go_num = 0;
+
+	cycles = 0;
+	instructions = 0;
+
+	cycle_limit = no_limit;
+	instruction_limit = no_limit;
+	run_start_instructions = 0;
+	until_pc = -1;
+	until_predicate = 0;
+	until_context = 0;
+	slow_path = false;
+	debugging = false;
+	stop_reason = StopNone;
+
+	memset(trap_map, 0, sizeof(trap_map));
+	debug_maps = 0;
+	debug_count = 0;
+	watch_count = 0;
+	watch_addr = 0;
+	watch_write = false;
+	watch_pc = 0;
+	watch_hit = false;
+	last_stop = StopNone;
+	watching = false;
+	watch_paused = false;
+	watch_read_pages = 0;
+	watch_write_pages = 0;
+
+	block_cache = 0;
+	jit = 0;
+	memset(code_map, 0, sizeof(code_map));
+	block_page = 0;
+	block_exit = false;
 }
 
 Emu6502::~Emu6502()
 {
+	delete[] debug_maps;
+	delete[] block_cache;
+	delete jit;
 	delete memory;
 }
 
-byte Emu6502::GetMemory(ushort addr)
+Emu6502::Memory::Memory()
+{
+	read_pages = default_read_pages;
+	write_pages = default_write_pages;
+	MapPages(0, 256, 0, 0); // everything through read()/write() until derived class maps pages
+}
+
+Emu6502::StateIO::StateIO()
+{
+	saving = true;
+	failed = false;
+	read_data = 0;
+	read_size = 0;
+	read_offset = 0;
+}
+
+Emu6502::StateIO::StateIO(const byte* data, size_t size)
+{
+	saving = false;
+	failed = false;
+	read_data = data;
+	read_size = size;
+	read_offset = 0;
+}
+
+void Emu6502::StateIO::Bytes(void* p, size_t size)
 {
-	return memory->read(addr);
+	if (saving)
+		data.insert(data.end(), (byte*)p, (byte*)p + size);
+	else if (failed || read_offset + size > read_size)
+		failed = true;
+	else
+	{
+		memcpy(p, &read_data[read_offset], size);
+		read_offset += size;
+	}
 }
 
-void Emu6502::SetMemory(ushort addr, byte value)
+// map count pages to consecutive host memory, 0 maps to read()/write() instead
+void Emu6502::Memory::MapPages(int first_page, int count, byte* read_base, byte* write_base)
 {
-	memory->write(addr, value);
+	for (int i = 0; i < count; ++i)
+	{
+		read_pages[first_page + i] = (read_base != 0) ? read_base + i * 0x100 : 0;
+		write_pages[first_page + i] = (write_base != 0) ? write_base + i * 0x100 : 0;
+	}
 }
 
 void Emu6502::ResetRun()
 {
-	ushort addr = (ushort)((GetMemory(0xFFFC) | (GetMemory(0xFFFD) << 8))); // RESET vector
-	Execute(addr);
+	Reset();
+	StopReason reason;
+	while ((reason = Run()) == StopBreakpoint || reason == StopWatchpoint)
+		PrintDebugStop(reason); // log each hit and continue
+	if (reason == StopInvalidOpcode)
+	{
+		printf("Invalid opcode %02X at %04X", GetMemory(PC), PC);
+		exit(1);
+	}
+}
+
+void Emu6502::Reset()
+{
+	PC = (ushort)((GetMemory(0xFFFC) | (GetMemory(0xFFFD) << 8))); // RESET vector
+}
+
+bool Emu6502::SerializeState(StateIO& io)
+{
+	io.Value(A);
+	io.Value(X);
+	io.Value(Y);
+	io.Value(S);
+	bool N = GetN(); // saved as separate flags
+	bool Z = GetZ();
+	io.Value(N);
+	io.Value(V);
+	io.Value(B);
+	io.Value(D);
+	io.Value(I);
+	io.Value(Z);
+	io.Value(C);
+	SetNZ(N, Z);
+	io.Value(PC);
+	return memory->SerializeState(io);
+}
+
+// CPU registers, counters and settings to a machine just constructed by Fork()
+void Emu6502::ForkState(Emu6502* child)
+{
+	child->A = A;
+	child->X = X;
+	child->Y = Y;
+	child->S = S;
+	child->NZ = NZ;
+	child->V = V;
+	child->B = B;
+	child->D = D;
+	child->I = I;
+	child->C = C;
+	child->PC = PC;
+	child->step = step;
+	child->quit = quit;
+	child->engine = engine;
+	child->cycles = cycles;
+	child->instructions = instructions;
+	child->trace = trace && tracer == 0; // a Tracer has one producer, host may give child its own
+	child->go_num = go_num;
+	memcpy(child->trap_map, trap_map, sizeof(trap_map)); // including any set since construction, e.g. LOAD_TRAP
+	if (debug_maps != 0)
+	{
+		child->debug_maps = new byte[3 * 0x2000];
+		memcpy(child->debug_maps, debug_maps, 3 * 0x2000);
+		child->debug_count = debug_count;
+		child->watch_count = watch_count;
+	}
+}
+
+bool Emu6502::SaveState(std::vector<byte>& state)
+{
+	StateIO io;
+	if (!SerializeState(io))
+		return false;
+	state.swap(io.data);
+	return true;
+}
+
+bool Emu6502::RestoreState(const byte* state, size_t size)
+{
+	StateIO io(state, size);
+	InvalidateBlocks(); // memory replaced wholesale
+	return SerializeState(io) && !io.Failed();
+}
+
+Emu6502::StopReason Emu6502::Run()
+{
+	return RunLimited(no_limit, no_limit, -1, 0, 0);
+}
+
+Emu6502::StopReason Emu6502::RunFor(unsigned long long cycles)
+{
+	return RunLimited(cycles, no_limit, -1, 0, 0);
+}
+
+Emu6502::StopReason Emu6502::RunInstructions(unsigned long long count)
+{
+	return RunLimited(no_limit, count, -1, 0, 0);
+}
+
+Emu6502::StopReason Emu6502::RunUntil(ushort addr)
+{
+	return RunLimited(no_limit, no_limit, addr, 0, 0);
+}
+
+Emu6502::StopReason Emu6502::RunUntil(RunPredicate predicate, void* context)
+{
+	return RunLimited(no_limit, no_limit, -1, predicate, context);
+}
+
+Emu6502::StopReason Emu6502::RunLimited(unsigned long long max_cycles, unsigned long long max_instructions, int until_addr, RunPredicate predicate, void* context)
+{
+	cycle_limit = (max_cycles < no_limit - cycles) ? cycles + max_cycles : no_limit;
+	instruction_limit = (max_instructions < no_limit - instructions) ? instructions + max_instructions : no_limit;
+	run_start_instructions = instructions;
+	until_pc = until_addr;
+	until_predicate = predicate;
+	until_context = context;
+	slow_path = (until_addr >= 0 || predicate != 0 || profiler != 0 || basic_profiler != 0);
+	debugging = (debug_count != 0);
+	watching = (watch_count != 0);
+	stop_reason = StopNone;
+
+	HideMemoryPages();
+	StopReason reason = Execute();
+	ShowMemoryPages();
+	if (profiler != 0)
+		profiler->Stop(cycles);
+	last_stop = reason;
+
+	cycle_limit = no_limit;
+	instruction_limit = no_limit;
+	until_pc = -1;
+	until_predicate = 0;
+	until_context = 0;
+	slow_path = false;
+	debugging = false;
+	watching = false;
+	stop_reason = StopNone;
+	return reason;
+}
+
+bool Emu6502::IsMapped(ushort start, unsigned count)
+{
+	if (count == 0)
+		return true;
+	unsigned pages = (((start & 0xFF) + count - 1) >> 8) + 1;
+	for (unsigned i = 0; i < pages && i < 256; ++i)
+	{
+		int page = ((start >> 8) + i) & 0xFF;
+		if (memory->read_pages[page] == 0 || memory->write_pages[page] == 0)
+			return false;
+	}
+	return true;
+}
+
+bool Emu6502::IsRam(ushort start, unsigned count)
+{
+	if (count == 0)
+		return true;
+	unsigned pages = (((start & 0xFF) + count - 1) >> 8) + 1;
+	for (unsigned i = 0; i < pages && i < 256; ++i)
+	{
+		int page = ((start >> 8) + i) & 0xFF;
+		if (memory->read_pages[page] == 0 || memory->read_pages[page] != memory->write_pages[page])
+			return false;
+	}
+	return true;
+}
+
+bool Emu6502::Overlap(ushort a, unsigned a_count, ushort b, unsigned b_count)
+{
+	// each run of a within one page against each run of b within one page
+	for (unsigned i = 0; i < a_count; )
+	{
+		ushort from_a = (ushort)(a + i);
+		unsigned run_a = 0x100 - (from_a & 0xFF);
+		if (run_a > a_count - i)
+			run_a = a_count - i;
+		for (unsigned j = 0; j < b_count; )
+		{
+			ushort from_b = (ushort)(b + j);
+			unsigned run_b = 0x100 - (from_b & 0xFF);
+			if (run_b > b_count - j)
+				run_b = b_count - j;
+			byte* read_a = memory->read_pages[from_a >> 8];
+			byte* write_a = memory->write_pages[from_a >> 8];
+			byte* read_b = memory->read_pages[from_b >> 8];
+			byte* write_b = memory->write_pages[from_b >> 8];
+			bool same_page = ((from_a >> 8) == (from_b >> 8)
+				|| (read_a == 0) != (write_a == 0) || (read_b == 0) != (write_b == 0) // RAM under ROM, or not copied since a fork, may be anywhere
+				|| (read_a != 0 && (read_a == read_b || read_a == write_b))
+				|| (write_a != 0 && (write_a == read_b || write_a == write_b)));
+			if (same_page && (from_a & 0xFF) < (from_b & 0xFF) + run_b && (from_b & 0xFF) < (from_a & 0xFF) + run_a)
+				return true;
+			j += run_b;
+		}
+		i += run_a;
+	}
+	return false;
+}
+
+byte Emu6502::MoveMemoryDown(ushort dest, ushort src, unsigned count)
+{
+	byte value = 0;
+	if (src + count > 0x10000 || dest + count > 0x10000)
+	{
+		while (count-- > 0) // wraps around memory
+		{
+			value = GetMemory((ushort)(src + count));
+			SetMemory((ushort)(dest + count), value);
+		}
+		return value;
+	}
+	while (count > 0)
+	{
+		// highest run of bytes within one source page and one destination page
+		unsigned src_end = src + count;
+		unsigned dest_end = dest + count;
+		unsigned run = count;
+		if (src_end - ((src_end - 1) & ~0xFF) < run)
+			run = src_end - ((src_end - 1) & ~0xFF);
+		if (dest_end - ((dest_end - 1) & ~0xFF) < run)
+			run = dest_end - ((dest_end - 1) & ~0xFF);
+		count -= run;
+		ushort from = (ushort)(src + count);
+		ushort to = (ushort)(dest + count);
+		byte* read_from = memory->read_pages[from >> 8];
+		byte* write_to = memory->write_pages[to >> 8];
+		bool ram = (read_from != 0 && read_from == memory->write_pages[from >> 8]
+			&& write_to != 0 && write_to == memory->read_pages[to >> 8]);
+		byte* p_from = ram ? &read_from[from & 0xFF] : 0;
+		byte* p_to = ram ? &write_to[to & 0xFF] : 0;
+		if (ram && (p_to >= p_from || p_to + run <= p_from)) // memmove copies as the loop would
+		{
+			value = *p_from;
+			memmove(p_to, p_from, run);
+			for (unsigned i = 0; i < run; ++i)
+			{
+				if (TestBit(code_map, (ushort)(to + i)))
+				{
+					InvalidateBlocks(); // opcode of a decoded block rewritten
+					break;
+				}
+			}
+		}
+		else
+		{
+			for (unsigned i = run; i-- > 0; )
+			{
+				value = GetMemory((ushort)(from + i));
+				SetMemory((ushort)(to + i), value);
+			}
+		}
+	}
+	return value;
+}
+
+void Emu6502::SetTrap(ushort addr)
+{
+	trap_map[addr >> 3] |= (byte)(1 << (addr & 7));
+	InvalidateBlocks(); // decoded blocks may run through addr
+}
+
+void Emu6502::SetAllTraps()
+{
+	memset(trap_map, 0xFF, sizeof(trap_map));
+	InvalidateBlocks();
+}
+
+bool Emu6502::SetBit(byte* map, ushort addr, bool set)
+{
+	if (TestBit(map, addr) == set)
+		return false;
+	map[addr >> 3] ^= (byte)(1 << (addr & 7));
+	return true;
+}
+
+void Emu6502::SetBreakpoint(ushort addr, bool set)
+{
+	if (debug_maps == 0)
+	{
+		if (!set)
+			return;
+		debug_maps = new byte[3 * 0x2000];
+		memset(debug_maps, 0, 3 * 0x2000);
+	}
+	if (SetBit(debug_maps, addr, set))
+		debug_count += set ? 1 : -1;
+}
+
+void Emu6502::SetWatchpoint(ushort addr, bool read, bool write)
+{
+	if (debug_maps == 0)
+	{
+		if (!read && !write)
+			return;
+		debug_maps = new byte[3 * 0x2000];
+		memset(debug_maps, 0, 3 * 0x2000);
+	}
+	if (SetBit(&debug_maps[0x2000], addr, read))
+	{
+		debug_count += read ? 1 : -1;
+		watch_count += read ? 1 : -1;
+	}
+	if (SetBit(&debug_maps[0x4000], addr, write))
+	{
+		debug_count += write ? 1 : -1;
+		watch_count += write ? 1 : -1;
+	}
+}
+
+void Emu6502::ClearDebugPoints()
+{
+	delete[] debug_maps;
+	debug_maps = 0;
+	debug_count = 0;
+	watch_count = 0;
+	watch_hit = false;
+}
+
+// watched access since the last stop, or breakpoint at PC, otherwise StopNone, PrepareExecute() decides
+Emu6502::StopReason Emu6502::CheckDebugPoints()
+{
+	if (watch_hit)
+		return StopWatchpoint;
+	if (TestBit(debug_maps, PC))
+		return StopBreakpoint;
+	return StopNone;
+}
+
+// GetMemory() of a page unmapped while watching: latch if watched, unless fetching the instruction at PC
+byte Emu6502::ReadWatched(ushort addr)
+{
+	byte value = ReadUnwatched(addr);
+	if (!watch_paused && TestBit(&debug_maps[0x2000], addr))
+	{
+		ushort offset = (ushort)(addr - PC);
+		if (offset >= 3 || offset >= InstructionLength((offset == 0) ? value : ReadUnwatched(PC)))
+			LatchWatch(addr, false);
+	}
+	return value;
+}
+
+// SetMemory() of a page unmapped while watching
+void Emu6502::WriteWatched(ushort addr, byte value)
+{
+	if (TestBit(&debug_maps[0x4000], addr))
+		LatchWatch(addr, true);
+	byte* page = watch_write_pages[addr >> 8];
+	if (page != 0)
+		page[addr & 0xFF] = value;
+	else
+	{
+		ShowMemoryPages(); // write() may remap or switch them, e.g. banking
+		memory->write(addr, value);
+		HideMemoryPages();
+	}
+}
+
+// as GetMemory() would with memory's own page tables
+byte Emu6502::ReadUnwatched(ushort addr)
+{
+	byte* page = watch_read_pages[addr >> 8];
+	if (page != 0)
+		return page[addr & 0xFF];
+	ShowMemoryPages();
+	byte value = memory->read(addr);
+	HideMemoryPages();
+	return value;
+}
+
+void Emu6502::LatchWatch(ushort addr, bool write)
+{
+	if (watch_hit && !(write && addr == watch_addr && PC == watch_pc))
+		return; // first since last stop, or its read-modify-write
+	watch_hit = true;
+	watch_addr = addr;
+	watch_write = write;
+	watch_pc = PC;
+}
+
+void Emu6502::ShowMemoryPages()
+{
+	if (watching && memory->read_pages == unmapped_pages)
+	{
+		memory->read_pages = watch_read_pages;
+		memory->write_pages = watch_write_pages;
+	}
+}
+
+void Emu6502::HideMemoryPages()
+{
+	if (watching && memory->read_pages != unmapped_pages)
+	{
+		watch_read_pages = memory->read_pages;
+		watch_write_pages = memory->write_pages;
+		memory->read_pages = memory->write_pages = unmapped_pages;
+	}
+}
+
+void Emu6502::PrintDebugStop(StopReason reason)
+{
+	bool conditional;
+	byte bytes;
+	ushort addr2;
+	char line[27];
+	char dis[13];
+	DisassembleLong((reason == StopWatchpoint) ? watch_pc : PC, &conditional, &bytes, &addr2, dis, sizeof(dis), line, sizeof(line));
+	char state[33];
+	GetDisplayState(state, sizeof(state));
+	if (reason == StopWatchpoint)
+		fprintf(stderr, "watch %s %04X  %-30s%s\n", watch_write ? "write" : "read", watch_addr, line, state);
+	else
+		fprintf(stderr, "break             %-30s%s\n", line, state);
 }
 
 #ifndef WINDOWS
@@ -94,17 +635,31 @@ void strcat_s(char* dest, size_t size, const char* src)
 }
 #endif
 
-void Emu6502::PHP()
+byte Emu6502::GetP()
 {
-	int flags = (N ? 0x80 : 0)
+	return (byte)((GetN() ? 0x80 : 0)
 		| (V ? 0x40 : 0)
 		| 0x20 // reserved, always set
-		| 0x10 // break always set when push
+		| (B ? 0x10 : 0)
 		| (D ? 0x08 : 0)
 		| (I ? 0x04 : 0)
-		| (Z ? 0x02 : 0)
-		| (C ? 0x01 : 0);
-	Push(flags);
+		| (GetZ() ? 0x02 : 0)
+		| (C ? 0x01 : 0));
+}
+
+void Emu6502::SetP(byte flags)
+{
+	SetNZ((flags & 0x80) != 0, (flags & 0x02) != 0);
+	V = (flags & 0x40) != 0;
+	B = (flags & 0x10) != 0;
+	D = (flags & 0x08) != 0;
+	I = (flags & 0x04) != 0;
+	C = (flags & 0x01) != 0;
+}
+
+void Emu6502::PHP()
+{
+	Push(GetP() | 0x10); // break always set when push
 }
 
 byte Emu6502::LO(ushort value)
@@ -122,9 +677,8 @@ byte Emu6502::Subtract(byte reg, byte value, bool *p_overflow)
 	bool old_reg_neg = (reg & 0x80) != 0;
 	bool value_neg = (value & 0x80) != 0;
 	int result = reg - value - (C ? 0 : 1);
-	N = (result & 0x80) != 0;
+	NZ = (byte)result;
 	C = (result >= 0);
-	Z = (result == 0);
 	bool result_neg = (result & 0x80) != 0;
 	*p_overflow = (old_reg_neg && !value_neg && !result_neg) // neg - pos = pos
 		|| (!old_reg_neg && value_neg && result_neg); // pos - neg = neg
@@ -156,8 +710,7 @@ void Emu6502::CPY(byte value)
 void Emu6502::SetReg(byte *p_reg, int value)
 {
 	*p_reg = (byte)value;
-	Z = (*p_reg == 0);
-	N = ((*p_reg & 0x80) != 0);
+	NZ = *p_reg;
 }
 
 void Emu6502::SetA(int value)
@@ -179,16 +732,11 @@ void Emu6502::SBC(byte value)
 {
 	if (D)
 	{
-		int A_dec = (A & 0xF) + ((A >> 4) * 10);
-		int value_dec = (value & 0xF) + ((value >> 4) * 10);
-		int result_dec = A_dec - value_dec - (C ? 0 : 1);
-		C = (result_dec >= 0);
-		if (!C)
-			result_dec += 100; // wrap negative value
-		int result = (result_dec % 10) | (((result_dec / 10) % 10) << 4);
-		SetA(result);
-		N = false; // undefined?
-		V = false; // undefined?
+		const DecimalEntry& entry = decimal_tables.sbc[C ? 1 : 0][A][value];
+		A = entry.result;
+		SetNZ((entry.flags & 0x80) != 0, (entry.flags & 0x02) != 0);
+		V = (entry.flags & 0x40) != 0;
+		C = (entry.flags & 0x01) != 0;
 	}
 	else
 	{
@@ -199,20 +747,17 @@ void Emu6502::SBC(byte value)
 
 void Emu6502::ADC(byte value)
 {
-	int result;
 	if (D)
 	{
-		int A_dec = (A & 0xF) + ((A >> 4) * 10);
-		int value_dec = (value & 0xF) + ((value >> 4) * 10);
-		int result_dec = A_dec + value_dec + (C ? 1 : 0);
-		C = (result_dec > 99);
-		result = (result_dec % 10) | (((result_dec / 10) % 10) << 4);
-		SetA(result);
-		Z = (result_dec == 0); // BCD quirk -- 100 doesn't set Z
-		V = false;
+		const DecimalEntry& entry = decimal_tables.adc[C ? 1 : 0][A][value];
+		A = entry.result;
+		SetNZ((entry.flags & 0x80) != 0, (entry.flags & 0x02) != 0);
+		V = (entry.flags & 0x40) != 0;
+		C = (entry.flags & 0x01) != 0;
 	}
 	else
 	{
+		int result;
 		bool A_old_neg = (A & 0x80) != 0;
 		bool value_neg = (value & 0x80) != 0;
 		result = A + value + (C ? 1 : 0);
@@ -241,8 +786,7 @@ void Emu6502::AND(int value)
 
 void Emu6502::BIT(byte value)
 {
-	Z = (A & value) == 0;
-	N = (value & 0x80) != 0;
+	SetNZ((value & 0x80) != 0, (A & value) == 0);
 	V = (value & 0x40) != 0;
 }
 
@@ -250,8 +794,7 @@ byte Emu6502::ASL(int value)
 {
 	C = (value & 0x80) != 0;
 	value = (byte)(value << 1);
-	Z = (value == 0);
-	N = (value & 0x80) != 0;
+	NZ = (ushort)value;
 	return (byte)value;
 }
 
@@ -259,8 +802,7 @@ byte Emu6502::LSR(int value)
 {
 	C = (value & 0x01) != 0;
 	value = (byte)(value >> 1);
-	Z = (value == 0);
-	N = false;
+	NZ = (ushort)value; // N clear
 	return (byte)value;
 }
 
@@ -269,18 +811,16 @@ byte Emu6502::ROL(int value)
 	bool newC = (value & 0x80) != 0;
 	value = (byte)((value << 1) | (C ? 1 : 0));
 	C = newC;
-	Z = (value == 0);
-	N = (value & 0x80) != 0;
+	NZ = (ushort)value;
 	return (byte)value;
 }
 
 byte Emu6502::ROR(int value)
 {
 	bool newC = (value & 0x01) != 0;
-	N = C;
 	value = (byte)((value >> 1) | (C ? 0x80 : 0));
 	C = newC;
-	Z = (value == 0);
+	NZ = (ushort)value; // N is old C
 	return (byte)value;
 }
 
@@ -296,14 +836,7 @@ byte Emu6502::Pop(void)
 
 void Emu6502::PLP()
 {
-	int flags = Pop();
-	N = (flags & 0x80) != 0;
-	V = (flags & 0x40) != 0;
-	B = (flags & 0x10) != 0;
-	D = (flags & 0x08) != 0;
-	I = (flags & 0x04) != 0;
-	Z = (flags & 0x02) != 0;
-	C = (flags & 0x01) != 0;
+	SetP(Pop());
 }
 
 void Emu6502::PHA()
@@ -354,8 +887,7 @@ void Emu6502::SEI()
 byte Emu6502::INC(byte value)
 {
 	++value;
-	Z = (value == 0);
-	N = (value & 0x80) != 0;
+	NZ = value;
 	return (byte)value;
 }
 
@@ -372,8 +904,7 @@ void Emu6502::INY()
 byte Emu6502::DEC(byte value)
 {
 	--value;
-	Z = (value == 0);
-	N = (value & 0x80) != 0;
+	NZ = value;
 	return (byte)value;
 }
 
@@ -435,6 +966,7 @@ void Emu6502::BR(bool branch, ushort *p_addr, bool *p_conditional, byte *p_bytes
 	ushort addr2 = GetBR(*p_addr, p_conditional, p_bytes);
 	if (branch)
 	{
+		cycles += ((((*p_addr + 2) ^ addr2) & 0xFF00) != 0) ? 2 : 1; // taken, and to another page
 		*p_addr = addr2;
 		*p_bytes = 0; // don't advance addr
 	}
@@ -442,12 +974,12 @@ void Emu6502::BR(bool branch, ushort *p_addr, bool *p_conditional, byte *p_bytes
 
 void Emu6502::BPL(ushort *p_addr, bool *p_conditional, byte *p_bytes)
 {
-	BR(!N, p_addr, p_conditional, p_bytes);
+	BR(!GetN(), p_addr, p_conditional, p_bytes);
 }
 
 void Emu6502::BMI(ushort *p_addr, bool *p_conditional, byte *p_bytes)
 {
-	BR(N, p_addr, p_conditional, p_bytes);
+	BR(GetN(), p_addr, p_conditional, p_bytes);
 }
 
 void Emu6502::BCC(ushort *p_addr, bool *p_conditional, byte *p_bytes)
@@ -472,12 +1004,12 @@ void Emu6502::BVS(ushort *p_addr, bool *p_conditional, byte *p_bytes)
 
 void Emu6502::BNE(ushort *p_addr, bool *p_conditional, byte *p_bytes)
 {
-	BR(!Z, p_addr, p_conditional, p_bytes);
+	BR(!GetZ(), p_addr, p_conditional, p_bytes);
 }
 
 void Emu6502::BEQ(ushort *p_addr, bool *p_conditional, byte *p_bytes)
 {
-	BR(Z, p_addr, p_conditional, p_bytes);
+	BR(GetZ(), p_addr, p_conditional, p_bytes);
 }
 
 void Emu6502::JSR(ushort *p_addr, byte *p_bytes)
@@ -489,10 +1021,14 @@ void Emu6502::JSR(ushort *p_addr, byte *p_bytes)
 	Push(LO(addr2));
 	*p_addr = addr3;
 	*p_bytes = 0; // addr already changed
+	if (call_graph != 0)
+		call_graph->Call(addr3, S, cycles);
 }
 
 void Emu6502::RTS(ushort *p_addr, byte *p_bytes)
 {
+	if (call_graph != 0)
+		call_graph->Return(S, cycles);
 	byte lo = Pop();
 	byte hi = Pop();
 	*p_addr = (ushort)(((hi << 8) | lo) + 1);
@@ -501,6 +1037,8 @@ void Emu6502::RTS(ushort *p_addr, byte *p_bytes)
 
 void Emu6502::RTI(ushort *p_addr, byte *p_bytes)
 {
+	if (call_graph != 0)
+		call_graph->Return(S, cycles);
 	PLP();
 	byte lo = Pop();
 	byte hi = Pop();
@@ -519,6 +1057,8 @@ void Emu6502::BRK(byte *p_bytes)
 	I = true;
 	PC = (ushort)(GetMemory(0xFFFE) + (GetMemory(0xFFFF) << 8)); // JMP(IRQ)
 	*p_bytes = 0;
+	if (call_graph != 0)
+		call_graph->Call(PC, S, cycles);
 }
 
 void Emu6502::JMP(ushort *p_addr, byte *p_bytes)
@@ -548,12 +1088,12 @@ void Emu6502::GetDisplayState(char *state, int state_size)
 		X,
 		Y,
 		S,
-		N ? 'N' : ' ',
+		GetN() ? 'N' : ' ',
 		V ? 'V' : ' ',
 		B ? 'B' : ' ',
 		D ? 'D' : ' ',
 		I ? 'I' : ' ',
-		Z ? 'Z' : ' ',
+		GetZ() ? 'Z' : ' ',
 		C ? 'C' : ' '
 	);
 }
@@ -579,6 +1119,8 @@ byte Emu6502::GetIndY(ushort addr, byte *p_bytes)
 	*p_bytes = 2;
 	ushort addr2 = (ushort)(GetMemory((ushort)(addr + 1)));
 	ushort addr3 = (ushort)((GetMemory(addr2) | (GetMemory((ushort)(addr2 + 1)) << 8)) + Y);
+	if (((addr3 - Y) ^ addr3) & 0xFF00)
+		++cycles; // page crossing
 	return GetMemory(addr3);
 }
 
@@ -650,7 +1192,10 @@ byte Emu6502::GetABSX(ushort addr, byte *p_bytes)
 {
 	*p_bytes = 3;
 	ushort addr2 = (ushort)(GetMemory((ushort)(addr + 1)) | (GetMemory((ushort)(addr + 2)) << 8));
-	return GetMemory((ushort)(addr2 + X));
+	ushort addr3 = (ushort)(addr2 + X);
+	if ((addr2 ^ addr3) & 0xFF00)
+		++cycles; // page crossing
+	return GetMemory(addr3);
 }
 
 void Emu6502::SetABSX(byte value, ushort addr, byte *p_bytes)
@@ -664,7 +1209,10 @@ byte Emu6502::GetABSY(ushort addr, byte *p_bytes)
 {
 	*p_bytes = 3;
 	ushort addr2 = (ushort)(GetMemory((ushort)(addr + 1)) | (GetMemory((ushort)(addr + 2)) << 8));
-	return GetMemory((ushort)(addr2 + Y));
+	ushort addr3 = (ushort)(addr2 + Y);
+	if ((addr2 ^ addr3) & 0xFF00)
+		++cycles; // page crossing
+	return GetMemory(addr3);
 }
 
 void Emu6502::SetABSY(byte value, ushort addr, byte *p_bytes)
@@ -680,48 +1228,197 @@ byte Emu6502::GetIM(ushort addr, byte *p_bytes)
 	return GetMemory((ushort)(addr + 1));
 }
 
-void Emu6502::Execute(ushort addr)
+// runs from PC until PrepareExecute() or an invalid opcode stops it
+Emu6502::StopReason Emu6502::Execute()
+{
+	if (engine == SwitchEngine)
+		ExecuteSwitch();
+	else if (debugging)
+		ExecuteTable<true, false>();
+	else if ((engine == BlockEngine || engine == JitEngine || engine == RomEngine) && !slow_path)
+		ExecuteTable<false, true>(); // checks only between blocks
+	else
+		ExecuteTable<false, false>(); // no debug checks compiled in
+	return stop_reason;
+}
+
+// bytes in a valid instruction, from the regular opcode layout aaabbbcc
+int Emu6502::InstructionLength(byte opcode)
+{
+	int bbb = (opcode >> 2) & 7;
+	int cc = opcode & 3;
+	if (bbb == 3 || bbb == 7 || (bbb == 6 && cc == 1) || opcode == 0x20/*JSR*/)
+		return 3;
+	if (bbb == 1 || bbb == 4 || bbb == 5 || (cc == 1 && (bbb == 0 || bbb == 2)) || (bbb == 0 && opcode >= 0xA0))
+		return 2;
+	return 1;
+}
+
+// branches, jumps, subroutine calls and returns
+bool Emu6502::EndsBlock(byte opcode)
+{
+	return (opcode & 0x1F) == 0x10 || opcode == 0x00 || opcode == 0x20 || opcode == 0x40 || opcode == 0x60 || opcode == 0x4C || opcode == 0x6C;
+}
+
+// decoded instructions at PC to run without checks in between, false to run one instruction from memory
+// instead, e.g. I/O page, tracing, or a limit would be reached within the block
+// true with *p_op == *p_end if the block already ran translated
+bool Emu6502::EnterBlock(const BlockOp** p_op, const BlockOp** p_end)
+{
+	const byte* page = memory->read_pages[PC >> 8];
+	if (page == 0 || trace || step)
+		return false;
+	if (block_cache == 0)
+	{
+		block_cache = new Block[block_slots];
+		for (int i = 0; i < block_slots; ++i)
+			block_cache[i].page = 0;
+	}
+	Block* block = &block_cache[(PC ^ (PC >> 11)) & (block_slots - 1)];
+	if (block->page != page || block->pc != PC)
+		DecodeBlock(block, page);
+	if (block->count == 0 || instructions + block->count > instruction_limit || cycles + block->max_cycles > cycle_limit)
+		return false;
+	block_page = page;
+	block_exit = false;
+	if (engine == JitEngine && block->code == 0 && ++block->hits == jit_threshold)
+	{
+		if (jit == 0)
+			jit = new Jit(this);
+		block->code = jit->Compile(PC, page, block->ops, block->count);
+		if (block->code == 0 && jit->IsAvailable())
+		{
+			InvalidateBlocks(); // buffer full, start over
+			return false;
+		}
+	}
+	if (block->code != 0)
+	{
+		block->code(this);
+		*p_op = *p_end = 0;
+		return true;
+	}
+	*p_op = block->ops;
+	*p_end = &block->ops[block->count];
+	return true;
+}
+
+void Emu6502::DecodeBlock(Block* block, const byte* page)
+{
+	block->page = page;
+	block->pc = PC;
+	block->count = 0;
+	block->max_cycles = 0;
+	block->hits = 0;
+	block->code = 0;
+
+	// ROM is never written, but RAM may also be mapped at other addresses, e.g. mirrored
+	int aliases[256];
+	int alias_count = 0;
+	if (memory->write_pages[PC >> 8] == 0 || memory->write_pages[PC >> 8] == page)
+	{
+		for (int i = 0; i < 256; ++i)
+			if (memory->read_pages[i] == page || memory->write_pages[i] == page)
+				aliases[alias_count++] = i;
+	}
+
+	ushort addr = PC;
+	while (block->count < max_block_ops)
+	{
+		byte opcode = page[addr & 0xFF];
+		if (op_table[opcode] == &Emu6502::OpInvalid)
+			break;
+		BlockOp& op = block->ops[block->count++];
+		op.opcode = opcode;
+		op.cycles = cycle_table[opcode];
+		block->max_cycles += cycle_table[opcode] + 2; // branch taken to another page, or page crossed
+		for (int i = 0; i < alias_count; ++i)
+			SetBit(code_map, (ushort)((aliases[i] << 8) | (addr & 0xFF)), true);
+		if (EndsBlock(opcode))
+			break;
+		addr = (ushort)(addr + InstructionLength(opcode));
+		if ((addr >> 8) != (PC >> 8) || TestBit(trap_map, addr))
+			break; // next opcode not in this page, or ExecutePatch() must see it
+	}
+
+	if (engine == RomEngine && block->count > 0)
+	{
+		block->code = RomCode::Find(PC, page, block->count);
+		if (block->code != 0) // operands are constants in translated code, so writing any byte invalidates
+		{
+			int length = 0;
+			for (int i = 0; i < block->count; ++i)
+				length += InstructionLength(block->ops[i].opcode);
+			for (int i = 0; i < alias_count; ++i)
+				for (int offset = 0; offset < length; ++offset)
+					SetBit(code_map, (ushort)((aliases[i] << 8) | ((PC + offset) & 0xFF)), true);
+		}
+	}
+}
+
+// opcode in a decoded block overwritten, or traps changed, so decode again as reached
+void Emu6502::InvalidateBlocks()
+{
+	if (block_cache != 0)
+		for (int i = 0; i < block_slots; ++i)
+			block_cache[i].page = 0;
+	memset(code_map, 0, sizeof(code_map));
+	if (jit != 0)
+		jit->Clear();
+	block_exit = true;
+}
+
+void Emu6502::TraceInstruction()
 {
+	if (tracer != 0)
+	{
+		TraceRecord record;
+		record.cycles = cycles;
+		record.pc = PC;
+		for (int i = 0; i < 3; ++i)
+			record.bytes[i] = GetMemory((ushort)(PC + i));
+		record.a = A;
+		record.x = X;
+		record.y = Y;
+		record.s = S;
+		record.p = GetP();
+		tracer->Record(record);
+		return;
+	}
+
 	bool conditional;
 	byte bytes;
+	ushort addr2;
+	char line[27];
+	char dis[13];
+	DisassembleLong(PC, &conditional, &bytes, &addr2, dis, sizeof(dis), line, sizeof(line));
+	char state[33];
+	GetDisplayState(state, sizeof(state));
+	char full_line[80];
+	snprintf(full_line, sizeof(full_line), "%-30s%s\n", line, state);
+#ifdef WINDOWS
+	OutputDebugStringA(full_line);
+#else
+	fprintf(stderr, "%s", full_line);
+#endif
+}
 
-	PC = addr;
-	bool breakpoint = false;
+void Emu6502::ExecuteSwitch()
+{
+	bool conditional;
+	byte bytes;
 
 	while (true)
 	{
-		while (true)
-		{
-			if (quit)
-				return;
-			bytes = 1;
-			//if (Breakpoints.Contains(PC))
-			//	breakpoint = true;
-			if (trace || breakpoint || step)
-			{
-				ushort addr2;
-				char line[27];
-				char dis[13];
-				DisassembleLong(PC, &conditional, &bytes, &addr2, dis, sizeof(dis), line, sizeof(line));
-				char state[33];
-				GetDisplayState(state, sizeof(state));
-				char full_line[80];
-				snprintf(full_line, sizeof(full_line), "%-30s%s\n", line, state);
-#ifdef WINDOWS
-				OutputDebugStringA(full_line);
-#else				
-				fprintf(stderr, "%s", full_line);
-#endif				
-				if (step)
-					step = step; // user can put debug breakpoint here to allow stepping
-				if (breakpoint)
-					breakpoint = breakpoint; // user can put debug breakpoint here to allow break;
-			}
-			if (!ExecutePatch()) // allow execute to be overriden at a specific address
-				break;
-		}
+		if (!PrepareExecute())
+			return;
+		bytes = 1;
+
+		byte opcode = GetMemory(PC);
+		cycles += cycle_table[opcode];
+		++instructions;
 
-		switch (GetMemory(PC))
+		switch (opcode)
 		{
 		case 0x00: BRK(&bytes); break;
 		case 0x01: ORA(GetIndX(PC, &bytes)); break;
@@ -740,7 +1437,7 @@ void Emu6502::Execute(ushort addr)
 		case 0x18: CLC(); break;
 		case 0x19: ORA(GetABSY(PC, &bytes)); break;
 		case 0x1D: ORA(GetABSX(PC, &bytes)); break;
-		case 0x1E: SetABSX(ASL(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0x1E: SetABSX(ASL(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		case 0x20: JSR(&PC, &bytes); break;
 		case 0x21: AND(GetIndX(PC, &bytes)); break;
@@ -761,7 +1458,7 @@ void Emu6502::Execute(ushort addr)
 		case 0x38: SEC(); break;
 		case 0x39: AND(GetABSY(PC, &bytes)); break;
 		case 0x3D: AND(GetABSX(PC, &bytes)); break;
-		case 0x3E: SetABSX(ROL(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0x3E: SetABSX(ROL(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		case 0x40: RTI(&PC, &bytes); break;
 		case 0x41: EOR(GetIndX(PC, &bytes)); break;
@@ -781,7 +1478,7 @@ void Emu6502::Execute(ushort addr)
 		case 0x58: CLI(); break;
 		case 0x59: EOR(GetABSY(PC, &bytes)); break;
 		case 0x5D: EOR(GetABSX(PC, &bytes)); break;
-		case 0x5E: SetABSX(LSR(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0x5E: SetABSX(LSR(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		case 0x60: RTS(&PC, &bytes); break;
 		case 0x61: ADC(GetIndX(PC, &bytes)); break;
@@ -801,7 +1498,7 @@ void Emu6502::Execute(ushort addr)
 		case 0x78: SEI(); break;
 		case 0x79: ADC(GetABSY(PC, &bytes)); break;
 		case 0x7D: ADC(GetABSX(PC, &bytes)); break;
-		case 0x7E: SetABSX(ROR(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0x7E: SetABSX(ROR(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		case 0x81: SetIndX(A, PC, &bytes); break;
 		case 0x84: SetZP(Y, PC, &bytes); break;
@@ -867,7 +1564,7 @@ void Emu6502::Execute(ushort addr)
 		case 0xD8: CLD(); break;
 		case 0xD9: CMP(GetABSY(PC, &bytes)); break;
 		case 0xDD: CMP(GetABSX(PC, &bytes)); break;
-		case 0xDE: SetABSX(DEC(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0xDE: SetABSX(DEC(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		case 0xE0: CPX(GetIM(PC, &bytes)); break;
 		case 0xE1: SBC(GetIndX(PC, &bytes)); break;
@@ -888,19 +1585,1440 @@ void Emu6502::Execute(ushort addr)
 		case 0xF8: SED(); break;
 		case 0xF9: SBC(GetABSY(PC, &bytes)); break;
 		case 0xFD: SBC(GetABSX(PC, &bytes)); break;
-		case 0xFE: SetABSX(INC(GetABSX(PC, &bytes)), PC, &bytes); break;
+		case 0xFE: SetABSX(INC(GetMemory(AddrABSX())), PC, &bytes); break; // read-modify-write, no page crossing penalty
 
 		default:
-			{
-				printf("Invalid opcode %02X at %04X", GetMemory(PC), PC);
-				exit(1);
-			}
+			--instructions; // not executed
+			stop_reason = StopInvalidOpcode;
+			return;
 		}
 
 		PC += bytes;
 	}
 }
 
+// Table engine: same instruction semantics as ExecuteSwitch(), but each opcode
+// has its own handler that decodes its operand and advances PC, so there is no
+// bytes/conditional bookkeeping per instruction.  GCC/Clang use threaded
+// dispatch (computed goto) so every handler has its own indirect branch to the
+// next one, other compilers call through op_table[].  The debug instance also
+// checks breakpoints and watchpoints before each instruction.
+template <bool debug, bool blocks> void Emu6502::ExecuteTable()
+{
+#if defined(__GNUC__)
+	static void* const labels[256] =
+	{
+		/* 00 */ &&L_BRK, &&L_ORAIndX, &&L_Invalid, &&L_Invalid,
+		/* 04 */ &&L_Invalid, &&L_ORAZP, &&L_ASLZP, &&L_Invalid,
+		/* 08 */ &&L_PHP, &&L_ORAIM, &&L_ASLA, &&L_Invalid,
+		/* 0C */ &&L_Invalid, &&L_ORAABS, &&L_ASLABS, &&L_Invalid,
+		/* 10 */ &&L_BPL, &&L_ORAIndY, &&L_Invalid, &&L_Invalid,
+		/* 14 */ &&L_Invalid, &&L_ORAZPX, &&L_ASLZPX, &&L_Invalid,
+		/* 18 */ &&L_CLC, &&L_ORAABSY, &&L_Invalid, &&L_Invalid,
+		/* 1C */ &&L_Invalid, &&L_ORAABSX, &&L_ASLABSX, &&L_Invalid,
+		/* 20 */ &&L_JSR, &&L_ANDIndX, &&L_Invalid, &&L_Invalid,
+		/* 24 */ &&L_BITZP, &&L_ANDZP, &&L_ROLZP, &&L_Invalid,
+		/* 28 */ &&L_PLP, &&L_ANDIM, &&L_ROLA, &&L_Invalid,
+		/* 2C */ &&L_BITABS, &&L_ANDABS, &&L_ROLABS, &&L_Invalid,
+		/* 30 */ &&L_BMI, &&L_ANDIndY, &&L_Invalid, &&L_Invalid,
+		/* 34 */ &&L_Invalid, &&L_ANDZPX, &&L_ROLZPX, &&L_Invalid,
+		/* 38 */ &&L_SEC, &&L_ANDABSY, &&L_Invalid, &&L_Invalid,
+		/* 3C */ &&L_Invalid, &&L_ANDABSX, &&L_ROLABSX, &&L_Invalid,
+		/* 40 */ &&L_RTI, &&L_EORIndX, &&L_Invalid, &&L_Invalid,
+		/* 44 */ &&L_Invalid, &&L_EORZP, &&L_LSRZP, &&L_Invalid,
+		/* 48 */ &&L_PHA, &&L_EORIM, &&L_LSRA, &&L_Invalid,
+		/* 4C */ &&L_JMP, &&L_EORABS, &&L_LSRABS, &&L_Invalid,
+		/* 50 */ &&L_BVC, &&L_EORIndY, &&L_Invalid, &&L_Invalid,
+		/* 54 */ &&L_Invalid, &&L_EORZPX, &&L_LSRZPX, &&L_Invalid,
+		/* 58 */ &&L_CLI, &&L_EORABSY, &&L_Invalid, &&L_Invalid,
+		/* 5C */ &&L_Invalid, &&L_EORABSX, &&L_LSRABSX, &&L_Invalid,
+		/* 60 */ &&L_RTS, &&L_ADCIndX, &&L_Invalid, &&L_Invalid,
+		/* 64 */ &&L_Invalid, &&L_ADCZP, &&L_RORZP, &&L_Invalid,
+		/* 68 */ &&L_PLA, &&L_ADCIM, &&L_RORA, &&L_Invalid,
+		/* 6C */ &&L_JMPIND, &&L_ADCABS, &&L_RORABS, &&L_Invalid,
+		/* 70 */ &&L_BVS, &&L_ADCIndY, &&L_Invalid, &&L_Invalid,
+		/* 74 */ &&L_Invalid, &&L_ADCZPX, &&L_RORZPX, &&L_Invalid,
+		/* 78 */ &&L_SEI, &&L_ADCABSY, &&L_Invalid, &&L_Invalid,
+		/* 7C */ &&L_Invalid, &&L_ADCABSX, &&L_RORABSX, &&L_Invalid,
+		/* 80 */ &&L_Invalid, &&L_STAIndX, &&L_Invalid, &&L_Invalid,
+		/* 84 */ &&L_STYZP, &&L_STAZP, &&L_STXZP, &&L_Invalid,
+		/* 88 */ &&L_DEY, &&L_Invalid, &&L_TXA, &&L_Invalid,
+		/* 8C */ &&L_STYABS, &&L_STAABS, &&L_STXABS, &&L_Invalid,
+		/* 90 */ &&L_BCC, &&L_STAIndY, &&L_Invalid, &&L_Invalid,
+		/* 94 */ &&L_STYZPX, &&L_STAZPX, &&L_STXZPY, &&L_Invalid,
+		/* 98 */ &&L_TYA, &&L_STAABSY, &&L_TXS, &&L_Invalid,
+		/* 9C */ &&L_Invalid, &&L_STAABSX, &&L_Invalid, &&L_Invalid,
+		/* A0 */ &&L_LDYIM, &&L_LDAIndX, &&L_LDXIM, &&L_Invalid,
+		/* A4 */ &&L_LDYZP, &&L_LDAZP, &&L_LDXZP, &&L_Invalid,
+		/* A8 */ &&L_TAY, &&L_LDAIM, &&L_TAX, &&L_Invalid,
+		/* AC */ &&L_LDYABS, &&L_LDAABS, &&L_LDXABS, &&L_Invalid,
+		/* B0 */ &&L_BCS, &&L_LDAIndY, &&L_Invalid, &&L_Invalid,
+		/* B4 */ &&L_LDYZPX, &&L_LDAZPX, &&L_LDXZPY, &&L_Invalid,
+		/* B8 */ &&L_CLV, &&L_LDAABSY, &&L_TSX, &&L_Invalid,
+		/* BC */ &&L_LDYABSX, &&L_LDAABSX, &&L_LDXABSY, &&L_Invalid,
+		/* C0 */ &&L_CPYIM, &&L_CMPIndX, &&L_Invalid, &&L_Invalid,
+		/* C4 */ &&L_CPYZP, &&L_CMPZP, &&L_DECZP, &&L_Invalid,
+		/* C8 */ &&L_INY, &&L_CMPIM, &&L_DEX, &&L_Invalid,
+		/* CC */ &&L_CPYABS, &&L_CMPABS, &&L_DECABS, &&L_Invalid,
+		/* D0 */ &&L_BNE, &&L_CMPIndY, &&L_Invalid, &&L_Invalid,
+		/* D4 */ &&L_Invalid, &&L_CMPZPX, &&L_DECZPX, &&L_Invalid,
+		/* D8 */ &&L_CLD, &&L_CMPABSY, &&L_Invalid, &&L_Invalid,
+		/* DC */ &&L_Invalid, &&L_CMPABSX, &&L_DECABSX, &&L_Invalid,
+		/* E0 */ &&L_CPXIM, &&L_SBCIndX, &&L_Invalid, &&L_Invalid,
+		/* E4 */ &&L_CPXZP, &&L_SBCZP, &&L_INCZP, &&L_Invalid,
+		/* E8 */ &&L_INX, &&L_SBCIM, &&L_NOP, &&L_Invalid,
+		/* EC */ &&L_CPXABS, &&L_SBCABS, &&L_INCABS, &&L_Invalid,
+		/* F0 */ &&L_BEQ, &&L_SBCIndY, &&L_Invalid, &&L_Invalid,
+		/* F4 */ &&L_Invalid, &&L_SBCZPX, &&L_INCZPX, &&L_Invalid,
+		/* F8 */ &&L_SED, &&L_SBCABSY, &&L_Invalid, &&L_Invalid,
+		/* FC */ &&L_Invalid, &&L_SBCABSX, &&L_INCABSX, &&L_Invalid
+	};
+
+	// common case inline: next op of current block, or not quitting/tracing and no trap at PC
+#define DISPATCH() { if (blocks) { if (op != op_end && !block_exit) { opcode = op->opcode; cycles += op->cycles; ++op; ++instructions; goto *labels[opcode]; } goto L_Block; } \
+	if ((quit || trace || step || slow_path || cycles >= cycle_limit || instructions >= instruction_limit || (debug && CheckDebugPoints() != StopNone) || (TestBit(trap_map, PC) && ExecutePatch())) && !PrepareExecute()) return; \
+	opcode = GetMemory(PC); cycles += cycle_table[opcode]; ++instructions; goto *labels[opcode]; }
+	byte opcode;
+	const BlockOp* op = 0;
+	const BlockOp* op_end = 0;
+L_Block: // between blocks, shared so translated code can loop back here
+	if ((quit || trace || step || slow_path || cycles >= cycle_limit || instructions >= instruction_limit || (debug && CheckDebugPoints() != StopNone) || (TestBit(trap_map, PC) && ExecutePatch())) && !PrepareExecute())
+		return;
+	if (blocks && EnterBlock(&op, &op_end))
+	{
+		if (op == op_end)
+			goto L_Block; // ran translated
+		opcode = op->opcode; cycles += op->cycles; ++op;
+	}
+	else
+	{
+		opcode = GetMemory(PC); cycles += cycle_table[opcode];
+	}
+	++instructions; goto *labels[opcode];
+L_BRK: OpBRK(); DISPATCH();
+L_ORAIndX: OpORAIndX(); DISPATCH();
+L_Invalid: OpInvalid(); return;
+L_ORAZP: OpORAZP(); DISPATCH();
+L_ASLZP: OpASLZP(); DISPATCH();
+L_PHP: OpPHP(); DISPATCH();
+L_ORAIM: OpORAIM(); DISPATCH();
+L_ASLA: OpASLA(); DISPATCH();
+L_ORAABS: OpORAABS(); DISPATCH();
+L_ASLABS: OpASLABS(); DISPATCH();
+L_BPL: OpBPL(); DISPATCH();
+L_ORAIndY: OpORAIndY(); DISPATCH();
+L_ORAZPX: OpORAZPX(); DISPATCH();
+L_ASLZPX: OpASLZPX(); DISPATCH();
+L_CLC: OpCLC(); DISPATCH();
+L_ORAABSY: OpORAABSY(); DISPATCH();
+L_ORAABSX: OpORAABSX(); DISPATCH();
+L_ASLABSX: OpASLABSX(); DISPATCH();
+L_JSR: OpJSR(); DISPATCH();
+L_ANDIndX: OpANDIndX(); DISPATCH();
+L_BITZP: OpBITZP(); DISPATCH();
+L_ANDZP: OpANDZP(); DISPATCH();
+L_ROLZP: OpROLZP(); DISPATCH();
+L_PLP: OpPLP(); DISPATCH();
+L_ANDIM: OpANDIM(); DISPATCH();
+L_ROLA: OpROLA(); DISPATCH();
+L_BITABS: OpBITABS(); DISPATCH();
+L_ANDABS: OpANDABS(); DISPATCH();
+L_ROLABS: OpROLABS(); DISPATCH();
+L_BMI: OpBMI(); DISPATCH();
+L_ANDIndY: OpANDIndY(); DISPATCH();
+L_ANDZPX: OpANDZPX(); DISPATCH();
+L_ROLZPX: OpROLZPX(); DISPATCH();
+L_SEC: OpSEC(); DISPATCH();
+L_ANDABSY: OpANDABSY(); DISPATCH();
+L_ANDABSX: OpANDABSX(); DISPATCH();
+L_ROLABSX: OpROLABSX(); DISPATCH();
+L_RTI: OpRTI(); DISPATCH();
+L_EORIndX: OpEORIndX(); DISPATCH();
+L_EORZP: OpEORZP(); DISPATCH();
+L_LSRZP: OpLSRZP(); DISPATCH();
+L_PHA: OpPHA(); DISPATCH();
+L_EORIM: OpEORIM(); DISPATCH();
+L_LSRA: OpLSRA(); DISPATCH();
+L_JMP: OpJMP(); DISPATCH();
+L_EORABS: OpEORABS(); DISPATCH();
+L_LSRABS: OpLSRABS(); DISPATCH();
+L_BVC: OpBVC(); DISPATCH();
+L_EORIndY: OpEORIndY(); DISPATCH();
+L_EORZPX: OpEORZPX(); DISPATCH();
+L_LSRZPX: OpLSRZPX(); DISPATCH();
+L_CLI: OpCLI(); DISPATCH();
+L_EORABSY: OpEORABSY(); DISPATCH();
+L_EORABSX: OpEORABSX(); DISPATCH();
+L_LSRABSX: OpLSRABSX(); DISPATCH();
+L_RTS: OpRTS(); DISPATCH();
+L_ADCIndX: OpADCIndX(); DISPATCH();
+L_ADCZP: OpADCZP(); DISPATCH();
+L_RORZP: OpRORZP(); DISPATCH();
+L_PLA: OpPLA(); DISPATCH();
+L_ADCIM: OpADCIM(); DISPATCH();
+L_RORA: OpRORA(); DISPATCH();
+L_JMPIND: OpJMPIND(); DISPATCH();
+L_ADCABS: OpADCABS(); DISPATCH();
+L_RORABS: OpRORABS(); DISPATCH();
+L_BVS: OpBVS(); DISPATCH();
+L_ADCIndY: OpADCIndY(); DISPATCH();
+L_ADCZPX: OpADCZPX(); DISPATCH();
+L_RORZPX: OpRORZPX(); DISPATCH();
+L_SEI: OpSEI(); DISPATCH();
+L_ADCABSY: OpADCABSY(); DISPATCH();
+L_ADCABSX: OpADCABSX(); DISPATCH();
+L_RORABSX: OpRORABSX(); DISPATCH();
+L_STAIndX: OpSTAIndX(); DISPATCH();
+L_STYZP: OpSTYZP(); DISPATCH();
+L_STAZP: OpSTAZP(); DISPATCH();
+L_STXZP: OpSTXZP(); DISPATCH();
+L_DEY: OpDEY(); DISPATCH();
+L_TXA: OpTXA(); DISPATCH();
+L_STYABS: OpSTYABS(); DISPATCH();
+L_STAABS: OpSTAABS(); DISPATCH();
+L_STXABS: OpSTXABS(); DISPATCH();
+L_BCC: OpBCC(); DISPATCH();
+L_STAIndY: OpSTAIndY(); DISPATCH();
+L_STYZPX: OpSTYZPX(); DISPATCH();
+L_STAZPX: OpSTAZPX(); DISPATCH();
+L_STXZPY: OpSTXZPY(); DISPATCH();
+L_TYA: OpTYA(); DISPATCH();
+L_STAABSY: OpSTAABSY(); DISPATCH();
+L_TXS: OpTXS(); DISPATCH();
+L_STAABSX: OpSTAABSX(); DISPATCH();
+L_LDYIM: OpLDYIM(); DISPATCH();
+L_LDAIndX: OpLDAIndX(); DISPATCH();
+L_LDXIM: OpLDXIM(); DISPATCH();
+L_LDYZP: OpLDYZP(); DISPATCH();
+L_LDAZP: OpLDAZP(); DISPATCH();
+L_LDXZP: OpLDXZP(); DISPATCH();
+L_TAY: OpTAY(); DISPATCH();
+L_LDAIM: OpLDAIM(); DISPATCH();
+L_TAX: OpTAX(); DISPATCH();
+L_LDYABS: OpLDYABS(); DISPATCH();
+L_LDAABS: OpLDAABS(); DISPATCH();
+L_LDXABS: OpLDXABS(); DISPATCH();
+L_BCS: OpBCS(); DISPATCH();
+L_LDAIndY: OpLDAIndY(); DISPATCH();
+L_LDYZPX: OpLDYZPX(); DISPATCH();
+L_LDAZPX: OpLDAZPX(); DISPATCH();
+L_LDXZPY: OpLDXZPY(); DISPATCH();
+L_CLV: OpCLV(); DISPATCH();
+L_LDAABSY: OpLDAABSY(); DISPATCH();
+L_TSX: OpTSX(); DISPATCH();
+L_LDYABSX: OpLDYABSX(); DISPATCH();
+L_LDAABSX: OpLDAABSX(); DISPATCH();
+L_LDXABSY: OpLDXABSY(); DISPATCH();
+L_CPYIM: OpCPYIM(); DISPATCH();
+L_CMPIndX: OpCMPIndX(); DISPATCH();
+L_CPYZP: OpCPYZP(); DISPATCH();
+L_CMPZP: OpCMPZP(); DISPATCH();
+L_DECZP: OpDECZP(); DISPATCH();
+L_INY: OpINY(); DISPATCH();
+L_CMPIM: OpCMPIM(); DISPATCH();
+L_DEX: OpDEX(); DISPATCH();
+L_CPYABS: OpCPYABS(); DISPATCH();
+L_CMPABS: OpCMPABS(); DISPATCH();
+L_DECABS: OpDECABS(); DISPATCH();
+L_BNE: OpBNE(); DISPATCH();
+L_CMPIndY: OpCMPIndY(); DISPATCH();
+L_CMPZPX: OpCMPZPX(); DISPATCH();
+L_DECZPX: OpDECZPX(); DISPATCH();
+L_CLD: OpCLD(); DISPATCH();
+L_CMPABSY: OpCMPABSY(); DISPATCH();
+L_CMPABSX: OpCMPABSX(); DISPATCH();
+L_DECABSX: OpDECABSX(); DISPATCH();
+L_CPXIM: OpCPXIM(); DISPATCH();
+L_SBCIndX: OpSBCIndX(); DISPATCH();
+L_CPXZP: OpCPXZP(); DISPATCH();
+L_SBCZP: OpSBCZP(); DISPATCH();
+L_INCZP: OpINCZP(); DISPATCH();
+L_INX: OpINX(); DISPATCH();
+L_SBCIM: OpSBCIM(); DISPATCH();
+L_NOP: OpNOP(); DISPATCH();
+L_CPXABS: OpCPXABS(); DISPATCH();
+L_SBCABS: OpSBCABS(); DISPATCH();
+L_INCABS: OpINCABS(); DISPATCH();
+L_BEQ: OpBEQ(); DISPATCH();
+L_SBCIndY: OpSBCIndY(); DISPATCH();
+L_SBCZPX: OpSBCZPX(); DISPATCH();
+L_INCZPX: OpINCZPX(); DISPATCH();
+L_SED: OpSED(); DISPATCH();
+L_SBCABSY: OpSBCABSY(); DISPATCH();
+L_SBCABSX: OpSBCABSX(); DISPATCH();
+L_INCABSX: OpINCABSX(); DISPATCH();
+#undef DISPATCH
+#else
+	while (PrepareExecute())
+	{
+		const BlockOp* op;
+		const BlockOp* op_end;
+		if (blocks && EnterBlock(&op, &op_end))
+		{
+			for (; op != op_end && !block_exit; ++op) // none left if translated code ran
+			{
+				cycles += op->cycles;
+				++instructions;
+				(this->*op_table[op->opcode])();
+			}
+			continue;
+		}
+		byte opcode = GetMemory(PC);
+		cycles += cycle_table[opcode];
+		++instructions;
+		(this->*op_table[opcode])();
+	}
+#endif
+}
+
+// returns true when instruction at PC is ready to execute, false to stop with stop_reason set
+bool Emu6502::PrepareExecute()
+{
+	while (true)
+	{
+		if (stop_reason != StopNone)
+			return false;
+		if (quit)
+			stop_reason = StopQuit;
+		else if (cycles >= cycle_limit)
+			stop_reason = StopCycles;
+		else if (instructions >= instruction_limit)
+			stop_reason = StopInstructions;
+		else if (watch_hit)
+		{
+			stop_reason = StopWatchpoint;
+			watch_hit = false; // reported
+		}
+		else if (slow_path && (instructions != run_start_instructions || last_stop == StopWatchpoint))
+		{
+			watch_paused = true;
+			if (PC == until_pc)
+				stop_reason = StopPC;
+			else if (until_predicate != 0 && until_predicate(this, until_context))
+				stop_reason = StopPredicate;
+			watch_paused = false;
+		}
+		if (stop_reason == StopNone && debugging && TestBit(debug_maps, PC)
+			&& !(last_stop == StopBreakpoint && instructions == run_start_instructions))
+			stop_reason = StopBreakpoint;
+		if (stop_reason != StopNone)
+			return false;
+		watch_paused = true;
+		if (trace || step)
+			TraceInstruction();
+		watch_paused = false;
+		if (!TestBit(trap_map, PC) || !ExecutePatch()) // allow execute to be overriden at a specific address
+		{
+			watch_paused = true;
+			if (profiler != 0)
+				profiler->Count(PC, cycles);
+			if (basic_profiler != 0)
+				basic_profiler->Count(this, PC, cycles);
+			watch_paused = false;
+			return true;
+		}
+	}
+}
+
+ushort Emu6502::AddrZP()
+{
+	return GetMemory((ushort)(PC + 1));
+}
+
+ushort Emu6502::AddrZPX()
+{
+	return (byte)(GetMemory((ushort)(PC + 1)) + X); // wraps within zero page
+}
+
+ushort Emu6502::AddrZPY()
+{
+	return (byte)(GetMemory((ushort)(PC + 1)) + Y); // wraps within zero page
+}
+
+ushort Emu6502::AddrABS()
+{
+	return (ushort)(GetMemory((ushort)(PC + 1)) | (GetMemory((ushort)(PC + 2)) << 8));
+}
+
+ushort Emu6502::AddrABSX()
+{
+	return (ushort)(AddrABS() + X);
+}
+
+ushort Emu6502::AddrABSY()
+{
+	return (ushort)(AddrABS() + Y);
+}
+
+ushort Emu6502::AddrIndX()
+{
+	byte zpaddr = (byte)(GetMemory((ushort)(PC + 1)) + X); // address must be within zero page
+	return (ushort)(GetMemory(zpaddr) | (GetMemory((byte)(zpaddr + 1)) << 8)); // must keep zpaddr+1 within zero page (byte address)
+}
+
+ushort Emu6502::AddrIndY()
+{
+	ushort addr2 = GetMemory((ushort)(PC + 1));
+	return (ushort)((GetMemory(addr2) | (GetMemory((ushort)(addr2 + 1)) << 8)) + Y);
+}
+
+void Emu6502::Branch(bool branch)
+{
+	if (branch)
+	{
+		ushort addr2 = (ushort)(PC + 2 + (sbyte)GetMemory((ushort)(PC + 1)));
+		cycles += ((((PC + 2) ^ addr2) & 0xFF00) != 0) ? 2 : 1; // taken, and to another page
+		PC = addr2;
+	}
+	else
+		PC += 2;
+}
+
+byte Emu6502::ReadABSX()
+{
+	ushort addr2 = AddrABS();
+	ushort addr3 = (ushort)(addr2 + X);
+	if ((addr2 ^ addr3) & 0xFF00)
+		++cycles; // page crossing
+	return GetMemory(addr3);
+}
+
+byte Emu6502::ReadABSY()
+{
+	ushort addr2 = AddrABS();
+	ushort addr3 = (ushort)(addr2 + Y);
+	if ((addr2 ^ addr3) & 0xFF00)
+		++cycles; // page crossing
+	return GetMemory(addr3);
+}
+
+byte Emu6502::ReadIndY()
+{
+	ushort addr2 = GetMemory((ushort)(PC + 1));
+	ushort addr3 = (ushort)(GetMemory(addr2) | (GetMemory((ushort)(addr2 + 1)) << 8));
+	ushort addr4 = (ushort)(addr3 + Y);
+	if ((addr3 ^ addr4) & 0xFF00)
+		++cycles; // page crossing
+	return GetMemory(addr4);
+}
+
+void Emu6502::OpInvalid()
+{
+	--instructions; // not executed
+	stop_reason = StopInvalidOpcode;
+}
+
+void Emu6502::OpBRK()
+{
+	byte bytes;
+	BRK(&bytes);
+}
+
+void Emu6502::OpORAIndX()
+{
+	ORA(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpORAZP()
+{
+	ORA(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpASLZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, ASL(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpPHP()
+{
+	PHP();
+	++PC;
+}
+
+void Emu6502::OpORAIM()
+{
+	ORA(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpASLA()
+{
+	SetA(ASL(A));
+	++PC;
+}
+
+void Emu6502::OpORAABS()
+{
+	ORA(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpASLABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, ASL(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBPL()
+{
+	Branch(!GetN());
+}
+
+void Emu6502::OpORAIndY()
+{
+	ORA(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpORAZPX()
+{
+	ORA(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpASLZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, ASL(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpCLC()
+{
+	CLC();
+	++PC;
+}
+
+void Emu6502::OpORAABSY()
+{
+	ORA(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpORAABSX()
+{
+	ORA(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpASLABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, ASL(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpJSR()
+{
+	byte bytes;
+	JSR(&PC, &bytes);
+}
+
+void Emu6502::OpANDIndX()
+{
+	AND(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpBITZP()
+{
+	BIT(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpANDZP()
+{
+	AND(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpROLZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, ROL(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpPLP()
+{
+	PLP();
+	++PC;
+}
+
+void Emu6502::OpANDIM()
+{
+	AND(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpROLA()
+{
+	SetA(ROL(A));
+	++PC;
+}
+
+void Emu6502::OpBITABS()
+{
+	BIT(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpANDABS()
+{
+	AND(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpROLABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, ROL(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBMI()
+{
+	Branch(GetN());
+}
+
+void Emu6502::OpANDIndY()
+{
+	AND(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpANDZPX()
+{
+	AND(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpROLZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, ROL(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpSEC()
+{
+	SEC();
+	++PC;
+}
+
+void Emu6502::OpANDABSY()
+{
+	AND(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpANDABSX()
+{
+	AND(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpROLABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, ROL(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpRTI()
+{
+	byte bytes;
+	RTI(&PC, &bytes);
+}
+
+void Emu6502::OpEORIndX()
+{
+	EOR(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpEORZP()
+{
+	EOR(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpLSRZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, LSR(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpPHA()
+{
+	PHA();
+	++PC;
+}
+
+void Emu6502::OpEORIM()
+{
+	EOR(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpLSRA()
+{
+	SetA(LSR(A));
+	++PC;
+}
+
+void Emu6502::OpJMP()
+{
+	PC = AddrABS();
+}
+
+void Emu6502::OpEORABS()
+{
+	EOR(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpLSRABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, LSR(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBVC()
+{
+	Branch(!V);
+}
+
+void Emu6502::OpEORIndY()
+{
+	EOR(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpEORZPX()
+{
+	EOR(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpLSRZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, LSR(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpCLI()
+{
+	CLI();
+	++PC;
+}
+
+void Emu6502::OpEORABSY()
+{
+	EOR(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpEORABSX()
+{
+	EOR(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpLSRABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, LSR(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpRTS()
+{
+	byte bytes;
+	RTS(&PC, &bytes);
+}
+
+void Emu6502::OpADCIndX()
+{
+	ADC(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpADCZP()
+{
+	ADC(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpRORZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, ROR(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpPLA()
+{
+	PLA();
+	++PC;
+}
+
+void Emu6502::OpADCIM()
+{
+	ADC(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpRORA()
+{
+	SetA(ROR(A));
+	++PC;
+}
+
+void Emu6502::OpJMPIND()
+{
+	byte bytes;
+	JMPIND(&PC, &bytes);
+}
+
+void Emu6502::OpADCABS()
+{
+	ADC(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpRORABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, ROR(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBVS()
+{
+	Branch(V);
+}
+
+void Emu6502::OpADCIndY()
+{
+	ADC(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpADCZPX()
+{
+	ADC(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpRORZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, ROR(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpSEI()
+{
+	SEI();
+	++PC;
+}
+
+void Emu6502::OpADCABSY()
+{
+	ADC(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpADCABSX()
+{
+	ADC(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpRORABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, ROR(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpSTAIndX()
+{
+	SetMemory(AddrIndX(), A);
+	PC += 2;
+}
+
+void Emu6502::OpSTYZP()
+{
+	SetMemory(AddrZP(), Y);
+	PC += 2;
+}
+
+void Emu6502::OpSTAZP()
+{
+	SetMemory(AddrZP(), A);
+	PC += 2;
+}
+
+void Emu6502::OpSTXZP()
+{
+	SetMemory(AddrZP(), X);
+	PC += 2;
+}
+
+void Emu6502::OpDEY()
+{
+	DEY();
+	++PC;
+}
+
+void Emu6502::OpTXA()
+{
+	TXA();
+	++PC;
+}
+
+void Emu6502::OpSTYABS()
+{
+	SetMemory(AddrABS(), Y);
+	PC += 3;
+}
+
+void Emu6502::OpSTAABS()
+{
+	SetMemory(AddrABS(), A);
+	PC += 3;
+}
+
+void Emu6502::OpSTXABS()
+{
+	SetMemory(AddrABS(), X);
+	PC += 3;
+}
+
+void Emu6502::OpBCC()
+{
+	Branch(!C);
+}
+
+void Emu6502::OpSTAIndY()
+{
+	SetMemory(AddrIndY(), A);
+	PC += 2;
+}
+
+void Emu6502::OpSTYZPX()
+{
+	SetMemory(AddrZPX(), Y);
+	PC += 2;
+}
+
+void Emu6502::OpSTAZPX()
+{
+	SetMemory(AddrZPX(), A);
+	PC += 2;
+}
+
+void Emu6502::OpSTXZPY()
+{
+	SetMemory(AddrZPY(), X);
+	PC += 2;
+}
+
+void Emu6502::OpTYA()
+{
+	TYA();
+	++PC;
+}
+
+void Emu6502::OpSTAABSY()
+{
+	SetMemory(AddrABSY(), A);
+	PC += 3;
+}
+
+void Emu6502::OpTXS()
+{
+	TXS();
+	++PC;
+}
+
+void Emu6502::OpSTAABSX()
+{
+	SetMemory(AddrABSX(), A);
+	PC += 3;
+}
+
+void Emu6502::OpLDYIM()
+{
+	SetY(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpLDAIndX()
+{
+	SetA(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpLDXIM()
+{
+	SetX(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpLDYZP()
+{
+	SetY(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpLDAZP()
+{
+	SetA(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpLDXZP()
+{
+	SetX(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpTAY()
+{
+	TAY();
+	++PC;
+}
+
+void Emu6502::OpLDAIM()
+{
+	SetA(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpTAX()
+{
+	TAX();
+	++PC;
+}
+
+void Emu6502::OpLDYABS()
+{
+	SetY(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpLDAABS()
+{
+	SetA(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpLDXABS()
+{
+	SetX(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpBCS()
+{
+	Branch(C);
+}
+
+void Emu6502::OpLDAIndY()
+{
+	SetA(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpLDYZPX()
+{
+	SetY(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpLDAZPX()
+{
+	SetA(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpLDXZPY()
+{
+	SetX(GetMemory(AddrZPY()));
+	PC += 2;
+}
+
+void Emu6502::OpCLV()
+{
+	CLV();
+	++PC;
+}
+
+void Emu6502::OpLDAABSY()
+{
+	SetA(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpTSX()
+{
+	TSX();
+	++PC;
+}
+
+void Emu6502::OpLDYABSX()
+{
+	SetY(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpLDAABSX()
+{
+	SetA(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpLDXABSY()
+{
+	SetX(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpCPYIM()
+{
+	CPY(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpCMPIndX()
+{
+	CMP(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpCPYZP()
+{
+	CPY(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpCMPZP()
+{
+	CMP(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpDECZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, DEC(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpINY()
+{
+	INY();
+	++PC;
+}
+
+void Emu6502::OpCMPIM()
+{
+	CMP(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpDEX()
+{
+	DEX();
+	++PC;
+}
+
+void Emu6502::OpCPYABS()
+{
+	CPY(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpCMPABS()
+{
+	CMP(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpDECABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, DEC(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBNE()
+{
+	Branch(!GetZ());
+}
+
+void Emu6502::OpCMPIndY()
+{
+	CMP(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpCMPZPX()
+{
+	CMP(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpDECZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, DEC(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpCLD()
+{
+	CLD();
+	++PC;
+}
+
+void Emu6502::OpCMPABSY()
+{
+	CMP(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpCMPABSX()
+{
+	CMP(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpDECABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, DEC(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpCPXIM()
+{
+	CPX(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpSBCIndX()
+{
+	SBC(GetMemory(AddrIndX()));
+	PC += 2;
+}
+
+void Emu6502::OpCPXZP()
+{
+	CPX(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpSBCZP()
+{
+	SBC(GetMemory(AddrZP()));
+	PC += 2;
+}
+
+void Emu6502::OpINCZP()
+{
+	ushort addr = AddrZP();
+	SetMemory(addr, INC(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpINX()
+{
+	INX();
+	++PC;
+}
+
+void Emu6502::OpSBCIM()
+{
+	SBC(GetMemory((ushort)(PC + 1)));
+	PC += 2;
+}
+
+void Emu6502::OpNOP()
+{
+	NOP();
+	++PC;
+}
+
+void Emu6502::OpCPXABS()
+{
+	CPX(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpSBCABS()
+{
+	SBC(GetMemory(AddrABS()));
+	PC += 3;
+}
+
+void Emu6502::OpINCABS()
+{
+	ushort addr = AddrABS();
+	SetMemory(addr, INC(GetMemory(addr)));
+	PC += 3;
+}
+
+void Emu6502::OpBEQ()
+{
+	Branch(GetZ());
+}
+
+void Emu6502::OpSBCIndY()
+{
+	SBC(ReadIndY());
+	PC += 2;
+}
+
+void Emu6502::OpSBCZPX()
+{
+	SBC(GetMemory(AddrZPX()));
+	PC += 2;
+}
+
+void Emu6502::OpINCZPX()
+{
+	ushort addr = AddrZPX();
+	SetMemory(addr, INC(GetMemory(addr)));
+	PC += 2;
+}
+
+void Emu6502::OpSED()
+{
+	SED();
+	++PC;
+}
+
+void Emu6502::OpSBCABSY()
+{
+	SBC(ReadABSY());
+	PC += 3;
+}
+
+void Emu6502::OpSBCABSX()
+{
+	SBC(ReadABSX());
+	PC += 3;
+}
+
+void Emu6502::OpINCABSX()
+{
+	ushort addr = AddrABSX();
+	SetMemory(addr, INC(GetMemory(addr)));
+	PC += 3;
+}
+
+// NMOS 6502 base cycles per opcode, 0 for invalid opcodes
+// page crossing (read instructions) and taken branch penalties are added during execution
+const byte Emu6502::cycle_table[256] =
+{
+	/* 00 */ 7, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 0, 4, 6, 0,
+	/* 10 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	/* 20 */ 6, 6, 0, 0, 3, 3, 5, 0, 4, 2, 2, 0, 4, 4, 6, 0,
+	/* 30 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	/* 40 */ 6, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 3, 4, 6, 0,
+	/* 50 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	/* 60 */ 6, 6, 0, 0, 0, 3, 5, 0, 4, 2, 2, 0, 5, 4, 6, 0,
+	/* 70 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	/* 80 */ 0, 6, 0, 0, 3, 3, 3, 0, 2, 0, 2, 0, 4, 4, 4, 0,
+	/* 90 */ 2, 6, 0, 0, 4, 4, 4, 0, 2, 5, 2, 0, 0, 5, 0, 0,
+	/* A0 */ 2, 6, 2, 0, 3, 3, 3, 0, 2, 2, 2, 0, 4, 4, 4, 0,
+	/* B0 */ 2, 5, 0, 0, 4, 4, 4, 0, 2, 4, 2, 0, 4, 4, 4, 0,
+	/* C0 */ 2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0,
+	/* D0 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	/* E0 */ 2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0,
+	/* F0 */ 2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+};
+
+const Emu6502::OpHandler Emu6502::op_table[256] =
+{
+	/* 00 */ &Emu6502::OpBRK, &Emu6502::OpORAIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 04 */ &Emu6502::OpInvalid, &Emu6502::OpORAZP, &Emu6502::OpASLZP, &Emu6502::OpInvalid,
+	/* 08 */ &Emu6502::OpPHP, &Emu6502::OpORAIM, &Emu6502::OpASLA, &Emu6502::OpInvalid,
+	/* 0C */ &Emu6502::OpInvalid, &Emu6502::OpORAABS, &Emu6502::OpASLABS, &Emu6502::OpInvalid,
+	/* 10 */ &Emu6502::OpBPL, &Emu6502::OpORAIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 14 */ &Emu6502::OpInvalid, &Emu6502::OpORAZPX, &Emu6502::OpASLZPX, &Emu6502::OpInvalid,
+	/* 18 */ &Emu6502::OpCLC, &Emu6502::OpORAABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 1C */ &Emu6502::OpInvalid, &Emu6502::OpORAABSX, &Emu6502::OpASLABSX, &Emu6502::OpInvalid,
+	/* 20 */ &Emu6502::OpJSR, &Emu6502::OpANDIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 24 */ &Emu6502::OpBITZP, &Emu6502::OpANDZP, &Emu6502::OpROLZP, &Emu6502::OpInvalid,
+	/* 28 */ &Emu6502::OpPLP, &Emu6502::OpANDIM, &Emu6502::OpROLA, &Emu6502::OpInvalid,
+	/* 2C */ &Emu6502::OpBITABS, &Emu6502::OpANDABS, &Emu6502::OpROLABS, &Emu6502::OpInvalid,
+	/* 30 */ &Emu6502::OpBMI, &Emu6502::OpANDIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 34 */ &Emu6502::OpInvalid, &Emu6502::OpANDZPX, &Emu6502::OpROLZPX, &Emu6502::OpInvalid,
+	/* 38 */ &Emu6502::OpSEC, &Emu6502::OpANDABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 3C */ &Emu6502::OpInvalid, &Emu6502::OpANDABSX, &Emu6502::OpROLABSX, &Emu6502::OpInvalid,
+	/* 40 */ &Emu6502::OpRTI, &Emu6502::OpEORIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 44 */ &Emu6502::OpInvalid, &Emu6502::OpEORZP, &Emu6502::OpLSRZP, &Emu6502::OpInvalid,
+	/* 48 */ &Emu6502::OpPHA, &Emu6502::OpEORIM, &Emu6502::OpLSRA, &Emu6502::OpInvalid,
+	/* 4C */ &Emu6502::OpJMP, &Emu6502::OpEORABS, &Emu6502::OpLSRABS, &Emu6502::OpInvalid,
+	/* 50 */ &Emu6502::OpBVC, &Emu6502::OpEORIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 54 */ &Emu6502::OpInvalid, &Emu6502::OpEORZPX, &Emu6502::OpLSRZPX, &Emu6502::OpInvalid,
+	/* 58 */ &Emu6502::OpCLI, &Emu6502::OpEORABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 5C */ &Emu6502::OpInvalid, &Emu6502::OpEORABSX, &Emu6502::OpLSRABSX, &Emu6502::OpInvalid,
+	/* 60 */ &Emu6502::OpRTS, &Emu6502::OpADCIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 64 */ &Emu6502::OpInvalid, &Emu6502::OpADCZP, &Emu6502::OpRORZP, &Emu6502::OpInvalid,
+	/* 68 */ &Emu6502::OpPLA, &Emu6502::OpADCIM, &Emu6502::OpRORA, &Emu6502::OpInvalid,
+	/* 6C */ &Emu6502::OpJMPIND, &Emu6502::OpADCABS, &Emu6502::OpRORABS, &Emu6502::OpInvalid,
+	/* 70 */ &Emu6502::OpBVS, &Emu6502::OpADCIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 74 */ &Emu6502::OpInvalid, &Emu6502::OpADCZPX, &Emu6502::OpRORZPX, &Emu6502::OpInvalid,
+	/* 78 */ &Emu6502::OpSEI, &Emu6502::OpADCABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 7C */ &Emu6502::OpInvalid, &Emu6502::OpADCABSX, &Emu6502::OpRORABSX, &Emu6502::OpInvalid,
+	/* 80 */ &Emu6502::OpInvalid, &Emu6502::OpSTAIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 84 */ &Emu6502::OpSTYZP, &Emu6502::OpSTAZP, &Emu6502::OpSTXZP, &Emu6502::OpInvalid,
+	/* 88 */ &Emu6502::OpDEY, &Emu6502::OpInvalid, &Emu6502::OpTXA, &Emu6502::OpInvalid,
+	/* 8C */ &Emu6502::OpSTYABS, &Emu6502::OpSTAABS, &Emu6502::OpSTXABS, &Emu6502::OpInvalid,
+	/* 90 */ &Emu6502::OpBCC, &Emu6502::OpSTAIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* 94 */ &Emu6502::OpSTYZPX, &Emu6502::OpSTAZPX, &Emu6502::OpSTXZPY, &Emu6502::OpInvalid,
+	/* 98 */ &Emu6502::OpTYA, &Emu6502::OpSTAABSY, &Emu6502::OpTXS, &Emu6502::OpInvalid,
+	/* 9C */ &Emu6502::OpInvalid, &Emu6502::OpSTAABSX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* A0 */ &Emu6502::OpLDYIM, &Emu6502::OpLDAIndX, &Emu6502::OpLDXIM, &Emu6502::OpInvalid,
+	/* A4 */ &Emu6502::OpLDYZP, &Emu6502::OpLDAZP, &Emu6502::OpLDXZP, &Emu6502::OpInvalid,
+	/* A8 */ &Emu6502::OpTAY, &Emu6502::OpLDAIM, &Emu6502::OpTAX, &Emu6502::OpInvalid,
+	/* AC */ &Emu6502::OpLDYABS, &Emu6502::OpLDAABS, &Emu6502::OpLDXABS, &Emu6502::OpInvalid,
+	/* B0 */ &Emu6502::OpBCS, &Emu6502::OpLDAIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* B4 */ &Emu6502::OpLDYZPX, &Emu6502::OpLDAZPX, &Emu6502::OpLDXZPY, &Emu6502::OpInvalid,
+	/* B8 */ &Emu6502::OpCLV, &Emu6502::OpLDAABSY, &Emu6502::OpTSX, &Emu6502::OpInvalid,
+	/* BC */ &Emu6502::OpLDYABSX, &Emu6502::OpLDAABSX, &Emu6502::OpLDXABSY, &Emu6502::OpInvalid,
+	/* C0 */ &Emu6502::OpCPYIM, &Emu6502::OpCMPIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* C4 */ &Emu6502::OpCPYZP, &Emu6502::OpCMPZP, &Emu6502::OpDECZP, &Emu6502::OpInvalid,
+	/* C8 */ &Emu6502::OpINY, &Emu6502::OpCMPIM, &Emu6502::OpDEX, &Emu6502::OpInvalid,
+	/* CC */ &Emu6502::OpCPYABS, &Emu6502::OpCMPABS, &Emu6502::OpDECABS, &Emu6502::OpInvalid,
+	/* D0 */ &Emu6502::OpBNE, &Emu6502::OpCMPIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* D4 */ &Emu6502::OpInvalid, &Emu6502::OpCMPZPX, &Emu6502::OpDECZPX, &Emu6502::OpInvalid,
+	/* D8 */ &Emu6502::OpCLD, &Emu6502::OpCMPABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* DC */ &Emu6502::OpInvalid, &Emu6502::OpCMPABSX, &Emu6502::OpDECABSX, &Emu6502::OpInvalid,
+	/* E0 */ &Emu6502::OpCPXIM, &Emu6502::OpSBCIndX, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* E4 */ &Emu6502::OpCPXZP, &Emu6502::OpSBCZP, &Emu6502::OpINCZP, &Emu6502::OpInvalid,
+	/* E8 */ &Emu6502::OpINX, &Emu6502::OpSBCIM, &Emu6502::OpNOP, &Emu6502::OpInvalid,
+	/* EC */ &Emu6502::OpCPXABS, &Emu6502::OpSBCABS, &Emu6502::OpINCABS, &Emu6502::OpInvalid,
+	/* F0 */ &Emu6502::OpBEQ, &Emu6502::OpSBCIndY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* F4 */ &Emu6502::OpInvalid, &Emu6502::OpSBCZPX, &Emu6502::OpINCZPX, &Emu6502::OpInvalid,
+	/* F8 */ &Emu6502::OpSED, &Emu6502::OpSBCABSY, &Emu6502::OpInvalid, &Emu6502::OpInvalid,
+	/* FC */ &Emu6502::OpInvalid, &Emu6502::OpSBCABSX, &Emu6502::OpINCABSX, &Emu6502::OpInvalid
+};
+
 // Examples:
 // FFFF FF FF FF JMP ($FFFF)
 // FFFF FF FF FF LDA $FFFF,X
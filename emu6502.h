@@ -32,26 +32,101 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <vector>
+
 typedef signed char sbyte;
 typedef unsigned char byte;
 typedef unsigned short ushort;
 
+class Tracer;
+class Profiler;
+class CallGraph;
+class BasicProfiler;
+class Jit;
+
 class Emu6502
 {
 public:
+	// saves or restores machine state through the same code, so the order always matches
+	class StateIO
+	{
+	public:
+		StateIO(); // saving, appends to data
+		StateIO(const byte* data, size_t size); // restoring
+		void Bytes(void* p, size_t size);
+		template <class T> void Value(T& value) { Bytes(&value, sizeof(value)); }
+		bool IsSaving() { return saving; }
+		bool Failed() { return failed; } // restore ran out of data
+
+		std::vector<byte> data;
+
+	private:
+		bool saving;
+		bool failed;
+		const byte* read_data;
+		size_t read_size;
+		size_t read_offset;
+	};
+
 	class Memory
 	{
 	public:
-		Memory() {}
+		Memory();
 		virtual ~Memory() {}
 		virtual byte read(ushort addr) = 0;
 		virtual void write(ushort addr, byte value) = 0;
 
+		// RAM, I/O and banking state, not ROMs, return false if not supported
+		virtual bool SerializeState(StateIO& /*io*/) { return false; }
+
+		// page reads ROM code as mapped now, BASIC, KERNAL and the like, not character ROM
+		virtual bool IsRomPage(byte /*page*/) { return false; }
+
+		// fast path consulted by the CPU before read()/write(): host pointer
+		// to each 256 byte page, or 0 to go through read()/write() for I/O,
+		// trapped or unmapped pages.  Derived classes remap pages whenever
+		// their banking changes, or switch to their own precomputed tables.
+		byte** read_pages;
+		byte** write_pages;
+
+	protected:
+		void MapPages(int first_page, int count, byte* read_base, byte* write_base);
+
+	private:
+		byte* default_read_pages[256];
+		byte* default_write_pages[256];
+
 	private:
 		Memory(const Memory& other); // disabled
 		bool operator==(const Memory& other) const; // disabled
 	};
 
+	enum Engine
+	{
+		SwitchEngine, // reference implementation, one big switch per instruction
+		TableEngine, // 256 entry handler table indexed by opcode
+		BlockEngine, // table engine handlers run from cached decoded blocks, see EnterBlock()
+		JitEngine, // block engine with hot blocks translated to x86-64, same as BlockEngine where unsupported, see Jit
+		RomEngine, // block engine with ROM blocks translated to C++ ahead of time, see RomCode
+	};
+
+	// why Run...() returned, CPU state is intact so can run again to continue
+	enum StopReason
+	{
+		StopNone,
+		StopQuit, // quit set, e.g. by ExecutePatch()
+		StopCycles, // RunFor() cycles reached
+		StopInstructions, // RunInstructions() count reached
+		StopPC, // RunUntil() address reached
+		StopPredicate, // RunUntil() predicate returned true
+		StopInvalidOpcode, // PC is left at the invalid opcode
+		StopBreakpoint, // PC reached a breakpoint, instruction not yet executed
+		StopWatchpoint, // an instruction or ExecutePatch() accessed a watched address, PC is after it, see GetWatchAddress()
+	};
+
+	typedef bool (*RunPredicate)(Emu6502* emu, void* context);
+
 protected:
     Memory* memory;
 
@@ -59,20 +134,40 @@ protected:
     byte X;
     byte Y;
     byte S;
-    bool N;
+    ushort NZ; // last result, N and Z are derived when tested, see GetN()/GetZ()/SetNZ()
     bool V;
     bool B;
     bool D;
     bool I;
-    bool Z;
     bool C;
     ushort PC;
 
     bool step;
     bool quit;
 
-    void Execute(ushort addr);
-	virtual bool ExecutePatch() = 0;
+    Engine engine;
+
+    unsigned long long cycles; // base cycles per opcode plus page crossing and branch taken penalties
+    unsigned long long instructions;
+
+    StopReason Execute();
+	virtual bool ExecutePatch() = 0; // before executing at an address registered by SetTrap(), true if PC changed
+	void SetTrap(ushort addr);
+	void SetAllTraps(); // ExecutePatch() before every instruction
+	virtual bool SerializeState(StateIO& io);
+	void ForkState(Emu6502* child);
+	// while watching, memory's own page tables in place of unmapped ones, around code that may remap
+	// them other than read()/write(), e.g. Fork() from ExecutePatch(), then unmapped again
+	void ShowMemoryPages();
+	void HideMemoryPages();
+	void GetDisplayState(char* state, int state_size);
+
+	// N is bit 7 or bit 8 of NZ, Z is low byte of NZ zero, so a result byte is stored as is
+	bool GetN() { return (NZ & 0x180) != 0; }
+	bool GetZ() { return (NZ & 0xFF) == 0; }
+	void SetNZ(bool n, bool z) { NZ = (ushort)((n ? 0x100 : 0) | (z ? 0 : 1)); } // independent flags, e.g. BIT, PLP
+	byte GetP(); // status register, B as last set, reserved bit set
+	void SetP(byte flags);
 
 	void SetA(int value);
 	void Push(int value);
@@ -82,22 +177,107 @@ protected:
 
 public:
     bool trace;
+    Tracer* tracer; // when tracing, binary records go here instead of text to stderr, not owned
+    Profiler* profiler; // counts every instruction while attached, takes effect at next Run...(), not owned
+    CallGraph* call_graph; // shadow call stack kept by JSR/RTS/BRK/RTI while attached, not owned
+    BasicProfiler* basic_profiler; // counts every instruction against current BASIC line while attached, not owned
+    int go_num; // machine requested by GO, host reads after Run() returns
 
-    Emu6502(Memory* memory);
+    Emu6502(Memory* memory, Engine engine = TableEngine);
 	virtual ~Emu6502();
     void ResetRun();
 
+	// re-entrant stepping, each runs from current PC and returns with CPU state intact
+	// limits are checked between instructions, so RunFor() may overshoot by a few cycles
+	// RunUntil() always executes at least one instruction
+	virtual void Reset();
+	StopReason Run();
+	StopReason RunFor(unsigned long long cycles);
+	StopReason RunInstructions(unsigned long long count);
+	StopReason RunUntil(ushort addr);
+	StopReason RunUntil(RunPredicate predicate, void* context);
+
 	byte LO(ushort value);
 	byte HI(ushort value);
 	void DisassembleLong(ushort addr, bool* p_conditional, byte* p_bytes, ushort* p_addr2, char* dis, int dis_size, char* line, int line_size);
 	void DisassembleShort(ushort addr, bool* p_conditional, byte* p_bytes, ushort* p_addr2, char* dis, int dis_size);
-	byte GetMemory(ushort addr);
-	void SetMemory(ushort addr, byte value);
+	// registers and memory, counters are not part of state so restored machine counts from zero
+	bool SaveState(std::vector<byte>& state);
+	bool RestoreState(const byte* state, size_t size);
+	// new independent machine continuing from the current state, RAM pages shared
+	// copy-on-write so forking is cheap, caller deletes, 0 if machine does not support it
+	virtual Emu6502* Fork() { return 0; }
+	// ROM or region at address for reports, e.g. "BASIC", "KERNAL", 0 if none
+	virtual const char* GetRegionName(ushort /*addr*/) { return 0; }
+
+	// debugging, 64K bit maps checked only by a separate CPU loop used while any are set, take effect at next Run...()
+	// watchpoints see every access through GetMemory()/SetMemory(), including stack, vectors, indirect pointers and
+	// ExecutePatch(), but not instruction fetches or PeekMemory(), and stop after the instruction or patch that made the
+	// first one, before any RunUntil() stop there, which the next Run...() then checks at once
+	// Run...() after a breakpoint continues, it is skipped for the first instruction
+	void SetBreakpoint(ushort addr, bool set = true);
+	void SetWatchpoint(ushort addr, bool read, bool write); // both false clears
+	void ClearDebugPoints();
+	ushort GetWatchAddress() { return watch_addr; } // after StopWatchpoint
+	bool IsWatchWrite() { return watch_write; } // after StopWatchpoint, false for read, true for write or read-modify-write
+	ushort GetWatchPC() { return watch_pc; } // after StopWatchpoint, instruction or trapped address that made the access
+
+	unsigned long long GetCycles() { return cycles; }
+	unsigned long long GetInstructions() { return instructions; }
+	void SetEngine(Engine engine) { this->engine = engine; } // takes effect at next Run...()
+
+	inline byte GetMemory(ushort addr)
+	{
+		byte* page = memory->read_pages[addr >> 8];
+		if (page != 0)
+			return page[addr & 0xFF];
+		if (watching)
+			return ReadWatched(addr);
+		return memory->read(addr);
+	}
+
+	inline void SetMemory(ushort addr, byte value)
+	{
+		byte* page = memory->write_pages[addr >> 8];
+		if (page != 0)
+			page[addr & 0xFF] = value;
+		else if (watching)
+			WriteWatched(addr, value);
+		else
+		{
+			memory->write(addr, value);
+			if (quit || memory->read_pages[PC >> 8] != block_page)
+				block_exit = true; // GO, or banking changed under current block
+		}
+		if (TestBit(code_map, addr))
+			InvalidateBlocks(); // opcode of a decoded block rewritten
+	}
+
+	// GetMemory() that watchpoints ignore, for code a patch checks before running it natively, or results compared
+	byte PeekMemory(ushort addr)
+	{
+		bool paused = watch_paused;
+		watch_paused = true;
+		byte value = GetMemory(addr);
+		watch_paused = paused;
+		return value;
+	}
+
+	// count bytes from src to dest as a loop from the last byte down to the first would copy them,
+	// RAM pages by memmove, others through GetMemory()/SetMemory(), returns the byte read last
+	byte MoveMemoryDown(ushort dest, ushort src, unsigned count);
+	bool IsMapped(ushort start, unsigned count); // every page read and written by host pointer, none through I/O
+	bool IsRam(ushort start, unsigned count); // every page reads back what is written, by host pointer
+	bool Overlap(ushort a, unsigned a_count, ushort b, unsigned b_count); // may share memory, by address or pages mirrored to the same host memory
 
 private:
 	Emu6502(const Emu6502& other); // disabled
 	bool operator==(const Emu6502& other) const; // disabled
 
+	friend class Jit; // translated code works on registers and handlers directly
+	friend class RomCode;
+	friend class RomTranslator; // romxlate decodes blocks as DecodeBlock() does
+
 private:
 	void PHP();
 	byte Subtract(byte reg, byte value, bool* p_overflow);
@@ -155,7 +335,17 @@ private:
 	void BRK(byte* p_bytes);
 	void JMP(ushort* p_addr, byte* p_bytes);
 	void JMPIND(ushort* p_addr, byte* p_bytes);
-	void GetDisplayState(char* state, int state_size);
+	void TraceInstruction();
+	void PrintDebugStop(StopReason reason);
+	StopReason CheckDebugPoints();
+	byte ReadWatched(ushort addr);
+	void WriteWatched(ushort addr, byte value);
+	byte ReadUnwatched(ushort addr);
+	void LatchWatch(ushort addr, bool write);
+	StopReason RunLimited(unsigned long long max_cycles, unsigned long long max_instructions, int until_addr, RunPredicate predicate, void* context);
+	void ExecuteSwitch();
+	template <bool debug, bool blocks> void ExecuteTable();
+	bool PrepareExecute();
 	byte GetIndX(ushort addr, byte* p_bytes);
 	void SetIndX(byte value, ushort addr, byte* p_bytes);
 	byte GetIndY(ushort addr, byte* p_bytes);
@@ -185,4 +375,242 @@ private:
 	void ABSY(char* dis, int dis_size, const char* opcode, ushort addr, byte* p_bytes);
 	void IM(char* dis, int dis_size, const char* opcode, ushort addr, byte* p_bytes);
 	void BRX(char* dis, int dis_size, const char* opcode, ushort addr, bool* p_conditional, ushort* p_addr2, byte* p_bytes);
+
+private:
+	// table engine: effective address of operand at PC+1, PC is not advanced
+	ushort AddrZP();
+	ushort AddrZPX();
+	ushort AddrZPY();
+	ushort AddrABS();
+	ushort AddrABSX();
+	ushort AddrABSY();
+	ushort AddrIndX();
+	ushort AddrIndY();
+	void Branch(bool branch);
+
+	// read with page crossing penalty, for read instructions only
+	byte ReadABSX();
+	byte ReadABSY();
+	byte ReadIndY();
+
+	static const byte cycle_table[256];
+
+	// limits for current Run...() call, checked by PrepareExecute()
+	unsigned long long cycle_limit;
+	unsigned long long instruction_limit;
+	unsigned long long run_start_instructions;
+	int until_pc; // -1 for none
+	RunPredicate until_predicate;
+	void* until_context;
+	bool slow_path; // until_pc, until_predicate or a profiler active, so PrepareExecute() before every instruction
+	bool debugging; // breakpoints or watchpoints set, so ExecuteTable<true>() and PrepareExecute() check them
+	StopReason stop_reason;
+
+	byte trap_map[0x2000]; // bit per address, ExecutePatch() only called where set
+
+	// bit per address, 0x2000 bytes each: breakpoints, read watches, write watches, allocated on first use
+	byte* debug_maps;
+	int debug_count; // bits set in all maps
+	int watch_count; // bits set in watch maps
+	ushort watch_addr;
+	bool watch_write;
+	ushort watch_pc;
+	bool watch_hit; // latched by first watched access, until reported
+	StopReason last_stop; // of the previous Run...(), which decides the checks skipped for the first instruction
+	bool watching; // watchpoints set while running, memory's page tables swapped for unmapped_pages so every access is checked
+	bool watch_paused; // reads by tracing, profiling, predicates and PeekMemory(), not the program
+	byte** watch_read_pages; // memory's own page tables while swapped out
+	byte** watch_write_pages;
+	static byte* unmapped_pages[256]; // all 0
+
+	static bool TestBit(const byte* map, ushort addr) { return (map[addr >> 3] & (1 << (addr & 7))) != 0; }
+	bool SetBit(byte* map, ushort addr, bool set); // returns true if bit changed
+
+	// block engine: straight line instructions decoded once, ending at a branch, jump, trap,
+	// invalid opcode or page end.  Operands are still read as executed, so self-modified
+	// operands need nothing, only rewriting a decoded opcode invalidates, see code_map.
+	struct BlockOp
+	{
+		byte opcode;
+		byte cycles;
+	};
+	enum { block_slots = 2048, max_block_ops = 24 };
+	struct Block
+	{
+		const byte* page; // host page decoded from, stale if PC's page is now mapped elsewhere
+		ushort pc;
+		byte count; // 0 if instruction at pc must run from memory, e.g. invalid opcode
+		ushort max_cycles; // with worst case penalties, so a block never runs past a limit
+		ushort hits; // entries, JitEngine translates at jit_threshold
+		void (*code)(Emu6502* emu); // translated block, by Jit or RomCode, runs all ops or stops after one setting block_exit
+		BlockOp ops[max_block_ops];
+	};
+	enum { jit_threshold = 32 };
+	Block* block_cache; // direct mapped by PC, allocated on first use
+	Jit* jit; // JitEngine translator, created on first use
+	byte code_map[0x2000]; // bit per opcode address in blocks from writable pages, SetMemory() checks
+	const byte* block_page; // page of current block
+	bool block_exit; // current block stops after this instruction
+	bool EnterBlock(const BlockOp** p_op, const BlockOp** p_end);
+	void DecodeBlock(Block* block, const byte* page);
+	void InvalidateBlocks();
+	static int InstructionLength(byte opcode);
+	static bool EndsBlock(byte opcode);
+
+	// table engine: one handler per opcode, each handler advances PC
+	typedef void (Emu6502::*OpHandler)();
+	static const OpHandler op_table[256];
+
+	void OpInvalid();
+	void OpBRK();
+	void OpORAIndX();
+	void OpORAZP();
+	void OpASLZP();
+	void OpPHP();
+	void OpORAIM();
+	void OpASLA();
+	void OpORAABS();
+	void OpASLABS();
+	void OpBPL();
+	void OpORAIndY();
+	void OpORAZPX();
+	void OpASLZPX();
+	void OpCLC();
+	void OpORAABSY();
+	void OpORAABSX();
+	void OpASLABSX();
+	void OpJSR();
+	void OpANDIndX();
+	void OpBITZP();
+	void OpANDZP();
+	void OpROLZP();
+	void OpPLP();
+	void OpANDIM();
+	void OpROLA();
+	void OpBITABS();
+	void OpANDABS();
+	void OpROLABS();
+	void OpBMI();
+	void OpANDIndY();
+	void OpANDZPX();
+	void OpROLZPX();
+	void OpSEC();
+	void OpANDABSY();
+	void OpANDABSX();
+	void OpROLABSX();
+	void OpRTI();
+	void OpEORIndX();
+	void OpEORZP();
+	void OpLSRZP();
+	void OpPHA();
+	void OpEORIM();
+	void OpLSRA();
+	void OpJMP();
+	void OpEORABS();
+	void OpLSRABS();
+	void OpBVC();
+	void OpEORIndY();
+	void OpEORZPX();
+	void OpLSRZPX();
+	void OpCLI();
+	void OpEORABSY();
+	void OpEORABSX();
+	void OpLSRABSX();
+	void OpRTS();
+	void OpADCIndX();
+	void OpADCZP();
+	void OpRORZP();
+	void OpPLA();
+	void OpADCIM();
+	void OpRORA();
+	void OpJMPIND();
+	void OpADCABS();
+	void OpRORABS();
+	void OpBVS();
+	void OpADCIndY();
+	void OpADCZPX();
+	void OpRORZPX();
+	void OpSEI();
+	void OpADCABSY();
+	void OpADCABSX();
+	void OpRORABSX();
+	void OpSTAIndX();
+	void OpSTYZP();
+	void OpSTAZP();
+	void OpSTXZP();
+	void OpDEY();
+	void OpTXA();
+	void OpSTYABS();
+	void OpSTAABS();
+	void OpSTXABS();
+	void OpBCC();
+	void OpSTAIndY();
+	void OpSTYZPX();
+	void OpSTAZPX();
+	void OpSTXZPY();
+	void OpTYA();
+	void OpSTAABSY();
+	void OpTXS();
+	void OpSTAABSX();
+	void OpLDYIM();
+	void OpLDAIndX();
+	void OpLDXIM();
+	void OpLDYZP();
+	void OpLDAZP();
+	void OpLDXZP();
+	void OpTAY();
+	void OpLDAIM();
+	void OpTAX();
+	void OpLDYABS();
+	void OpLDAABS();
+	void OpLDXABS();
+	void OpBCS();
+	void OpLDAIndY();
+	void OpLDYZPX();
+	void OpLDAZPX();
+	void OpLDXZPY();
+	void OpCLV();
+	void OpLDAABSY();
+	void OpTSX();
+	void OpLDYABSX();
+	void OpLDAABSX();
+	void OpLDXABSY();
+	void OpCPYIM();
+	void OpCMPIndX();
+	void OpCPYZP();
+	void OpCMPZP();
+	void OpDECZP();
+	void OpINY();
+	void OpCMPIM();
+	void OpDEX();
+	void OpCPYABS();
+	void OpCMPABS();
+	void OpDECABS();
+	void OpBNE();
+	void OpCMPIndY();
+	void OpCMPZPX();
+	void OpDECZPX();
+	void OpCLD();
+	void OpCMPABSY();
+	void OpCMPABSX();
+	void OpDECABSX();
+	void OpCPXIM();
+	void OpSBCIndX();
+	void OpCPXZP();
+	void OpSBCZP();
+	void OpINCZP();
+	void OpINX();
+	void OpSBCIM();
+	void OpNOP();
+	void OpCPXABS();
+	void OpSBCABS();
+	void OpINCABS();
+	void OpBEQ();
+	void OpSBCIndY();
+	void OpSBCZPX();
+	void OpINCZPX();
+	void OpSED();
+	void OpSBCABSY();
+	void OpSBCABSX();
+	void OpINCABSX();
 };
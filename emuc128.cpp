@@ -79,27 +79,64 @@
 #endif
 #include <stdlib.h>
 
-extern int main_go_num;
-
-EmuC128::EmuC128()
-    : EmuCBM(new C128Memory())
+EmuC128::EmuC128(unsigned fast_paths)
+    : EmuCBM(new C128Memory(), fast_paths)
 {
     c128memory = (C128Memory*)memory;
-    File_ReadAllBytes(c128memory->basic_lo_rom, C128Memory::basic_lo_size, "roms/c128/basiclo");
-    File_ReadAllBytes(c128memory->basic_hi_rom, C128Memory::basic_hi_size, "roms/c128/basichi");
-    File_ReadAllBytes(c128memory->char_rom, C128Memory::chargen_size, "roms/c128/chargen");
-    File_ReadAllBytes(c128memory->kernal_rom, C128Memory::kernal_size, "roms/c128/kernal");
+    File_ReadRom(c128memory->basic_lo_rom, C128Memory::basic_lo_size, "roms/c128/basiclo");
+    File_ReadRom(c128memory->basic_hi_rom, C128Memory::basic_hi_size, "roms/c128/basichi");
+    File_ReadRom(c128memory->char_rom, C128Memory::chargen_size, "roms/c128/chargen");
+    File_ReadRom(c128memory->kernal_rom, C128Memory::kernal_size, "roms/c128/kernal");
+    c128memory->emu = this;
+    SetBootKey("c128", 128);
+    SetTrap(0x4D37); // READY
+    SetTrap(0x5A4A); // GO next token is not TO
+    SetTrap(0x5A4D); // GO value evaluated
+    SetChrget(0x0380);
+    SetTrap(0xF26C); // LOAD vector's default target
+    SetTrap(0xF54E); // SAVE vector's default target
+}
+
+EmuC128::EmuC128(C128Memory* memory)
+    : EmuCBM(memory, 0) // ForkState() copies fast_paths
+{
+    c128memory = memory;
+    c128memory->emu = this;
 }
 
 EmuC128::~EmuC128()
 {
 }
 
-static int startup_state = 0;
-static bool esc_mode = false;
+void EmuC128::Go64()
+{
+    go_num = 64;
+    quit = true;
+}
+
+// ROMs as currently configured by MMU, screen editor is start of KERNAL ROM
+const char* EmuC128::GetRegionName(ushort addr)
+{
+    if (c128memory->IsBasicLow(addr) || c128memory->IsBasicHigh(addr))
+        return "BASIC";
+    if (c128memory->IsKernal(addr))
+        return (addr < 0xD000) ? "EDIT" : "KERNAL";
+    return 0;
+}
+
+Emu6502* EmuC128::Fork()
+{
+    EmuC128* child = new EmuC128(new C128Memory(c128memory));
+    ForkState(child);
+    child->startup_state = startup_state;
+    child->esc_mode = esc_mode;
+    return child;
+}
 
 bool EmuC128::ExecutePatch()
 {
+    if (ExecuteFastChrget())
+        return true;
     if (PC == 0xFFD2)
     {
         if (A == 27)
@@ -111,33 +148,25 @@ bool EmuC128::ExecutePatch()
         }
         return EmuCBM::ExecutePatch();
     }
-    if (GetMemory(PC) == 0x6C && GetMemory((ushort)(PC + 1)) == 0x30 && GetMemory((ushort)(PC + 2)) == 0x03) // catch JMP(LOAD_VECTOR), redirect to jump table
+    if (PC == 0xF26C && c128memory->IsKernal(PC)) // catch JMP(LOAD_VECTOR) at its default target, redirect to jump table
     {
-        int addr128k = 0x330;
-        if (c128memory->IsRam(addr128k, false) && addr128k == 0x330)
-        {
-            CheckBypassSETLFS();
-            CheckBypassSETNAM();
-            // note: A register has same purpose LOAD/VERIFY
-            X = GetMemory(0xC3);
-            Y = GetMemory(0xC4);
-            PC = 0xFFD5; // use KERNAL JUMP TABLE instead, so LOAD is hooked by base
-            return true; // re-execute
-        }
+        CheckBypassSETLFS();
+        CheckBypassSETNAM();
+        // note: A register has same purpose LOAD/VERIFY
+        X = GetMemory(0xC3);
+        Y = GetMemory(0xC4);
+        PC = 0xFFD5; // use KERNAL JUMP TABLE instead, so LOAD is hooked by base
+        return true; // re-execute
     }
-    if (GetMemory(PC) == 0x6C && GetMemory((ushort)(PC + 1)) == 0x32 && GetMemory((ushort)(PC + 2)) == 0x03) // catch JMP(SAVE_VECTOR), redirect to jump table
+    if (PC == 0xF54E && c128memory->IsKernal(PC)) // catch JMP(SAVE_VECTOR) at its default target, redirect to jump table
     {
-        int addr128k = 0x332;
-        if (c128memory->IsRam(addr128k, false) && addr128k == 0x332)
-        {
-            CheckBypassSETLFS();
-            CheckBypassSETNAM();
-            X = GetMemory(0xAE);
-            Y = GetMemory(0xAF);
-            A = 0xC1;
-            PC = 0xFFD8; // use KERNAL JUMP TABLE instead, so SAVE is hooked by base
-            return true; // re-execute
-        }
+        CheckBypassSETLFS();
+        CheckBypassSETNAM();
+        X = GetMemory(0xAE);
+        Y = GetMemory(0xAF);
+        A = 0xC1;
+        PC = 0xFFD8; // use KERNAL JUMP TABLE instead, so SAVE is hooked by base
+        return true; // re-execute
     }
 
     // Note: BANK # (0-15) for file i/o is in $C6
@@ -169,6 +198,7 @@ bool EmuC128::ExecutePatch()
     }
     else if ((PC == 0x4D37 || PC == LOAD_TRAP) && (c128memory->IsBasicLow(PC) || c128memory->IsBasicHigh(PC))) // READY
     {
+        ReadyReached();
         if (startup_state == 0 && (StartupPRG != 0 || PC == LOAD_TRAP))
         {
             bool is_basic;
@@ -249,7 +279,7 @@ bool EmuC128::ExecutePatch()
             }
             else
             {
-                //CBM_Console_Push("RUN\r");
+                //console->Push("RUN\r");
                 PC = 0xA47B; // skip READY message, but still set direct mode, and continue to MAIN
             }
             C = false; // signal success
@@ -261,7 +291,7 @@ bool EmuC128::ExecutePatch()
     else if (PC == 0x05A4A) // GO next token is not TO, used to catch 2001 as ASCII
     {
         ushort addr = (ushort)(GetMemory(0x3D) | (GetMemory(0x3E) << 8)); // pointer to current token in buffer
-        static char s[81];
+        char s[81];
         s[0] = 0;
         while (strlen(s) < 80) // some limit
         {
@@ -271,10 +301,10 @@ bool EmuC128::ExecutePatch()
             else if (c == 0 || strlen(s) > 0)
                 break;
         }
-        int go_num = atoi(s);
-        if (go_num == 2001)
+        int num = atoi(s);
+        if (num == 2001)
         {
-            main_go_num = go_num;
+            go_num = num;
             quit = true;
             return true;
         }
@@ -283,18 +313,12 @@ bool EmuC128::ExecutePatch()
     {
         if (X != 64)
         {
-            main_go_num = X;
+            go_num = X;
             quit = true;
             return true;
         }
     }
 
-    if (main_go_num == 64)
-    {
-        quit = true;
-        return true;
-    }
-
     return EmuCBM::ExecutePatch();
 }
 
@@ -306,7 +330,7 @@ void EmuC128::CheckBypassSETNAM()
     // In case caller bypassed calling SETNAM, get from lower memory
     byte name_len = GetMemory(0xB7);
     ushort name_addr = (ushort)(GetMemory(0xBB) | (GetMemory(0xBC) << 8));
-    static char name[256];
+    char* name = FileNameBuffer;
 
     SetMemory(0xFF00, GetMemory((ushort)(0xF7F0 + GetMemory(0xC7)))); // switch to name bank
 
@@ -356,15 +380,14 @@ static const int chargen_addr = io_addr;
 
 C128Memory::C128Memory()
 {
-    ram = new byte[ram_size];
-
-    for (int i = 0; i < ram_size; ++i)
-        ram[i] = 0;
+    ram = new CowRam(ram_size);
+    color_nybles = 0;
 
-    basic_lo_rom = new byte[basic_lo_size];
-    basic_hi_rom = new byte[basic_hi_size];
-    char_rom = new byte[chargen_size];
-    kernal_rom = new byte[kernal_size];
+    roms = std::shared_ptr<byte>(new byte[basic_lo_size + basic_hi_size + chargen_size + kernal_size], std::default_delete<byte[]>());
+    basic_lo_rom = roms.get();
+    basic_hi_rom = basic_lo_rom + basic_lo_size;
+    char_rom = basic_hi_rom + basic_hi_size;
+    kernal_rom = char_rom + chargen_size;
 
     io = new byte[io_size];
     for (int i = 0; i < io_size; ++i)
@@ -385,22 +408,51 @@ C128Memory::C128Memory()
     io[0xDD01 - io_addr] = 0xFF; // CIA #2 PORT B
 
     vdc = new VDC8563();
+
+    RemapPages();
+}
+
+C128Memory::C128Memory(C128Memory* parent)
+{
+    ram = new CowRam(parent->ram);
+    color_nybles = 0;
+
+    roms = parent->roms;
+    basic_lo_rom = parent->basic_lo_rom;
+    basic_hi_rom = parent->basic_hi_rom;
+    char_rom = parent->char_rom;
+    kernal_rom = parent->kernal_rom;
+
+    io = new byte[io_size];
+    memcpy(io, parent->io, io_size);
+    go64 = parent->go64;
+
+    vdc = new VDC8563(parent->vdc);
+
+    RemapPages();
+    parent->RemapPages(); // parent no longer owns its pages either
 }
 
 C128Memory::~C128Memory()
 {
-    delete[] basic_lo_rom;
-    delete[] basic_hi_rom;
-    delete[] char_rom;
-    delete[] kernal_rom;
-    
-    delete[] ram;
+    delete ram;
     delete[] io;
     delete[] color_nybles;
 
     delete vdc;
 }
 
+bool C128Memory::SerializeState(Emu6502::StateIO& io)
+{
+    ram->SerializeState(io);
+    io.Bytes(this->io, io_size);
+    io.Value(go64);
+    vdc->SerializeState(io);
+    if (!io.IsSaving())
+        RemapPages(); // MMU registers restored with I/O
+    return true;
+}
+
 static void ApplyColor()
 {
 //    CBM_Console.Reverse = (this[243] != 0);
@@ -465,14 +517,14 @@ static void CheckLowercase()
 
 byte C128Memory::read(ushort addr)
 {
-    int addr128k = addr;
     if (addr >= 0xFF00 && addr <= 0xFF04)
         return io[mmu_addr + (addr & 0xF) - io_addr];
-    else if (IsRam(addr128k, false))
-        return ram[addr128k];
-    else if (IsIO(addr))
+    byte* page = read_map[addr >> 8];
+    if (page != 0)
+        return page[addr & 0xFF];
+    else if (io_enabled && addr >= io_addr && addr < io_addr + io_size)
     {
-        if (IsColor(addr))
+        if (addr >= color_addr && addr < color_addr + color_size)
             return (byte)((io[addr - io_addr] & 0xF) | 0xF0);
         else if (addr == 0xD011)
             io[addr - io_addr] ^= 0x80; // toggle 9th raster line bit, so seems like raster is moving
@@ -483,31 +535,21 @@ byte C128Memory::read(ushort addr)
 
         return io[addr - io_addr];
     }
-    else if (IsBasicLow(addr))
-        return basic_lo_rom[addr - basic_lo_addr];
-    else if (IsBasicHigh(addr))
-        return basic_hi_rom[addr - basic_hi_addr];
-    else if (IsChargen(addr))
-        return char_rom[addr - chargen_addr];
-    else if (IsKernal(addr))
-        return kernal_rom[addr - kernal_addr];
     else
         return 0xFF;
 }
 
 void C128Memory::write(ushort addr, byte value)
 {
-    if (addr == 0xFF00) // CR mirror
-        io[mmu_addr - io_addr] = value; // CR
-    else if (addr == 0xFF01) // LCRA
-        io[mmu_addr - io_addr] = io[mmu_addr - io_addr + 1];
-    else if (addr == 0xFF02) // LCRA
-        io[mmu_addr - io_addr] = io[mmu_addr - io_addr + 2];
-    else if (addr == 0xFF03) // LCRA
-        io[mmu_addr - io_addr] = io[mmu_addr - io_addr + 3];
-    else if (addr == 0xFF04) // LCRA
-        io[mmu_addr - io_addr] = io[mmu_addr - io_addr + 4];
-    else if (IsIO(addr))
+    if (addr >= 0xFF00 && addr <= 0xFF04)
+    {
+        if (addr == 0xFF00) // CR mirror
+            io[mmu_addr - io_addr] = value; // CR
+        else // LCRA-LCRD
+            io[mmu_addr - io_addr] = io[mmu_addr - io_addr + (addr & 0xF)];
+        RemapPages();
+    }
+    else if (io_enabled && addr >= io_addr && addr < io_addr + io_size)
     {
         if (addr == 0xD021) // background
         {
@@ -518,10 +560,17 @@ void C128Memory::write(ushort addr, byte value)
         {
             //System.Diagnostics.Debug.WriteLine($"Mode Configuration Register set 0x{value:X02}");
             if ((value & 0x40) != 0)
-                main_go_num = 64;
+            {
+                go64 = true;
+                if (emu != 0)
+                    emu->Go64();
+            }
         }
         else if (addr >= mmu_addr && addr < mmu_addr + mmu_size - 1) // MMU up to but not including version register
+        {
             io[addr - io_addr] = value;
+            RemapPages();
+        }
         else if (addr == 0xD600)
             vdc->SetAddressRegister(value);
         else if (addr == 0xD601)
@@ -530,10 +579,12 @@ void C128Memory::write(ushort addr, byte value)
     }
     else
     {
-        int addr128k = addr;
-        if (IsRam(addr128k, true))
+        int ram_page = write_ram_page[addr >> 8];
+        if (ram_page >= 0)
         {
-            ram[addr128k] = value;
+            int addr128k = (ram_page << 8) | (addr & 0xFF);
+            if (ram->Write(addr128k, value)) // first write since fork, page copied
+                RemapPages();
             if (addr128k == 241 || addr128k == 243)
                 ApplyColor();
             else if (addr128k == 0xA2C || addr128k == 0xF1)
@@ -570,6 +621,15 @@ bool C128Memory::IsBasicLow(ushort addr)
     return (addr >= basic_lo_addr && addr < basic_lo_addr + basic_lo_size && (mmu_cr & 0x02) == 0);
 }
 
+// BASIC, editor or KERNAL, as the MMU maps them now
+bool C128Memory::IsRomPage(byte page)
+{
+    byte* read_page = read_map[page];
+    return (read_page >= basic_lo_rom && read_page < basic_lo_rom + basic_lo_size)
+        || (read_page >= basic_hi_rom && read_page < basic_hi_rom + basic_hi_size)
+        || (read_page >= kernal_rom && read_page < kernal_rom + kernal_size);
+}
+
 bool C128Memory::IsColor(ushort addr)
 {
     return IsIO(addr) && addr >= color_addr && addr < color_addr + color_size;
@@ -644,14 +704,44 @@ bool C128Memory::IsRam(int& addr, bool isWrite = false)
     return true;
 }
 
-byte EmuC128::GetMemory(ushort addr)
+// Rebuild translation cache for current MMU configuration, decoding each CPU
+// page once to a physical RAM or ROM page, so read()/write() are a lookup.
+// Only called when $D500-$D50A or $FF00-$FF04 are written.
+// The CPU fast path gets the same pages, except I/O and the $FF00-$FF04 MMU
+// mirror page, and writes to RAM pages with hooks (241/243 colors, $A2C/$F1 lowercase)
+void C128Memory::RemapPages()
 {
-    return memory->read(addr);
-}
+    io_enabled = IsIO(io_addr);
+    for (int page = 0; page < 0x100; ++page)
+    {
+        ushort addr = (ushort)(page << 8);
+        byte* read_page = 0;
+        int ram_page = -1;
+        if (!IsIO(addr))
+        {
+            int addr128k = addr;
+            if (IsRam(addr128k, false))
+                read_page = ram->Page(addr128k >> 8);
+            else if (IsBasicLow(addr))
+                read_page = &basic_lo_rom[addr - basic_lo_addr];
+            else if (IsBasicHigh(addr))
+                read_page = &basic_hi_rom[addr - basic_hi_addr];
+            else if (IsChargen(addr))
+                read_page = &char_rom[addr - chargen_addr];
+            else if (IsKernal(addr))
+                read_page = &kernal_rom[addr - kernal_addr];
+
+            addr128k = addr;
+            if (IsRam(addr128k, true))
+                ram_page = addr128k >> 8;
+        }
+        read_map[page] = read_page;
+        write_ram_page[page] = ram_page;
 
-void EmuC128::SetMemory(ushort addr, byte value)
-{
-    memory->write(addr, value);
+        bool hooked = (ram_page == 0 || ram_page == 0x0A);
+        bool fast_write = (ram_page >= 0 && page != 0xFF && !hooked && ram->IsOwned(ram_page)); // shared pages copied by write()
+        MapPages(page, 1, (page == 0xFF) ? 0 : read_page, fast_write ? ram->Page(ram_page) : 0);
+    }
 }
 
 // VDC8563 ////////////////////////////////////////////////////////////
@@ -674,12 +764,32 @@ VDC8563::VDC8563()
     memset(vdc_ram, 0, vdc_ram_size);
 }
 
+VDC8563::VDC8563(VDC8563* other)
+{
+    registers = new byte[registers_size];
+    memcpy(registers, other->registers, registers_size);
+    vdc_ram = new byte[vdc_ram_size];
+    memcpy(vdc_ram, other->vdc_ram, vdc_ram_size);
+    register_addr = other->register_addr;
+    data = other->data;
+    ready = other->ready;
+}
+
 VDC8563::~VDC8563()
 {
     delete[] registers;
     delete[] vdc_ram;
 }
 
+void VDC8563::SerializeState(Emu6502::StateIO& io)
+{
+    io.Bytes(registers, registers_size);
+    io.Bytes(vdc_ram, vdc_ram_size);
+    io.Value(register_addr);
+    io.Value(data);
+    io.Value(ready);
+}
+
 byte VDC8563::GetAddressRegister()
 {
     if (ready)
@@ -1,24 +1,34 @@
 #pragma once
 
 #include "emucbm.h"
+#include "cowram.h"
+
+#include <memory>
 
 class C128Memory;
 
 class EmuC128 : public EmuCBM
 {
 public:
-	EmuC128();
+	EmuC128(unsigned fast_paths = DefaultFastPaths);
 	virtual ~EmuC128();
+	virtual Emu6502* Fork();
+	virtual const char* GetRegionName(ushort addr);
+	virtual int GetBasicLineAddress() { return 0x3B; }
+	void Go64(); // C64 mode selected through MMU, stops to GO 64
 
 protected:
 	bool ExecutePatch();
 
 private:
 	C128Memory* c128memory; 
-	byte GetMemory(ushort addr);
-	void SetMemory(ushort addr, byte value);
 	void CheckBypassSETNAM();
 	void CheckBypassSETLFS();
+	EmuC128(C128Memory* memory); // for Fork()
+
+private:
+	int startup_state = 0;
+	bool esc_mode = false;
 
 private:
 	EmuC128(const EmuC128& other); // disabled
@@ -36,21 +46,26 @@ private:
 
 public:
 	VDC8563();
+	VDC8563(VDC8563* other); // copy, for fork
 	~VDC8563();
 
 	byte GetAddressRegister();
 	void SetAddressRegister(byte value);
 	byte GetDataRegister();
 	void SetDataRegister(byte value);
+	void SerializeState(Emu6502::StateIO& io);
 };
 
 class C128Memory : public Emu6502::Memory
 {
 public:
 	C128Memory();
+	C128Memory(C128Memory* parent); // fork, RAM shared copy-on-write, ROM shared, VDC copied
 	virtual ~C128Memory();
 	virtual byte read(ushort addr);
 	virtual void write(ushort addr, byte value);
+	virtual bool SerializeState(Emu6502::StateIO& io);
+	virtual bool IsRomPage(byte page);
 	bool IsChargen(ushort addr);
 	bool IsKernal(ushort addr);
 	bool IsBasicHigh(ushort addr);
@@ -59,6 +74,9 @@ public:
 	bool IsIO(ushort addr);
 	bool IsRam(int& addr, bool isWrite);
 
+private:
+	void RemapPages();
+
 public:
 	byte* basic_lo_rom;
 	byte* basic_hi_rom;
@@ -70,12 +88,22 @@ public:
 	static const int chargen_size = 0x1000;
 	static const int kernal_size = 0x4000;
 
+	bool go64 = false; // set by C64 mode write to $D505, EmuC128 quits to GO 64
+	EmuC128* emu = 0; // told of C64 mode, not owned
+
 private:
-	byte* ram;
+	CowRam* ram;
+	std::shared_ptr<byte> roms; // basic lo, basic hi, char, kernal in one block, shared with forks
 	byte* io;
 	byte* color_nybles;
 	VDC8563* vdc;
 
+	// translation cache, CPU page to physical RAM/ROM page, 0 for I/O
+	byte* read_map[256];
+	int write_ram_page[256]; // CPU page to physical RAM page number, -1 for none
+
+	bool io_enabled;
+
 private:
 	C128Memory(const C128Memory& other); // disabled
 	bool operator==(const C128Memory& other) const; // disabled
@@ -86,31 +86,64 @@ extern "C" int gettimeofday(struct timeval* tp, struct timezone* tzp);
 #include <sys/time.h> // gettimeofday, struct timeval
 #endif
 
-extern const char* StartupPRG;
-static int startup_state = 0;
-
 #include "emuc64.h"
+#include "basicfloat.h"
+#include "basicmemory.h"
+
+EmuC64::EmuC64(int ram_size, unsigned fast_paths)
+	: EmuCBM(new C64Memory(ram_size), fast_paths)
+{
+	File_ReadRom(((C64Memory*)memory)->basic_rom, C64Memory::basic_rom_size, "roms/c64/basic");
+	File_ReadRom(((C64Memory*)memory)->char_rom, C64Memory::char_rom_size, "roms/c64/chargen");
+	File_ReadRom(((C64Memory*)memory)->kernal_rom, C64Memory::kernal_rom_size, "roms/c64/kernal");
+	SetBootKey("c64", ram_size);
+	SetTrap(0xA474); // READY
+	SetTrap(0xA815); // Execute after GO
+	SetChrget(0x0073);
+	basic_float = (fast_paths & FastFloat) != 0 && BasicFloat::IsBasicV2(((C64Memory*)memory)->basic_rom);
+	for (ushort addr = 0xA000; basic_float && addr < 0xC000; ++addr)
+		if (BasicFloat::Find(addr) >= 0)
+			SetTrap(addr); // fast path
+	basic_memory = (fast_paths & FastStrings) != 0 && BasicMemory::IsBasicV2(((C64Memory*)memory)->basic_rom);
+	if (basic_memory)
+	{
+		SetTrap(0xA3BF); // BLTU, fast path
+		SetTrap(0xB526); // GARBAG
+	}
+	SetTrap(0xF4A5); // LOAD vector's default target
+	SetTrap(0xF5ED); // SAVE vector's default target
+	TrapKernalLoops(0xE000, 0x10000);
+}
 
-EmuC64::EmuC64(int ram_size)
-	: EmuCBM(new C64Memory(ram_size))
+EmuC64::EmuC64(C64Memory* memory)
+	: EmuCBM(memory, 0) // ForkState() copies fast_paths
 {
-	File_ReadAllBytes(((C64Memory*)memory)->basic_rom, C64Memory::basic_rom_size, "roms/c64/basic");
-	File_ReadAllBytes(((C64Memory*)memory)->char_rom, C64Memory::char_rom_size, "roms/c64/chargen");
-	File_ReadAllBytes(((C64Memory*)memory)->kernal_rom, C64Memory::kernal_rom_size, "roms/c64/kernal");
 }
 
 EmuC64::~EmuC64()
 {
 }
 
-byte EmuC64::GetMemory(ushort addr)
+// ROMs as currently banked in by $01
+const char* EmuC64::GetRegionName(ushort addr)
 {
-	return memory->read(addr);
+	byte banking = GetMemory(1) & 7;
+	if (addr >= 0xA000 && addr < 0xC000 && (banking & 3) == 3)
+		return "BASIC";
+	if (addr >= 0xE000 && (banking & 2) != 0)
+		return "KERNAL";
+	return 0;
 }
 
-void EmuC64::SetMemory(ushort addr, byte value)
+Emu6502* EmuC64::Fork()
 {
-	memory->write(addr, value);
+	EmuC64* child = new EmuC64(new C64Memory((C64Memory*)memory));
+	ForkState(child);
+	child->go_state = go_state;
+	child->startup_state = startup_state;
+	child->basic_float = basic_float;
+	child->basic_memory = basic_memory;
+	return child;
 }
 
 void EmuC64::CheckBypassSETNAM()
@@ -118,8 +151,8 @@ void EmuC64::CheckBypassSETNAM()
 	// In case caller bypassed calling SETNAM, get from lower memory
 	byte name_len = GetMemory(0xB7);
 	ushort name_addr = (ushort)(GetMemory(0xBB) | (GetMemory(0xBC) << 8));
-	static char name[256];
-	memset(name, 0, sizeof(name));
+	char* name = FileNameBuffer;
+	memset(name, 0, sizeof(FileNameBuffer));
 	for (int i = 0; i < name_len; ++i)
 		name[i] = GetMemory(name_addr + i);
 	name[name_len] = 0;
@@ -142,10 +175,83 @@ void EmuC64::CheckBypassSETLFS()
 	}
 }
 
+// BASIC floating point arithmetic natively, as the ROM routine at PC would
+bool EmuC64::ExecuteFastFloat()
+{
+	int routine = BasicFloat::Find(PC);
+	if (routine < 0 || !((C64Memory*)memory)->IsBasicIn())
+		return false; // not an entry, or BASIC banked out
+	BasicFloat basic(this);
+	byte p = GetP();
+	if (!basic.Run((BasicFloat::Routine)routine, A, X, Y, p))
+		return false; // ROM raises the error
+	EmuCBM* rom = verify_fast_paths ? EmulateRoutine() : 0;
+	basic.Store(A, X, Y, p);
+	SetP(p);
+	ExecuteRTS();
+	MemoryRange zero_page = { 0x0000, 0x0070 }; // the part it uses
+	VerifyFastPath(rom, BasicFloat::GetName(routine), &zero_page, 1);
+	return true;
+}
+
+// BASIC string garbage collection and block move natively, as the ROM routine at PC would
+bool EmuC64::ExecuteFastStrings()
+{
+	int routine = BasicMemory::Find(PC);
+	if (routine < 0 || !((C64Memory*)memory)->IsBasicIn())
+		return false; // not an entry, or BASIC banked out
+	if (D)
+		return false; // decimal mode ADC/SBC left to the ROM
+	// the strings and descriptors, or the block moved to
+	ushort start = (ushort)(GetMemory(0x2D) | (GetMemory(0x2E) << 8)); // VARTAB
+	ushort end = (ushort)(GetMemory(0x37) | (GetMemory(0x38) << 8)); // MEMSIZ
+	if (routine == BasicMemory::BLTU)
+	{
+		ushort lowtr = (ushort)(GetMemory(0x5F) | (GetMemory(0x60) << 8));
+		ushort count = (ushort)((GetMemory(0x5A) | (GetMemory(0x5B) << 8)) - lowtr);
+		if (!IsMapped(lowtr, count))
+			return false; // reads I/O, left to the ROM to read it when it would
+		end = (ushort)(GetMemory(0x58) | (GetMemory(0x59) << 8)); // HIGHDS
+		start = (ushort)(end - count);
+		if (!IsMapped(start, count))
+			return false;
+	}
+	else if (start < end && !IsMapped(start, (ushort)(end - start)))
+		return false;
+	EmuCBM* rom = 0;
+	MemoryRange ranges[3] = { { 0x0000, 0x009F }, { 0x0100, 0x01FF } }; // zero page it uses, stack
+	int range_count = 2;
+	if (verify_fast_paths)
+	{
+		if (start < end)
+		{
+			ranges[range_count].start = start;
+			ranges[range_count++].end = (ushort)(end - 1);
+		}
+		rom = EmulateRoutine();
+	}
+	BasicMemory basic(this);
+	byte p = GetP();
+	basic.Run((BasicMemory::Routine)routine, A, X, Y, p, S);
+	SetP(p);
+	ExecuteRTS();
+	VerifyFastPath(rom, BasicMemory::GetName(routine), ranges, range_count);
+	return true;
+}
+
 bool EmuC64::ExecutePatch()
 {
+	if (ExecuteFastChrget())
+		return true;
+	if ((fast_paths & FastFloat) != 0 && basic_float && ExecuteFastFloat())
+		return true;
+	if ((fast_paths & FastStrings) != 0 && basic_memory && ExecuteFastStrings())
+		return true;
+	if (ExecuteFastKernal())
+		return true;
 	if (PC == 0xA474 || PC == LOAD_TRAP) // READY
 	{
+		ReadyReached();
 		if (startup_state == 0 && ((StartupPRG != 0 && strlen(StartupPRG) > 0) || PC == LOAD_TRAP))
 		{
 			bool is_basic;
@@ -240,7 +346,7 @@ bool EmuC64::ExecutePatch()
 				Y = HI(FileAddr);
 			}
 			else {
-				CBM_Console_Push("RUN\r");
+				console->Push("RUN\r");
 				PC = 0xA47B; // skip READY message, but still set direct mode, and continue to MAIN
 			}
 			C = false; // signal success
@@ -263,15 +369,13 @@ bool EmuC64::ExecutePatch()
 		}
 		else if (go_state == 2)
 		{
-			extern int main_go_num;
-
-			main_go_num = (ushort)(Y + (A << 8));
+			go_num = (ushort)(Y + (A << 8));
 			quit = true;
 			return true;
 		}
 	}	
 	
-	if (GetMemory(PC) == 0x6C && GetMemory((ushort)(PC + 1)) == 0x30 && GetMemory((ushort)(PC + 2)) == 0x03) // catch JMP(LOAD_VECTOR), redirect to jump table
+	if (PC == 0xF4A5 && memory->IsRomPage(0xF4)) // catch JMP(LOAD_VECTOR) at its default target, redirect to jump table
 	{
 		CheckBypassSETLFS();
 		CheckBypassSETNAM();
@@ -281,7 +385,7 @@ bool EmuC64::ExecutePatch()
 		PC = 0xFFD5; // use KERNAL JUMP TABLE instead, so LOAD is hooked by base
 		return true; // re-execute
 	}
-	if (GetMemory(PC) == 0x6C && GetMemory((ushort)(PC + 1)) == 0x32 && GetMemory((ushort)(PC + 2)) == 0x03) // catch JMP(SAVE_VECTOR), redirect to jump table
+	if (PC == 0xF5ED && memory->IsRomPage(0xF5)) // catch JMP(SAVE_VECTOR) at its default target, redirect to jump table
 	{
 		CheckBypassSETLFS();
 		CheckBypassSETNAM();
@@ -314,14 +418,13 @@ const int color_nybles_size = 1024;
 C64Memory::C64Memory(int memory_size)
 {
 	ram_size = memory_size;
-	ram = new byte[ram_size];
-	basic_rom = new byte[basic_rom_size];
-	char_rom = new byte[char_rom_size];
-	kernal_rom = new byte[kernal_rom_size];
+	ram = new CowRam(ram_size);
+	roms = std::shared_ptr<byte>(new byte[basic_rom_size + char_rom_size + kernal_rom_size], std::default_delete<byte[]>());
+	basic_rom = roms.get();
+	char_rom = basic_rom + basic_rom_size;
+	kernal_rom = char_rom + char_rom_size;
 	color_nybles = new byte[color_nybles_size];
 
-	for (int i = 0; i < ram_size; ++i)
-		ram[i] = 0;
 	for (int i = 0; i < color_nybles_size; ++i)
 		color_nybles[i] = 0;
 
@@ -330,15 +433,31 @@ C64Memory::C64Memory(int memory_size)
 	//	io[i] = 0;
 
 	// initialize DDR and memory mapping to defaults
-	ram[0] = 0xEF;
-	ram[1] = 0x07;
+	ram->Write(0, 0xEF);
+	ram->Write(1, 0x07);
+	MapBanks();
+	SelectBank();
+}
+
+C64Memory::C64Memory(C64Memory* parent)
+{
+	ram_size = parent->ram_size;
+	ram = new CowRam(parent->ram);
+	roms = parent->roms;
+	basic_rom = parent->basic_rom;
+	char_rom = parent->char_rom;
+	kernal_rom = parent->kernal_rom;
+	color_nybles = new byte[color_nybles_size];
+	memcpy(color_nybles, parent->color_nybles, color_nybles_size);
+
+	MapBanks();
+	SelectBank();
+	parent->MapBanks(); // parent no longer owns its pages either
 }
 
 C64Memory::~C64Memory()
 {
-	delete[] ram;
-	delete[] basic_rom;
-	delete[] kernal_rom;
+	delete ram;
 	delete[] color_nybles;
 }
 
@@ -359,48 +478,43 @@ byte C64Memory::read(ushort addr)
 
 			unsigned long jiffies = ((bd.tm_hour*60 + bd.tm_min)*60 + bd.tm_sec)*60 + tv.tv_usec / (1000000/60);
 
-			ram[0xa0] = (unsigned char)(jiffies >> 16);
-			ram[0xa1] = (unsigned char)(jiffies >> 8);
-			ram[0xa2] = (unsigned char)(jiffies);
+			ram->Write(0xa0, (unsigned char)(jiffies >> 16));
+			ram->Write(0xa1, (unsigned char)(jiffies >> 8));
+			if (ram->Write(0xa2, (unsigned char)(jiffies)))
+				MapBanks();
 	}
 
-	if (addr < ram_size 
-		  && (
-			  addr < basic_addr // always RAM
-			  || (addr >= open_addr && addr < open_addr + open_size) // always open RAM C000.CFFF
-			  || (((ram[1] & 3) != 3) && addr >= basic_addr && addr < basic_addr + basic_rom_size) // RAM banked instead of BASIC
-			  || (((ram[1] & 2) == 0) && addr >= kernal_addr && addr <= kernal_addr + kernal_rom_size - 1) // RAM banked instead of KERNAL
-			  || (((ram[1] & 3) == 0) && addr >= io_addr && addr < io_addr + io_size) // RAM banked instead of IO
-		  )
-		)
-		return ram[addr];
-	else if (addr >= basic_addr && addr < basic_addr + basic_rom_size)
-		return basic_rom[addr - basic_addr];
+	if (addr < 0x100) // zero page is trapped for RDTIM and $01 banking, but always RAM
+		return ram->Read(addr);
+	byte* page = read_pages[addr >> 8]; // current bank map
+	if (page != 0)
+		return page[addr & 0xFF];
+	else if (addr >= color_addr && addr < color_addr + color_nybles_size)
+		return color_nybles[addr - color_addr] | 0xF0;
 	else if (addr >= io_addr && addr < io_addr + io_size)
-	{
-		if ((ram[1] & 4) == 0)
-			return char_rom[addr - io_addr];
-		else if (addr >= color_addr && addr < color_addr + color_nybles_size)
-			return color_nybles[addr - color_addr] | 0xF0;
-		else
-			return 0; // io[addr - io_addr];
-	}
-	else if (addr >= kernal_addr && addr <= kernal_addr + kernal_rom_size - 1)
-		return kernal_rom[addr - kernal_addr];
+		return 0; // io[addr - io_addr];
 	else
 		return 0xFF;
 }
 
 void C64Memory::write(ushort addr, byte value)
 {
-	if (addr <= ram_size-1
-		&& (
-			addr < io_addr // RAM, including open RAM, and RAM under BASIC
-			|| (addr >= kernal_addr && addr <= kernal_addr + kernal_rom_size - 1) // RAM under KERNAL
-			|| (((ram[1] & 7) == 0) && addr >= io_addr && addr < io_addr + io_size) // RAM banked in instead of IO
-			)
-		)
-		ram[addr] = value;
+	if (addr < 0x100) // zero page is trapped for $01 banking, but always RAM
+	{
+		if (ram->Write(addr, value))
+			MapBanks();
+		if (addr == 1) // LORAM/HIRAM/CHAREN changed
+			SelectBank();
+		return;
+	}
+	byte* page = write_pages[addr >> 8]; // current bank map
+	if (page != 0)
+		page[addr & 0xFF] = value;
+	else if (addr < ram_size && !(addr >= io_addr && addr < io_addr + io_size && (ram->Read(1) & 7) != 0))
+	{
+		if (ram->Write(addr, value)) // first write since fork, page copied
+			MapBanks();
+	}
 	else if (addr == 0xD021) // background
 		;
 	else if (addr >= color_addr && addr < color_addr + color_nybles_size)
@@ -408,3 +522,81 @@ void C64Memory::write(ushort addr, byte value)
 	//else if (addr >= io_addr && addr < io_addr + io.Length)
 	//    io[addr - io_addr] = value;
 }
+
+bool C64Memory::SerializeState(Emu6502::StateIO& io)
+{
+	ram->SerializeState(io);
+	if (!io.IsSaving())
+		MapBanks(); // restored pages are all owned
+	io.Bytes(color_nybles, color_nybles_size);
+	if (!io.IsSaving())
+		SelectBank(); // banking follows restored $01
+	return true;
+}
+
+// Precompute page map for one LORAM/HIRAM/CHAREN configuration.
+// RAM wins where banked in, otherwise the ROM for the region, otherwise 0 for
+// I/O and missing RAM.  Zero page is always 0 so RDTIM and $01 are trapped.
+void C64Memory::MapBank(int banking)
+{
+	byte** read_map = bank_read_pages[banking];
+	byte** write_map = bank_write_pages[banking];
+	read_map[0] = write_map[0] = 0;
+	for (int page = 1; page < 0x100; ++page)
+	{
+		int addr = page << 8;
+		bool is_ram;
+		if (addr < basic_addr || (addr >= open_addr && addr < open_addr + open_size))
+			is_ram = true;
+		else if (addr >= basic_addr && addr < basic_addr + basic_rom_size)
+			is_ram = ((banking & 3) != 3); // RAM banked instead of BASIC
+		else if (addr >= io_addr && addr < io_addr + io_size)
+			is_ram = ((banking & 3) == 0); // RAM banked instead of IO
+		else
+			is_ram = ((banking & 2) == 0); // RAM banked instead of KERNAL
+		if (addr >= ram_size)
+			is_ram = false;
+
+		if (is_ram)
+			read_map[page] = ram->Page(page);
+		else if (addr >= basic_addr && addr < basic_addr + basic_rom_size)
+			read_map[page] = &basic_rom[addr - basic_addr];
+		else if (addr >= io_addr && addr < io_addr + io_size)
+			read_map[page] = ((banking & 4) == 0) ? &char_rom[addr - io_addr] : 0;
+		else if (addr >= kernal_addr)
+			read_map[page] = &kernal_rom[addr - kernal_addr];
+		else
+			read_map[page] = 0;
+
+		bool is_io = (addr >= io_addr && addr < io_addr + io_size && (banking & 7) != 0); // writes to RAM under IO only if all banked out
+		write_map[page] = (addr < ram_size && !is_io && ram->IsOwned(page)) ? ram->Page(page) : 0; // shared pages copied by write()
+	}
+}
+
+// rebuild all maps, after RAM pages have moved
+void C64Memory::MapBanks()
+{
+	for (int banking = 0; banking < 8; ++banking)
+		MapBank(banking);
+}
+
+// switch the CPU fast path to the map for the current $01 value
+void C64Memory::SelectBank()
+{
+	read_pages = bank_read_pages[ram->Read(1) & 7];
+	write_pages = bank_write_pages[ram->Read(1) & 7];
+}
+
+// BASIC or KERNAL as banked in by $01, from its map, not read_pages, which the CPU may have swapped while watching
+bool C64Memory::IsRomPage(byte page)
+{
+	byte* read_page = bank_read_pages[ram->Read(1) & 7][page];
+	return (read_page >= basic_rom && read_page < basic_rom + basic_rom_size)
+		|| (read_page >= kernal_rom && read_page < kernal_rom + kernal_rom_size);
+}
+
+// BASIC alone, the same way
+bool C64Memory::IsBasicIn()
+{
+	return bank_read_pages[ram->Read(1) & 7][basic_addr >> 8] == basic_rom;
+}
@@ -33,24 +33,36 @@
 #pragma once
 
 #include "emucbm.h"
+#include "cowram.h"
+
+#include <memory>
+
+class C64Memory;
 
 class EmuC64 : public EmuCBM
 {
 public:
-	EmuC64(int ram_size);
+	EmuC64(int ram_size, unsigned fast_paths = DefaultFastPaths);
 	virtual ~EmuC64();
+	virtual Emu6502* Fork();
+	virtual const char* GetRegionName(ushort addr);
+	virtual int GetBasicLineAddress() { return 0x39; }
 
 protected:
 	bool ExecutePatch();
 
 private:
-	byte GetMemory(ushort addr);
-	void SetMemory(ushort addr, byte value);
 	void CheckBypassSETNAM();
 	void CheckBypassSETLFS();
+	bool ExecuteFastFloat();
+	bool ExecuteFastStrings();
+	EmuC64(C64Memory* memory); // for Fork()
 
 private:
 	int go_state = 0;
+	int startup_state = 0;
+	bool basic_float = false; // FastFloat at creation and BASIC ROM has the routines BasicFloat runs, their entries trapped
+	bool basic_memory = false; // same for FastStrings and BasicMemory
 
 private:
 	EmuC64(const EmuC64& other); // disabled
@@ -61,9 +73,18 @@ class C64Memory : public Emu6502::Memory
 {
 public:
 	C64Memory(int ram_size);
+	C64Memory(C64Memory* parent); // fork, RAM shared copy-on-write, ROM shared
 	virtual ~C64Memory();
 	virtual byte read(ushort addr);
 	virtual void write(ushort addr, byte value);
+	virtual bool SerializeState(Emu6502::StateIO& io);
+	virtual bool IsRomPage(byte page);
+	bool IsBasicIn(); // BASIC ROM banked in by $01
+
+private:
+	void MapBank(int banking);
+	void MapBanks();
+	void SelectBank();
 
 public:
 	byte* basic_rom;
@@ -76,10 +97,15 @@ public:
 
 private:
 	int ram_size;
-	byte* ram;
+	CowRam* ram;
+	std::shared_ptr<byte> roms; // basic, char, kernal in one block, shared with forks
 	//byte* io;
 	byte* color_nybles;
 
+	// page maps for each LORAM/HIRAM/CHAREN configuration, selected by writes to $01
+	byte* bank_read_pages[8][256];
+	byte* bank_write_pages[8][256];
+
 private:
 	C64Memory(const C64Memory& other); // disabled
 	bool operator==(const C64Memory& other) const; // disabled
@@ -1,5 +1,12 @@
 #include "emucbm.h"
+#include "emuc64.h"
+#include "emuc128.h"
+#include "emuted.h"
+#include "emuvic20.h"
+#include "emupet.h"
 #include "cbmconsole.h"
+#include "callgraph.h"
+#include "basicprofiler.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -7,6 +14,10 @@
 #include <sys/stat.h>
 #include <time.h>
 #include <string.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #ifdef WINDOWS
 #include <io.h>
 #include <share.h>
@@ -15,16 +26,40 @@
 #include <unistd.h>
 #endif
 
-const char* EmuCBM::StartupPRG = 0;
-
 extern "C" void* D64_CreateOrLoad(const char* filename);
 extern "C" int D64_GetDirectoryProgram(void* disk, unsigned char* buffer, int* p_ret_file_len);
 extern "C" void D64_ReadFileByName(void* disk, unsigned char* filename, unsigned char* buffer, int* p_ret_file_len);
 extern "C" int D64_FileSave(void* disk, char* filename, unsigned char* buffer, int buffer_len);
-static void* disk = NULL;
 
-EmuCBM::EmuCBM(Memory* mem) : Emu6502(mem)
+bool EmuCBM::BootSnapshots = false;
+const char* EmuCBM::BootSnapshotDir = 0;
+unsigned EmuCBM::DefaultFastPaths = 0;
+bool EmuCBM::DefaultVerifyFastPaths = false;
+
+struct BootSnapshot
 {
+	std::vector<byte> output;
+	std::vector<byte> state;
+};
+
+// shared by all machines on all threads
+static std::map<std::string, std::shared_ptr<BootSnapshot> > boot_snapshots;
+static std::mutex boot_snapshots_lock;
+static std::map<std::string, std::vector<byte> > rom_cache;
+static std::mutex rom_cache_lock;
+
+static const char boot_snapshot_magic[8] = { 'C', 'B', 'M', 'S', 'N', 'A', 'P', '1' };
+
+EmuCBM::EmuCBM(Memory* mem, unsigned fast_paths) : Emu6502(mem)
+{
+	boot_key[0] = 0;
+	boot_recording = false;
+
+	StartupPRG = 0;
+	disk = 0;
+	console = CBMConsole::Standard();
+	file_buffer = 0;
+
 	FileName = NULL;
 	FileNum = 0;
 	FileDev = 0;
@@ -33,22 +68,89 @@ EmuCBM::EmuCBM(Memory* mem) : Emu6502(mem)
 	FileAddr = 0;
 
 	LOAD_TRAP = -1;
+	chrget = -1;
+
+	this->fast_paths = fast_paths;
+	verify_fast_paths = DefaultVerifyFastPaths;
+
+	// KERNAL jump table entries handled by ExecutePatch()
+	SetTrap(0xFFD2); // CHROUT
+	SetTrap(0xFFCF); // CHRIN
+	SetTrap(0xFFE4); // GETIN
+	SetTrap(0xFFBA); // SETLFS
+	SetTrap(0xFFBD); // SETNAM
+	SetTrap(0xFFD5); // LOAD
+	SetTrap(0xFFD8); // SAVE
 }
 
 EmuCBM::~EmuCBM()
 {
+	delete[] file_buffer;
+}
+
+EmuCBM* EmuCBM::Create(int go_num)
+{
+	return Create(go_num, DefaultFastPaths);
+}
+
+EmuCBM* EmuCBM::Create(int go_num, unsigned fast_paths)
+{
+	if (go_num == 128)
+		return new EmuC128(fast_paths);
+	else if (go_num == 4)
+		return new EmuTed(64, fast_paths);
+	else if (go_num == 16)
+		return new EmuTed(16, fast_paths);
+	else if (go_num == 20)
+		return new EmuVic20(5, fast_paths);
+	else if (go_num == 2001)
+		return new EmuPET(32, fast_paths);
+	else
+		return new EmuC64(64 * 1024, fast_paths);
+}
+
+void EmuCBM::ForkState(EmuCBM* child)
+{
+	Emu6502::ForkState(child);
+	memcpy(child->FileNameBuffer, FileNameBuffer, sizeof(FileNameBuffer));
+	// pointers into our own buffer must point into the child's copy
+	if (StartupPRG >= FileNameBuffer && StartupPRG < FileNameBuffer + sizeof(FileNameBuffer))
+		child->StartupPRG = child->FileNameBuffer + (StartupPRG - FileNameBuffer);
+	else
+		child->StartupPRG = StartupPRG;
+	if (FileName >= FileNameBuffer && FileName < FileNameBuffer + sizeof(FileNameBuffer))
+		child->FileName = child->FileNameBuffer + (FileName - FileNameBuffer);
+	else
+		child->FileName = FileName;
+	child->disk = disk;
+	child->console = console;
+	child->FileNum = FileNum;
+	child->FileDev = FileDev;
+	child->FileSec = FileSec;
+	child->FileVerify = FileVerify;
+	child->FileAddr = FileAddr;
+	child->LOAD_TRAP = LOAD_TRAP;
+	child->chrget = chrget;
+	child->fast_paths = fast_paths;
+	child->verify_fast_paths = verify_fast_paths;
+	memcpy(child->boot_key, boot_key, sizeof(boot_key)); // so Reset() can restore snapshot
 }
 
 bool EmuCBM::ExecutePatch()
 {
     if (PC == 0xFFD2) // CHROUT
     {
-        CBM_Console_WriteChar((char)A, false);
+        ConsoleWriteChar(A, false);
 		// fall through to regular routine to draw character in screen memory too
     }
     else if (PC == 0xFFCF) // CHRIN
     {
-        SetA(CBM_Console_ReadChar());
+        if (console->EndOfInput())
+        {
+            quit = true;
+            return true;
+        }
+        SetA(console->ReadChar());
         C = false;
 
         return ExecuteRTS();
@@ -61,9 +163,14 @@ bool EmuCBM::ExecutePatch()
         //25 IF K$= "Q" THEN END
         //30 GOTO 10
 
+        if (console->EndOfInput())
+        {
+            quit = true;
+            return true;
+        }
         C = false;
         //SetA(CBM_Console_GetIn());
-        SetA(CBM_Console_ReadChar());
+        SetA(console->ReadChar());
         if (A != 0)
             X = A; // observed this side effect from tracing code, so replicating
 
@@ -84,13 +191,12 @@ bool EmuCBM::ExecutePatch()
     }
     else if (PC == 0xFFBD) // SETNAM
     {
-        static char name[256];
         ushort addr = (ushort)(X + (Y << 8));
         for (int i = 0; i < A; ++i)
-            name[i] = (char)GetMemory((ushort)(addr + i));
-        name[A] = 0;
+            FileNameBuffer[i] = (char)GetMemory((ushort)(addr + i));
+        FileNameBuffer[A] = 0;
         //System.Diagnostics.Debug.WriteLine(string.Format("SETNAM {0}", name.ToString()));
-        FileName = name;
+        FileName = FileNameBuffer;
     }
     else if (PC == 0xFFD5) // LOAD
     {
@@ -109,6 +215,7 @@ bool EmuCBM::ExecutePatch()
         if (A == 0 || A == 1)
         {
             LOAD_TRAP = PC;
+            SetTrap(PC);
 
             // Set success
             C = false;
@@ -148,9 +255,523 @@ bool EmuCBM::ExecuteJSR(ushort addr)
     Push(HI(retaddr));
     Push(LO(retaddr));
     PC = addr;
+    if (call_graph != 0)
+        call_graph->Call(addr, S, cycles);
     return true; // return value for ExecutePatch so will reloop execution to allow berakpoint/trace/ExecutePatch/etc.
 }
 
+struct RoutineReturn
+{
+    byte s; // stack pointer with return address pushed
+    unsigned long long limit; // instructions, in case it never returns
+};
+
+bool EmuCBM::RoutineReturned(Emu6502* emu, void* context)
+{
+    RoutineReturn* routine = (RoutineReturn*)context;
+    return ((EmuCBM*)emu)->S == (byte)(routine->s + 2) || ((EmuCBM*)emu)->instructions >= routine->limit;
+}
+
+EmuCBM* EmuCBM::EmulateRoutine()
+{
+    ShowMemoryPages(); // Fork() remaps this machine's pages too
+    EmuCBM* child = (EmuCBM*)Fork();
+    HideMemoryPages();
+    if (child == 0)
+        return 0;
+    child->fast_paths = 0;
+    child->verify_fast_paths = false;
+    child->ClearDebugPoints(); // runs to the end of the routine
+    RoutineReturn routine = { S, instructions + 100000000 };
+    child->RunUntil(RoutineReturned, &routine);
+    return child;
+}
+
+struct LoopExit
+{
+    byte s;
+    ushort start;
+    ushort end; // exclusive
+    unsigned long long limit;
+};
+
+bool EmuCBM::LoopExited(Emu6502* emu, void* context)
+{
+    LoopExit* loop = (LoopExit*)context;
+    EmuCBM* cbm = (EmuCBM*)emu;
+    return (cbm->S == loop->s && (cbm->PC < loop->start || cbm->PC >= loop->end)) || cbm->instructions >= loop->limit;
+}
+
+EmuCBM* EmuCBM::EmulateLoop(ushort start, ushort end)
+{
+    ShowMemoryPages(); // Fork() remaps this machine's pages too
+    EmuCBM* child = (EmuCBM*)Fork();
+    HideMemoryPages();
+    if (child == 0)
+        return 0;
+    child->fast_paths = 0;
+    child->verify_fast_paths = false;
+    child->ClearDebugPoints(); // runs to the end of the routine
+    LoopExit loop = { S, start, end, instructions + 100000000 };
+    child->RunUntil(LoopExited, &loop);
+    return child;
+}
+
+// fast path result compared with the fork's emulated one, registers and memory start..end
+void EmuCBM::VerifyFastPath(EmuCBM* routine, const char* name, ushort start, ushort end)
+{
+    MemoryRange range = { start, end };
+    VerifyFastPath(routine, name, &range, 1);
+}
+
+void EmuCBM::VerifyFastPath(EmuCBM* routine, const char* name, const MemoryRange* ranges, int count)
+{
+    if (routine == 0)
+        return;
+    bool same = (A == routine->A && X == routine->X && Y == routine->Y && S == routine->S && PC == routine->PC && GetP() == routine->GetP());
+    for (int i = 0; same && i < count; ++i)
+        for (int addr = ranges[i].start; same && addr <= ranges[i].end; ++addr)
+            same = (PeekMemory((ushort)addr) == routine->GetMemory((ushort)addr));
+    if (!same)
+    {
+        fprintf(stderr, "fast path %s differs, returning to $%04X\n", name, routine->PC);
+        fprintf(stderr, "  fast A=%02X X=%02X Y=%02X S=%02X P=%02X PC=%04X\n", A, X, Y, S, GetP(), PC);
+        fprintf(stderr, "  ROM  A=%02X X=%02X Y=%02X S=%02X P=%02X PC=%04X\n", routine->A, routine->X, routine->Y, routine->S, routine->GetP(), routine->PC);
+        for (int i = 0; i < count; ++i)
+        {
+            for (int addr = ranges[i].start; addr <= ranges[i].end; ++addr)
+            {
+                byte value = routine->GetMemory((ushort)addr);
+                if (PeekMemory((ushort)addr) != value)
+                {
+                    fprintf(stderr, "  $%04X fast %02X ROM %02X\n", addr, PeekMemory((ushort)addr), value);
+                    SetMemory((ushort)addr, value);
+                }
+            }
+        }
+        A = routine->A;
+        X = routine->X;
+        Y = routine->Y;
+        S = routine->S;
+        SetP(routine->GetP());
+        PC = routine->PC;
+    }
+    cycles = routine->cycles;
+    instructions = routine->instructions;
+    delete routine;
+}
+
+void EmuCBM::SetChrget(ushort addr)
+{
+    chrget = addr;
+    if ((fast_paths & FastChrget) != 0)
+    {
+        SetTrap(addr); // CHRGET
+        SetTrap((ushort)(addr + 6)); // CHRGOT
+    }
+}
+
+// CHRGET as BASIC copied it: INC TXTPTR, BNE, INC TXTPTR+1, then CHRGOT reads the character,
+// either LDA $xxxx with TXTPTR its own operand (C64, VIC-20, PET) or with RAM banked in,
+// STA bank, LDY #0, LDA (TXTPTR),Y, STA bank (TED, C128), then the same compares to the RTS
+int EmuCBM::MatchChrget(byte* code)
+{
+    for (int i = 0; i < chrget_size; ++i)
+        code[i] = PeekMemory((ushort)(chrget + i));
+    byte txtptr = code[1];
+    if (code[0] != 0xE6 || code[2] != 0xD0 || code[3] != 0x02 || code[4] != 0xE6 || code[5] != (byte)(txtptr + 1))
+        return 0;
+    int tail;
+    if (code[6] == 0xAD && chrget + 7 == txtptr)
+        tail = 9;
+    else if (code[6] == 0x8D && code[9] == 0xA0 && code[10] == 0x00 && code[11] == 0xB1 && code[12] == txtptr && code[13] == 0x8D)
+        tail = 16;
+    else
+        return 0;
+    static const byte compares[] = { 0xC9, 0x3A, 0xB0, 0x0A, 0xC9, 0x20, 0xF0, 0x00, 0x38, 0xE9, 0x30, 0x38, 0xE9, 0xD0, 0x60 };
+    for (int i = 0; i < (int)sizeof(compares); ++i)
+    {
+        byte expected = (i == 7) ? (byte)-(tail + 8) : compares[i]; // BEQ back to CHRGET
+        if (code[tail + i] != expected)
+            return 0;
+    }
+    return tail + (int)sizeof(compares);
+}
+
+bool EmuCBM::SameChrget(const byte* code, int length)
+{
+    for (int i = 0; i < length; ++i)
+        if (PeekMemory((ushort)(chrget + i)) != code[i])
+            return false;
+    return true;
+}
+
+// CHRGET/CHRGOT run natively: advance TXTPTR, skip spaces, A is the character,
+// C clear only for digits, N Z V as the compares and subtracts leave them
+bool EmuCBM::ExecuteFastChrget()
+{
+    if ((fast_paths & FastChrget) == 0 || (PC != chrget && PC != chrget + 6) || D)
+        return false; // decimal mode SBC is left to the routine
+    byte code[chrget_size];
+    int length = MatchChrget(code);
+    if (length == 0)
+        return false; // patched, e.g. by a wedge
+    EmuCBM* rom = verify_fast_paths ? EmulateRoutine() : 0;
+    const char* name = (PC == chrget) ? "CHRGET" : "CHRGOT";
+    byte txtptr = code[1];
+    bool banked = (code[6] == 0x8D);
+    bool next = (PC == chrget);
+    do
+    {
+        if (next)
+        {
+            NZ = (byte)(GetMemory(txtptr) + 1);
+            SetMemory(txtptr, (byte)NZ);
+            if (NZ == 0)
+            {
+                NZ = (byte)(GetMemory((ushort)(txtptr + 1)) + 1);
+                SetMemory((ushort)(txtptr + 1), (byte)NZ);
+            }
+        }
+        next = true;
+        if (banked)
+        {
+            SetMemory((ushort)(code[7] | (code[8] << 8)), A);
+            if (!SameChrget(code, length))
+            {
+                PC = (ushort)(chrget + 9); // banking changed the routine, emulate the rest
+                delete rom;
+                return true;
+            }
+            Y = 0;
+            A = GetMemory((ushort)(GetMemory(txtptr) | (GetMemory((ushort)(txtptr + 1)) << 8)));
+            NZ = A;
+            SetMemory((ushort)(code[14] | (code[15] << 8)), A);
+            if (!SameChrget(code, length))
+            {
+                PC = (ushort)(chrget + 16);
+                delete rom;
+                return true;
+            }
+        }
+        else
+            A = GetMemory((ushort)(GetMemory(txtptr) | (GetMemory((ushort)(txtptr + 1)) << 8)));
+    } while (A == ' ');
+    if (A >= ':')
+    {
+        NZ = (byte)(A - ':');
+        C = true;
+    }
+    else
+    {
+        byte digit = (byte)(A - '0'); // SEC, SBC #'0', SEC, SBC #$D0 leaves A
+        C = (digit >= 0xD0);
+        V = (((digit ^ 0xD0) & (digit ^ A) & 0x80) != 0);
+        NZ = A;
+    }
+    ExecuteRTS();
+    VerifyFastPath(rom, name, txtptr, (ushort)(txtptr + 1));
+    return true;
+}
+
+void EmuCBM::TrapKernalLoops(ushort start, int end)
+{
+    if ((fast_paths & FastKernal) == 0)
+        return;
+    byte code[kernal_loop_size];
+    int length;
+    for (int addr = start; addr < end; ++addr)
+        if (MatchKernalLoop((ushort)addr, code, &length) != NoLoop)
+            SetTrap((ushort)addr);
+}
+
+// Loops the KERNALs spend boot and scrolling in, each recognized by its code wherever it is:
+//   RAM test (RAMTAS): INC ptr+1, then for each byte LDA (ptr),Y, TAX, LDA #$55, STA (ptr),Y,
+//     CMP (ptr),Y, BNE size, ROL A or ROR A, STA (ptr),Y, CMP (ptr),Y, BNE size, TXA, STA (ptr),Y,
+//     INY, BNE, then BEQ back to the INC
+//   fill (RAMTAS clearing pages): up to 4 of STA zp,X / abs,X / abs,Y, INX or INY, BNE
+//   line copy (screen editor scroll): LDA (a),Y, STA (b),Y, LDA (c),Y, STA (d),Y, DEY, BPL
+//   line clear: LDA #value, STA (q),Y, DEY, BPL, or led by a JSR to LDA abs, STA (r),Y, RTS
+//     to also set the line's colors
+EmuCBM::KernalLoop EmuCBM::MatchKernalLoop(ushort addr, byte* code, int* length)
+{
+    for (int i = 0; i < kernal_loop_size; ++i)
+        code[i] = PeekMemory((ushort)(addr + i));
+    byte ptr = code[3];
+    if (code[0] == 0xE6 && code[1] == (byte)(ptr + 1) && code[2] == 0xB1 && code[4] == 0xAA
+        && code[5] == 0xA9 && code[6] == 0x55 && code[7] == 0x91 && code[8] == ptr && code[9] == 0xD1 && code[10] == ptr
+        && code[11] == 0xD0 && code[12] < 0x80 && 13 + code[12] >= kernal_loop_size // out of the loop
+        && (code[13] == 0x2A || code[13] == 0x6A) && code[14] == 0x91 && code[15] == ptr && code[16] == 0xD1 && code[17] == ptr
+        && code[18] == 0xD0 && code[19] == (byte)(code[12] - 7) // same place
+        && code[20] == 0x8A && code[21] == 0x91 && code[22] == ptr && code[23] == 0xC8
+        && code[24] == 0xD0 && code[25] == 0xE8 && code[26] == 0xF0 && code[27] == 0xE4)
+    {
+        *length = 28;
+        return RamTestLoop;
+    }
+    if (code[0] == 0x95 || code[0] == 0x99 || code[0] == 0x9D)
+    {
+        byte index = (code[0] == 0x99) ? 0xC8 : 0xE8; // INY or INX
+        int i = 0;
+        for (int stores = 0; stores < 4 && (code[i] == 0x95 || code[i] == 0x99 || code[i] == 0x9D); ++stores)
+        {
+            if ((code[i] == 0x99) != (index == 0xC8))
+                return NoLoop;
+            i += (code[i] == 0x95) ? 2 : 3;
+        }
+        if (code[i] == index && code[i + 1] == 0xD0 && code[i + 2] == (byte)-(i + 3))
+        {
+            *length = i + 3;
+            return FillLoop;
+        }
+        return NoLoop;
+    }
+    if (code[0] == 0xB1 && code[2] == 0x91 && code[4] == 0xB1 && code[6] == 0x91 && code[8] == 0x88 && code[9] == 0x10 && code[10] == 0xF5)
+    {
+        *length = 11;
+        return LineCopyLoop;
+    }
+    if (code[0] == 0xA9 && code[2] == 0x91 && code[4] == 0x88 && code[5] == 0x10 && code[6] == 0xF9)
+    {
+        *length = 7;
+        return LineClearLoop;
+    }
+    if (code[0] == 0x20 && code[3] == 0xA9 && code[5] == 0x91 && code[7] == 0x88 && code[8] == 0x10 && code[9] == 0xF6)
+    {
+        ushort color = (ushort)(code[1] | (code[2] << 8));
+        if (PeekMemory(color) == 0xAD && PeekMemory((ushort)(color + 3)) == 0x91 && PeekMemory((ushort)(color + 5)) == 0x60)
+        {
+            *length = 10;
+            return LineClearLoop;
+        }
+    }
+    return NoLoop;
+}
+
+// RAM test from the INC: each byte is kept, must read back $55 and then that rotated, and is
+// restored, until one does not, leaving the flags of that compare.  Whole pages of plain RAM
+// pass untouched in bulk.  After 256 pages without an end, false and the rest is left to the ROM at the INC.
+bool EmuCBM::FastRamTest(const byte* code)
+{
+    byte ptr = code[3];
+    byte rotated = (code[13] == 0x2A) ? 0xAB : 0xAA; // ROL or ROR of $55 with carry set by the compare
+    byte value = 0; // byte tested last, in X
+    for (int pages = 0; pages < 256; ++pages)
+    {
+        SetMemory(code[1], (byte)(GetMemory(code[1]) + 1)); // INC ptr+1
+        do
+        {
+            ushort addr = PointerY(ptr);
+            byte** read_pages = memory->read_pages;
+            if (Y == 0 && (addr & 0xFF) == 0 && IsRam(addr, 0x100)
+                && read_pages[addr >> 8] != read_pages[0] && read_pages[addr >> 8] != read_pages[(ptr + 1) >> 8]) // not a mirror of the pointer's page, 0, or 1 when ptr is $FF
+            {
+                value = GetMemory((ushort)(addr + 0xFF));
+                break; // whole page passes
+            }
+            value = GetMemory(addr);
+            byte pattern = 0x55;
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                SetMemory(PointerY(ptr), pattern);
+                byte read = GetMemory(PointerY(ptr));
+                if (read != pattern)
+                {
+                    A = pattern;
+                    X = value;
+                    C = (pattern >= read);
+                    NZ = (byte)(pattern - read);
+                    PC = (ushort)(PC + 13 + code[12]);
+                    return true;
+                }
+                pattern = rotated;
+            }
+            SetMemory(PointerY(ptr), value);
+        } while (++Y != 0);
+    }
+    A = X = value;
+    NZ = 0; // INY
+    C = true;
+    return false;
+}
+
+// fill stores A at each store's address plus the index, until the index wraps to 0
+void EmuCBM::FastFill(const byte* code)
+{
+    bool y = (code[0] == 0x99);
+    byte index = y ? Y : X;
+    int i;
+    do
+    {
+        for (i = 0; code[i] == 0x95 || code[i] == 0x99 || code[i] == 0x9D; i += (code[i] == 0x95) ? 2 : 3)
+        {
+            if (code[i] == 0x95)
+                SetMemory((byte)(code[i + 1] + index), A);
+            else
+                SetMemory((ushort)((code[i + 1] | (code[i + 2] << 8)) + index), A);
+        }
+    } while (++index != 0);
+    if (y)
+        Y = 0;
+    else
+        X = 0;
+    NZ = 0;
+    PC = (ushort)(PC + i + 3);
+}
+
+// line copy moves bytes Y down to 0 of both lines, with memmove where the four don't overlap
+void EmuCBM::FastLineCopy(const byte* code)
+{
+    unsigned count = Y + 1;
+    ushort from1 = PointerY(code[1]) - Y;
+    ushort to1 = PointerY(code[3]) - Y;
+    ushort from2 = PointerY(code[5]) - Y;
+    ushort to2 = PointerY(code[7]) - Y;
+    bool apart = (Y <= 0x80);
+    ushort lines[4] = { from1, to1, from2, to2 };
+    for (int i = 0; apart && i < 4; ++i)
+        apart = (lines[i] + count <= 0x10000); // no wrap
+    // neither line written is read or written by the other move, nor holds the pointers
+    apart = apart && !Overlap(to1, count, from2, count) && !Overlap(to1, count, to2, count) && !Overlap(to2, count, from1, count)
+        && !Overlap(to1, count, 0x0000, 0x101) && !Overlap(to2, count, 0x0000, 0x101);
+    if (apart)
+    {
+        MoveMemoryDown(to1, from1, count);
+        A = MoveMemoryDown(to2, from2, count);
+        Y = 0xFF;
+    }
+    else
+    {
+        do
+        {
+            A = GetMemory(PointerY(code[1]));
+            SetMemory(PointerY(code[3]), A);
+            A = GetMemory(PointerY(code[5]));
+            SetMemory(PointerY(code[7]), A);
+        } while ((--Y & 0x80) == 0);
+    }
+    NZ = Y;
+    PC = (ushort)(PC + 11);
+}
+
+// line clear stores the value Y down to 0, and with the JSR the color read by the subroutine,
+// false if left to the ROM part way
+bool EmuCBM::FastLineClear(const byte* code)
+{
+    bool color = (code[0] == 0x20);
+    const byte* clear = color ? &code[3] : code;
+    ushort routine = (ushort)(code[1] | (code[2] << 8));
+    ushort color_addr = 0; // LDA abs
+    byte color_ptr = 0; // STA (r),Y
+    if (color)
+    {
+        color_addr = (ushort)(PeekMemory((ushort)(routine + 1)) | (PeekMemory((ushort)(routine + 2)) << 8));
+        color_ptr = PeekMemory((ushort)(routine + 4));
+    }
+    ushort return_addr = (ushort)(PC + 2);
+    do
+    {
+        if (color)
+        {
+            SetMemory((ushort)(0x100 + S), (byte)(return_addr >> 8));
+            SetMemory((ushort)(0x100 + (byte)(S - 1)), (byte)return_addr);
+            A = GetMemory(color_addr);
+            SetMemory(PointerY(color_ptr), A);
+            if (GetMemory((ushort)(0x100 + S)) != (byte)(return_addr >> 8) || GetMemory((ushort)(0x100 + (byte)(S - 1))) != (byte)return_addr)
+            {
+                NZ = A;
+                S -= 2;
+                PC = (ushort)(routine + 5); // color overwrote the return address, its RTS is left to the ROM
+                return false;
+            }
+        }
+        A = clear[1];
+        SetMemory(PointerY(clear[3]), A);
+    } while ((--Y & 0x80) == 0);
+    NZ = Y;
+    PC = (ushort)(PC + (color ? 10 : 7));
+    return true;
+}
+
+// KERNAL loops run natively, memory, registers and flags end as the loop leaves them
+bool EmuCBM::ExecuteFastKernal()
+{
+    if ((fast_paths & FastKernal) == 0)
+        return false;
+    byte code[kernal_loop_size];
+    int length;
+    KernalLoop loop = MatchKernalLoop(PC, code, &length);
+    if (loop == NoLoop)
+        return false;
+    EmuCBM* rom = verify_fast_paths ? EmulateLoop(PC, (ushort)(PC + length)) : 0;
+    MemoryRange ranges[4]; // compared by verify
+    int range_count = 0;
+    const char* name;
+    if (loop == RamTestLoop)
+    {
+        name = "RAM test";
+        ushort start = (ushort)((GetMemory(code[3]) | ((GetMemory(code[1]) + 1) << 8)) + Y);
+        if (!FastRamTest(code))
+        {
+            delete rom;
+            return true;
+        }
+        ushort end = PointerY(code[3]);
+        ranges[range_count].start = code[3];
+        ranges[range_count++].end = (ushort)(code[3] + 1);
+        ranges[range_count].start = start;
+        ranges[range_count++].end = end;
+    }
+    else if (loop == FillLoop)
+    {
+        name = "fill";
+        for (int i = 0; code[i] == 0x95 || code[i] == 0x99 || code[i] == 0x9D; i += (code[i] == 0x95) ? 2 : 3)
+        {
+            ushort base = (code[i] == 0x95) ? 0 : (ushort)(code[i + 1] | (code[i + 2] << 8));
+            ranges[range_count].start = base;
+            ranges[range_count++].end = (base <= 0xFF00) ? (ushort)(base + 0xFF) : 0xFFFF;
+        }
+        FastFill(code);
+    }
+    else
+    {
+        // lines written, Y down to 0
+        byte lines[2];
+        int line_count = 0;
+        if (loop == LineCopyLoop)
+        {
+            lines[line_count++] = code[3];
+            lines[line_count++] = code[7];
+        }
+        else if (code[0] == 0x20)
+        {
+            lines[line_count++] = code[6];
+            lines[line_count++] = PeekMemory((ushort)((code[1] | (code[2] << 8)) + 4)); // STA (r),Y of the JSR
+            ranges[range_count].start = (ushort)(0x100 + (byte)(S - 1)); // its return address
+            ranges[range_count++].end = (ushort)(0x100 + S);
+        }
+        else
+            lines[line_count++] = code[3];
+        int count = (Y <= 0x80) ? Y + 1 : 1;
+        for (int i = 0; i < line_count; ++i)
+        {
+            ranges[range_count].start = (ushort)(PointerY(lines[i]) - (count - 1));
+            ranges[range_count].end = (ushort)(ranges[range_count].start + count - 1);
+            ++range_count;
+        }
+        name = (loop == LineCopyLoop) ? "line copy" : "line clear";
+        if (loop == LineCopyLoop)
+            FastLineCopy(code);
+        else if (!FastLineClear(code))
+        {
+            delete rom;
+            return true;
+        }
+    }
+    VerifyFastPath(rom, name, ranges, range_count);
+    return true;
+}
+
 unsigned EmuCBM::File_ReadAllBytes(byte* bytes, unsigned long size, const char* filename)
 {
 	int file;
@@ -181,19 +802,180 @@ unsigned EmuCBM::File_ReadAllBytes(byte* bytes, unsigned long size, const char*
 	return bytes_read;
 }
 
-static byte* OpenRead(const char* filename, int* p_ret_file_len)
+unsigned EmuCBM::File_ReadRom(byte* bytes, unsigned long size, const char* filename)
+{
+	std::lock_guard<std::mutex> guard(rom_cache_lock);
+	std::map<std::string, std::vector<byte> >::iterator found = rom_cache.find(filename);
+	if (found == rom_cache.end())
+	{
+		std::vector<byte> rom(size);
+		rom.resize(File_ReadAllBytes(&rom[0], size, filename));
+		found = rom_cache.insert(std::make_pair(std::string(filename), rom)).first;
+	}
+	unsigned len = (unsigned)found->second.size();
+	if (len > size)
+		len = (unsigned)size;
+	if (len > 0)
+		memcpy(bytes, &found->second[0], len);
+	return len;
+}
+
+static std::string BootSnapshotFilename(const char* key)
 {
-	static unsigned char buffer[65536]; // TODO: get actual file size
+	std::string filename = EmuCBM::BootSnapshotDir;
+	if (!filename.empty() && filename[filename.length() - 1] != '/' && filename[filename.length() - 1] != '\\')
+		filename += '/';
+	return filename + key + ".snap";
+}
+
+static bool ReadSection(FILE* fp, std::vector<byte>& section)
+{
+	unsigned len;
+	if (fread(&len, sizeof(len), 1, fp) != 1 || len > 0x1000000)
+		return false;
+	section.resize(len);
+	return len == 0 || fread(&section[0], len, 1, fp) == 1;
+}
+
+static void WriteSection(FILE* fp, const std::vector<byte>& section)
+{
+	unsigned len = (unsigned)section.size();
+	fwrite(&len, sizeof(len), 1, fp);
+	if (len > 0)
+		fwrite(&section[0], len, 1, fp);
+}
+
+static std::shared_ptr<BootSnapshot> LoadBootSnapshot(const char* key)
+{
+	std::string filename = BootSnapshotFilename(key);
+#ifdef WINDOWS
+	FILE* fp;
+	fopen_s(&fp, filename.c_str(), "rb");
+#else
+	FILE* fp = fopen(filename.c_str(), "rb");
+#endif
+	if (fp == 0)
+		return std::shared_ptr<BootSnapshot>();
+	std::shared_ptr<BootSnapshot> snapshot(new BootSnapshot());
+	char magic[sizeof(boot_snapshot_magic)];
+	bool success = fread(magic, sizeof(magic), 1, fp) == 1
+		&& memcmp(magic, boot_snapshot_magic, sizeof(magic)) == 0
+		&& ReadSection(fp, snapshot->output)
+		&& ReadSection(fp, snapshot->state);
+	fclose(fp);
+	if (!success)
+		return std::shared_ptr<BootSnapshot>();
+	return snapshot;
+}
+
+static void SaveBootSnapshot(const char* key, const BootSnapshot& snapshot)
+{
+	std::string filename = BootSnapshotFilename(key);
+#ifdef WINDOWS
+	FILE* fp;
+	fopen_s(&fp, filename.c_str(), "wb");
+#else
+	FILE* fp = fopen(filename.c_str(), "wb");
+#endif
+	if (fp == 0)
+		return;
+	fwrite(boot_snapshot_magic, sizeof(boot_snapshot_magic), 1, fp);
+	WriteSection(fp, snapshot.output);
+	WriteSection(fp, snapshot.state);
+	fclose(fp);
+}
+
+static std::shared_ptr<BootSnapshot> FindBootSnapshot(const char* key)
+{
+	std::lock_guard<std::mutex> guard(boot_snapshots_lock);
+	std::shared_ptr<BootSnapshot>& snapshot = boot_snapshots[key];
+	if (!snapshot && EmuCBM::BootSnapshotDir != 0)
+		snapshot = LoadBootSnapshot(key);
+	return snapshot;
+}
+
+void EmuCBM::SetBootKey(const char* machine, int config)
+{
+	snprintf(boot_key, sizeof(boot_key), "%s-%d", machine, config);
+}
 
+void EmuCBM::Reset()
+{
+	boot_recording = false;
+	boot_output.clear();
+	if (BootSnapshots && boot_key[0] != 0)
+	{
+		std::shared_ptr<BootSnapshot> snapshot = FindBootSnapshot(boot_key);
+		if (snapshot && !snapshot->state.empty() && RestoreState(&snapshot->state[0], snapshot->state.size()))
+		{
+			for (size_t i = 0; i + 1 < snapshot->output.size(); i += 2)
+				console->WriteChar(snapshot->output[i], snapshot->output[i + 1] != 0);
+			return;
+		}
+		if (snapshot) // doesn't fit this machine, replace with one from this boot
+		{
+			std::lock_guard<std::mutex> guard(boot_snapshots_lock);
+			boot_snapshots.erase(boot_key);
+		}
+		boot_recording = true;
+	}
+	Emu6502::Reset();
+}
+
+// program ended or direct mode, also first READY after boot
+void EmuCBM::ReadyReached()
+{
+	if (basic_profiler != 0)
+		basic_profiler->ProgramEnded();
+	CheckBootSnapshot();
+}
+
+void EmuCBM::CheckBootSnapshot()
+{
+	if (!boot_recording)
+		return;
+	boot_recording = false;
+
+	std::shared_ptr<BootSnapshot> snapshot(new BootSnapshot());
+	if (!SaveState(snapshot->state))
+		return;
+	snapshot->output.swap(boot_output);
+
+	std::lock_guard<std::mutex> guard(boot_snapshots_lock);
+	std::shared_ptr<BootSnapshot>& cached = boot_snapshots[boot_key];
+	if (!cached) // first to boot wins
+	{
+		cached = snapshot;
+		if (BootSnapshotDir != 0)
+			SaveBootSnapshot(boot_key, *snapshot);
+	}
+}
+
+void EmuCBM::ConsoleWriteChar(byte c, bool supress_next_home)
+{
+	if (boot_recording)
+	{
+		boot_output.push_back(c);
+		boot_output.push_back(supress_next_home ? 1 : 0);
+	}
+	console->WriteChar(c, supress_next_home);
+}
+
+byte* EmuCBM::OpenRead(const char* filename, int* p_ret_file_len)
+{
 	if (disk == 0)
 	{
 		return (byte*)NULL;
 		*p_ret_file_len = 0;
 	}
 
+	if (file_buffer == 0)
+		file_buffer = new byte[file_buffer_size];
+	byte* buffer = file_buffer;
+
 	if (filename != NULL && filename[0] == '$' && filename[1] == '\0')
 	{
-		*p_ret_file_len = sizeof(buffer);
+		*p_ret_file_len = file_buffer_size;
 		if (D64_GetDirectoryProgram(disk, buffer, p_ret_file_len))
 			return &buffer[0];
 		else
@@ -204,7 +986,7 @@ static byte* OpenRead(const char* filename, int* p_ret_file_len)
 	}
 	else
 	{
-		*p_ret_file_len = sizeof(buffer);
+		*p_ret_file_len = file_buffer_size;
 		D64_ReadFileByName(disk, (unsigned char*)filename, buffer, p_ret_file_len);
 		return buffer;
 	}
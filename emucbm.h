@@ -1,25 +1,69 @@
 #pragma once
 
 #include "emu6502.h"
+#include "cbmconsole.h"
 
 class EmuCBM : public Emu6502
 {
 public:
-	EmuCBM(Memory* mem);
+	EmuCBM(Memory* mem, unsigned fast_paths); // FastPath bits, subclass constructors trap them
 	virtual ~EmuCBM();
+	static EmuCBM* Create(int go_num); // machine a GO number selects: 128, 4, 16, 20, 2001, otherwise C64, with DefaultFastPaths
+	static EmuCBM* Create(int go_num, unsigned fast_paths);
 	bool LoadPRG(const char* filename);
 
 public:
-	static const char* StartupPRG;
+	// per machine, host sets before running, and carries forward to next machine after GO
+	const char* StartupPRG; // cleared once loaded
+	void* disk; // D64, created on first startup load, not owned
+	CBMConsole* console; // defaults to CBMConsole::Standard(), not owned
+
 	static unsigned File_ReadAllBytes(byte* bytes, unsigned long size, const char* filename);
+	static unsigned File_ReadRom(byte* bytes, unsigned long size, const char* filename); // cached, read once per process
+
+	// Boot snapshots: state is captured the first time each machine configuration reaches READY,
+	// then Reset() restores it instead of booting.  Set before creating machines.
+	static bool BootSnapshots; // enables in-memory snapshots
+	static const char* BootSnapshotDir; // also save/load snapshot files here, 0 for memory only
+
+	// Fast paths: ROM routines run as native code instead of emulated, the result is the same
+	// but their instructions and cycles are not counted.  Machines start with those passed to their constructors, DefaultFastPaths if none.
+	enum FastPath
+	{
+		FastFloat = 1, // C64 BASIC floating point arithmetic, see BasicFloat, trapped only if set when the machine is created
+		FastChrget = 2, // BASIC text scanner CHRGET/CHRGOT in RAM, trapped only if set when the machine is created
+		FastStrings = 4, // C64 BASIC string garbage collection and block moves, see BasicMemory, trapped only if set when the machine is created
+		FastKernal = 8, // KERNAL RAM test and clear, screen line moves and clears (C64, VIC-20, TED), trapped only if set when the machine is created
+	};
+	unsigned fast_paths; // FastPath bits
+	bool verify_fast_paths; // also emulate each in a fork, report differences to stderr, keep the emulated result and counts
+	static unsigned DefaultFastPaths;
+	static bool DefaultVerifyFastPaths;
+
+	virtual void Reset();
+	virtual int GetBasicLineAddress() { return -1; } // zero page CURLIN, for BasicProfiler, -1 if unknown
 
 protected:
 	bool ExecutePatch();
+	void ForkState(EmuCBM* child); // child shares disk and console, host may replace them
+	void SetBootKey(const char* machine, int config);
+	void ReadyReached(); // call at READY trap
+	void ConsoleWriteChar(byte c, bool supress_next_home = false); // recorded while booting, replayed on restore
 	bool ExecuteRTS();
 	bool ExecuteJSR(ushort addr);
+	EmuCBM* EmulateRoutine(); // for verify_fast_paths: fork that ran the routine at PC until it returned, 0 if no Fork()
+	EmuCBM* EmulateLoop(ushort start, ushort end); // same for the loop at PC, until it left start..end-1 at the same S
+	struct MemoryRange { ushort start; ushort end; }; // inclusive
+	void VerifyFastPath(EmuCBM* routine, const char* name, ushort start, ushort end); // after fast path, compares and deletes fork
+	void VerifyFastPath(EmuCBM* routine, const char* name, const MemoryRange* ranges, int count);
+	void SetChrget(ushort addr); // where BASIC copies CHRGET, traps it and CHRGOT for FastChrget
+	bool ExecuteFastChrget(); // at CHRGET or CHRGOT, false if elsewhere or the routine was patched, e.g. by a wedge
+	void TrapKernalLoops(ushort start, int end); // SetTrap() at each loop ExecuteFastKernal() runs in ROM as banked in now, if FastKernal
+	bool ExecuteFastKernal(); // at such a loop, false if elsewhere or the code there differs, e.g. banked out
 	bool FileLoad(byte* p_err);
 	bool FileSave(const char* filename, ushort addr1, ushort addr2);
 	bool LoadStartupPrg();
+	byte* OpenRead(const char* filename, int* p_ret_file_len);
 
 	int LOAD_TRAP;
 
@@ -29,6 +73,32 @@ protected:
 	byte FileSec;
 	bool FileVerify;
 	ushort FileAddr;
+	char FileNameBuffer[256]; // SETNAM, etc.
+
+private:
+	void CheckBootSnapshot();
+	static bool RoutineReturned(Emu6502* emu, void* context);
+	static bool LoopExited(Emu6502* emu, void* context);
+	int MatchChrget(byte* code); // reads routine at chrget into code, its length if unpatched, else 0
+	bool SameChrget(const byte* code, int length); // routine still reads the same, e.g. after banking
+	enum KernalLoop { NoLoop, RamTestLoop, FillLoop, LineCopyLoop, LineClearLoop };
+	KernalLoop MatchKernalLoop(ushort addr, byte* code, int* length); // reads code at addr, kind of loop there and its length
+	bool FastRamTest(const byte* code); // false if left to the ROM part way
+	void FastFill(const byte* code);
+	void FastLineCopy(const byte* code);
+	bool FastLineClear(const byte* code); // same
+	ushort PointerY(byte zp) { return (ushort)((GetMemory(zp) | (GetMemory((ushort)(zp + 1)) << 8)) + Y); } // (zp),Y as the CPU addresses it
+
+	int chrget; // address, -1 if none
+	static const int chrget_size = 31; // longest form, TED and C128
+	static const int kernal_loop_size = 28; // longest, RAM test
+
+	static const int file_buffer_size = 65536; // TODO: get actual file size
+	byte* file_buffer; // allocated on first OpenRead()
+
+	char boot_key[32]; // machine and configuration, empty if snapshots not supported
+	bool boot_recording; // booting without snapshot, capture one at READY
+	std::vector<byte> boot_output; // character, supress_next_home pairs written while booting
 
 private: // disabled
 	EmuCBM(const EmuCBM& other); // disabled
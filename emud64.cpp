@@ -218,7 +218,7 @@ void EmuD64::DirStruct::ReadData(EmuD64* d64, unsigned char* data, int offset)
     }
 }
 
-static struct DirEntryLocation {
+struct DirEntryLocation {
     unsigned char filename[EmuD64::DirStruct::dir_name_size];
     bool found_name;
 
@@ -235,71 +235,74 @@ static struct DirEntryLocation {
     int empty_entry;
     int empty_next_track;
     int empty_next_sector;
-} dir_entry_location;
+};
 
 // gather various track/sector/entry location to help us store a new directory entry, or overwrite an existing directory entry
 static bool DirectoryEntryLocator(EmuD64* d64, EmuD64::DirStruct* dir, int n, bool last, void*& context)
 {
-    dir_entry_location.entry = n % EmuD64::dir_entries_per_sector; // track which entry in sector
+    DirEntryLocation* location = (DirEntryLocation*)context;
+
+    location->entry = n % EmuD64::dir_entries_per_sector; // track which entry in sector
 
-    if (dir_entry_location.entry == 0) // next entries are only valid every 8 records
+    if (location->entry == 0) // next entries are only valid every 8 records
     {
         if (n == 0)
         {
             // if first, we know exactly where we are
-            dir_entry_location.track = EmuD64::dir_track;
-            dir_entry_location.sector = EmuD64::dir_sector;
+            location->track = EmuD64::dir_track;
+            location->sector = EmuD64::dir_sector;
 
             // make sure empty is cleared
-            dir_entry_location.empty_track = 0;
-            dir_entry_location.empty_sector = 0;
-            dir_entry_location.empty_entry = 0;
-            dir_entry_location.empty_next_track = 0;
-            dir_entry_location.empty_next_sector = 0;
+            location->empty_track = 0;
+            location->empty_sector = 0;
+            location->empty_entry = 0;
+            location->empty_next_track = 0;
+            location->empty_next_sector = 0;
         }
         else
         {
             // we know where we are by next values from where we've been
-            dir_entry_location.track = dir_entry_location.next_track;
-            dir_entry_location.sector = dir_entry_location.next_sector;
+            location->track = location->next_track;
+            location->sector = location->next_sector;
         }
         // remember where we're going
-        dir_entry_location.next_track = dir->next_track;
-        dir_entry_location.next_sector = dir->next_sector;
+        location->next_track = dir->next_track;
+        location->next_sector = dir->next_sector;
     }
 
     if ((dir->file_type & 7) == EmuD64::DirStruct::FileType::DEL
-        && dir_entry_location.empty_track == 0)
+        && location->empty_track == 0)
     {
-        dir_entry_location.empty_track = dir_entry_location.track;
-        dir_entry_location.empty_sector = dir_entry_location.sector;
-        dir_entry_location.empty_entry = dir_entry_location.entry;
-        dir_entry_location.empty_next_track = dir_entry_location.next_track;
-        dir_entry_location.empty_next_sector = dir_entry_location.next_sector;
+        location->empty_track = location->track;
+        location->empty_sector = location->sector;
+        location->empty_entry = location->entry;
+        location->empty_next_track = location->next_track;
+        location->empty_next_sector = location->next_sector;
     }
     else if ((dir->file_type & 7) == EmuD64::DirStruct::FileType::PRG
-        && memcmp(dir->filename, dir_entry_location.filename, EmuD64::DirStruct::dir_name_size) == 0)
+        && memcmp(dir->filename, location->filename, EmuD64::DirStruct::dir_name_size) == 0)
     {
-        dir_entry_location.found_name = true;
+        location->found_name = true;
     }
     else
-        dir_entry_location.found_name = false;
+        location->found_name = false;
 
-    return !dir_entry_location.found_name; // return false when found so we stop looking
+    return !location->found_name; // return false when found so we stop looking
 }
 
-static bool FindDirectoryEntry(EmuD64* d64, EmuD64::DirStruct* dir)
+static bool FindDirectoryEntry(EmuD64* d64, EmuD64::DirStruct* dir, DirEntryLocation& dir_entry_location)
 {
     memset(&dir_entry_location, 0, sizeof(dir_entry_location));
     memcpy(&dir_entry_location.filename, dir->filename, EmuD64::DirStruct::dir_name_size);
-    void* context = 0;
-    d64->WalkDirectory(DirectoryEntryLocator, context); // TODO: consider using context instead of static dir_entry_location
+    void* context = &dir_entry_location;
+    d64->WalkDirectory(DirectoryEntryLocator, context);
     return dir_entry_location.found_name;
 }
 
 bool EmuD64::FindOrAllocDirectoryEntry(EmuD64::DirStruct* dir, int& track, int& sector, int& entry)
 {
-    if (FindDirectoryEntry(this, dir))
+    DirEntryLocation dir_entry_location;
+    if (FindDirectoryEntry(this, dir, dir_entry_location))
     {
         track = dir_entry_location.track;
         sector = dir_entry_location.sector;
@@ -656,9 +659,15 @@ void EmuD64::ReadFileByIndex(int i, unsigned char* data, int &length)
     }
 }
 
+struct ReadFileByNameContext {
+    const char* filename;
+    int found_index; // -1 if not found
+};
+
 static bool ReadFileByNameHandler(EmuD64* d64, EmuD64::DirStruct* dir, int n, bool last, void*& context)
 {
-    const char* filename = (char*)context;
+    ReadFileByNameContext* find = (ReadFileByNameContext*)context;
+    const char* filename = find->filename;
     bool isPRG = ((dir->file_type) & 7) == int(EmuD64::DirStruct::FileType::PRG);
     int filename_len = (int)strlen(filename);
     bool doFirst = (filename_len == 1 && filename[0] == '*')
@@ -671,20 +680,19 @@ static bool ReadFileByNameHandler(EmuD64* d64, EmuD64::DirStruct* dir, int n, bo
             return true; // keep searching
     }
     // full or shortcut match if got here
-    static int ret_index;
-    ret_index = n;
-    context = &ret_index;
+    find->found_index = n;
     return false; // stop searching
 }
 
 void EmuD64::ReadFileByName(unsigned char* filename, unsigned char* bytes, int& length)
 {
-    void* context = filename;
+    ReadFileByNameContext find = { (const char*)filename, -1 };
+    void* context = &find;
     WalkDirectory(ReadFileByNameHandler, context);
-    if (context == filename) // not found
+    if (find.found_index < 0) // not found
         length = 0;
     else
-        ReadFileByIndex(*(int*)context, bytes, length);
+        ReadFileByIndex(find.found_index, bytes, length);
 }
 
 void EmuD64::WriteBlock(BlockStruct block, BlockStruct next_block, unsigned char* data, int data_len, int data_offset)
@@ -1154,6 +1162,11 @@ extern "C" void* D64_CreateOrLoad(const char* filename)
     return new EmuD64(filename);
 }
 
+extern "C" void D64_Close(void* disk)
+{
+    delete (EmuD64*)disk; // flushes any changes
+}
+
 extern "C" int D64_GetDirectoryProgram(void* disk, unsigned char* buffer, int* p_ret_file_len)
 {
     return ((EmuD64*)disk)->GetDirectoryProgram(buffer, *p_ret_file_len) ? 1 : 0;
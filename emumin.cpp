@@ -40,12 +40,11 @@
 
 #include "emumin.h"
 
-extern int main_go_num;
-
 EmuMinimum::EmuMinimum(const char* filename, ushort serialaddr, bool line_editor)
 	: Emu6502(new MinimumMemory(filename, serialaddr, line_editor))
 {
 	printf("RAM=%d ROM=%d\r\n", ((MinimumMemory*)memory)->getramsize(), ((MinimumMemory*)memory)->getromsize());
+	SetAllTraps(); // go_num written to memory is checked at every instruction
 }
 
 EmuMinimum::~EmuMinimum()
@@ -54,24 +53,19 @@ EmuMinimum::~EmuMinimum()
 
 bool EmuMinimum::ExecutePatch()
 {
-	if (main_go_num != 1)
+	MinimumMemory* minmemory = (MinimumMemory*)memory;
+	if (minmemory->go_num != 1)
+	{
+		go_num = minmemory->go_num;
 		quit = true;
+	}
 	return false;
 }
 
-byte EmuMinimum::GetMemory(ushort addr)
-{
-	return memory->read(addr);
-}
-
-void EmuMinimum::SetMemory(ushort addr, byte value)
-{
-	memory->write(addr, value);
-}
-
 MinimumMemory::MinimumMemory(const char* filename, ushort serialaddr, bool line_editor)
 {
 	uart = new MC6850(line_editor);
+	go_num = 1;
 	this->ramsize = ramsize;
 	this->romsize = romsize;
 	this->serialaddr = serialaddr;
@@ -87,6 +81,12 @@ MinimumMemory::MinimumMemory(const char* filename, ushort serialaddr, bool line_
 #endif
 	ramsize = romaddr;
 	memset(ram, 0, ramsize);
+
+	// fast path everything except the serial port page(s), and writes to ROM
+	MapPages(0, 0x100, ram, 0);
+	MapPages(0, (ramsize >> 8) < 0xFF ? (ramsize >> 8) : 0xFF, ram, ram); // write to FFFF sets go_num
+	MapPages(serialaddr >> 8, 1, 0, 0);
+	MapPages((ushort)(serialaddr + 1) >> 8, 1, 0, 0);
 }
 
 MinimumMemory::~MinimumMemory()
@@ -112,7 +112,7 @@ void MinimumMemory::write(ushort addr, byte value)
 	else if (addr < ramsize)
 		ram[addr] = value;
 	else if (addr == 0xFFFF)
-		main_go_num = value;
+		go_num = value;
 }
 
 unsigned MinimumMemory::getramsize()
@@ -12,10 +12,6 @@ public:
 protected:
 	bool ExecutePatch();
 
-private:
-	byte GetMemory(ushort addr);
-	void SetMemory(ushort addr, byte value);
-
 private:
 	EmuMinimum(const EmuMinimum& other); // disabled
 	bool operator==(const EmuMinimum& other) const; // disabled
@@ -31,6 +27,8 @@ public:
 	unsigned getramsize();
 	unsigned getromsize();
 
+	int go_num; // written to $FFFF, anything but 1 quits to another machine
+
 private:
 	byte* ram;
 	ushort ramsize;
@@ -62,19 +62,31 @@
 #include "emupet.h"
 #include "cbmconsole.h"
 
-// externs/globals
-extern int main_go_num;
-
-static int startup_state = 0;
-
-EmuPET::EmuPET(int ram_size) : EmuCBM(new PETMemory(ram_size * 1024))
+EmuPET::EmuPET(int ram_size, unsigned fast_paths) : EmuCBM(new PETMemory(ram_size * 1024), fast_paths)
 {
+	SetBootKey("pet", ram_size);
+	SetTrap((ushort)(GetMemory(0xFFFC) | (GetMemory(0xFFFD) << 8))); // RESET
+	SetTrap(0xC38B); // READY
+	SetTrap(0xC6EC); // EXECUTE
+	SetTrap(0xF34E); // LOAD
+	SetChrget(0x00C2); // basic1, TXTPTR $C9/$CA
 }
 
 EmuPET::~EmuPET()
 {
 }
 
+const char* EmuPET::GetRegionName(ushort addr)
+{
+	if (addr >= 0xC000 && addr < 0xE000)
+		return "BASIC";
+	if (addr >= 0xE000 && addr < 0xE800)
+		return "EDIT";
+	if (addr >= 0xF000)
+		return "KERNAL";
+	return 0;
+}
+
 // The patches implemented below are for basic1.  WARNING: basic2 is very different including zero page memory usage (e.g. $28/$29 instead of $7A/$7B)
 //    = INDEX, temporary BASIC pointer, set before CLR
 //   $7A/7B = start of BASIC program in RAM
@@ -87,10 +99,13 @@ EmuPET::~EmuPET()
 //   execute RESET vector captured to clear screen via CHR$(147)
 bool EmuPET::ExecutePatch()
 {
+	if (ExecuteFastChrget())
+		return true;
 	if (PC == (ushort)(GetMemory(0xFFFC) | (GetMemory(0xFFFD) << 8)))
-		CBM_Console_WriteChar((char)147, true); // PET 2001 doesn't initialize screen with chr$(147), so must do it here, supressing next home
+		ConsoleWriteChar(147, true); // PET 2001 doesn't initialize screen with chr$(147), so must do it here, supressing next home
 	if (PC == 0xC38B || PC == LOAD_TRAP) // READY
 	{
+		ReadyReached();
 		//go_state = 0;
 
 		if (LOAD_TRAP != -1) // User requested program be loaded
@@ -193,7 +208,7 @@ bool EmuPET::ExecutePatch()
 				char c = (char)GetMemory(addr++);
 				if (digits > 0 && (c == 0 || c == ':')) // end of number?
 				{
-					main_go_num = num;
+					go_num = num;
 					quit = true;
 					return true;
 				}
@@ -212,13 +227,13 @@ bool EmuPET::ExecutePatch()
 		// PET is different, get arguments from low memory in fixed places
 		FileAddr = (ushort)(GetMemory(0xe5) | (GetMemory(0xe6) << 8));
 		FileVerify = (GetMemory(0x20B) == 1);
-		static char name[256];
+		char* name = FileNameBuffer;
 		int len = GetMemory(0xEE);
 		ushort fn_index = (ushort)(GetMemory(0xF9) | (GetMemory(0xFA) << 8));
 		for (int i = 0; i < len; ++i)
 			name[i] = (char)GetMemory((ushort)(fn_index + i));
 		name[len] = 0;
-		StartupPRG = &name[0];
+		StartupPRG = name;
 
 		FileSec = GetMemory(0xF0);
 		FileDev = GetMemory(0xF1);
@@ -240,7 +255,10 @@ bool EmuPET::ExecutePatch()
 		ExecuteRTS();
 
 		if (op != "???")
+		{
 			LOAD_TRAP = PC;
+			SetTrap(PC);
+		}
 
 		return true; // overriden, and PC changed, so caller should reloop before execution to allow breakpoint/trace/ExecutePatch/etc.
 	}
@@ -286,16 +304,18 @@ EmuPET::PETMemory::PETMemory(int size)
 		io[i] = 0;
 
 	basic = new byte[basic_size];
-	EmuCBM::File_ReadAllBytes(basic, basic_size, "roms/pet/basic1");
+	EmuCBM::File_ReadRom(basic, basic_size, "roms/pet/basic1");
 
 	edit = new byte[edit_size];
-	EmuCBM::File_ReadAllBytes(edit, edit_size, "roms/pet/edit1g");
+	EmuCBM::File_ReadRom(edit, edit_size, "roms/pet/edit1g");
 
 	chargen = new byte[chargen_size];
-	EmuCBM::File_ReadAllBytes(chargen, chargen_size, "roms/pet/characters2.bin");
+	EmuCBM::File_ReadRom(chargen, chargen_size, "roms/pet/characters2.bin");
 
 	kernal = new byte[kernal_size];
-	EmuCBM::File_ReadAllBytes(kernal, kernal_size, "roms/pet/kernal1");
+	EmuCBM::File_ReadRom(kernal, kernal_size, "roms/pet/kernal1");
+
+	RemapPages();
 }
 
 EmuPET::PETMemory::~PETMemory()
@@ -309,6 +329,16 @@ EmuPET::PETMemory::~PETMemory()
 	delete[] chargen;
 }
 
+bool EmuPET::PETMemory::SerializeState(StateIO& io)
+{
+	io.Bytes(ram, ram_size);
+	io.Bytes(video_ram, video_size);
+	io.Bytes(this->io, io_size);
+	if (!io.IsSaving())
+		RemapPages();
+	return true;
+}
+
 byte EmuPET::PETMemory::read(ushort addr)
 {
 	if (addr < ram_size)
@@ -347,6 +377,23 @@ void EmuPET::PETMemory::write(ushort addr, byte value)
 		io[addr - io_addr] = value;
 }
 
+// Fast path pages, fixed memory map.  I/O and unpopulated pages go through read()/write()
+void EmuPET::PETMemory::RemapPages()
+{
+	MapPages(0, ram_size >> 8, ram, ram);
+	MapPages(video_addr >> 8, video_size >> 8, video_ram, video_ram);
+	MapPages(basic_addr >> 8, basic_size >> 8, basic, 0);
+	MapPages(edit_addr >> 8, edit_size >> 8, edit, 0);
+	MapPages(kernal_addr >> 8, kernal_size >> 8, kernal, 0);
+}
+
+// BASIC, editor and KERNAL, never banked
+bool EmuPET::PETMemory::IsRomPage(byte page)
+{
+	int addr = page << 8;
+	return (addr >= basic_addr && addr < edit_addr + edit_size) || addr >= kernal_addr;
+}
+
 //    private void ApplyColor()
 //{
 //    bool reverse = (this[526] == 18);
@@ -21,9 +21,17 @@ public:
 		virtual ~PETMemory();
 		virtual byte read(ushort addr);
 		virtual void write(ushort addr, byte value);
+		virtual bool SerializeState(StateIO& io);
+		virtual bool IsRomPage(byte page);
+		void RemapPages();
 	};
 
-	EmuPET(int ram_size);
+	EmuPET(int ram_size, unsigned fast_paths = DefaultFastPaths);
 	~EmuPET();
 	virtual bool ExecutePatch();
+	virtual const char* GetRegionName(ushort addr);
+	virtual int GetBasicLineAddress() { return 0x88; } // basic1, basic2 would be $36
+
+private:
+	int startup_state = 0;
 };
\ No newline at end of file
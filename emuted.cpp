@@ -69,11 +69,21 @@
 
 #include "emuted.h"
 
-// externals (globals)
-extern const char* StartupPRG;
-extern int main_go_num;
+#include <string.h>
+
     
-EmuTed::EmuTed(int ram_size) : EmuCBM(new TedMemory(ram_size*1024))
+EmuTed::EmuTed(int ram_size, unsigned fast_paths) : EmuCBM(new TedMemory(ram_size*1024), fast_paths)
+{
+  startup_state = 0;
+  go_state = 0;
+  SetBootKey("ted", ram_size);
+  SetTrap(0x8703); // READY
+  SetTrap(0x8C77); // Execute after GO
+  SetChrget(0x0473);
+  TrapKernalLoops(0xC000, 0xFD00); // below I/O
+}
+
+EmuTed::EmuTed(TedMemory* memory) : EmuCBM(memory, 0) // ForkState() copies fast_paths
 {
   startup_state = 0;
   go_state = 0;
@@ -83,10 +93,34 @@ EmuTed::~EmuTed()
 {
 }
 
+// by address, ignores banking
+const char* EmuTed::GetRegionName(ushort addr)
+{
+  if (addr >= 0x8000 && addr < 0xC000)
+    return "BASIC";
+  if (addr >= 0xC000 && (addr < 0xFD00 || addr >= 0xFF40))
+    return "KERNAL";
+  return 0;
+}
+
+Emu6502* EmuTed::Fork()
+{
+  EmuTed* child = new EmuTed(new TedMemory((TedMemory*)memory));
+  ForkState(child);
+  child->startup_state = startup_state;
+  child->go_state = go_state;
+  return child;
+}
+
 bool EmuTed::ExecutePatch()
 {
+    if (ExecuteFastChrget())
+        return true;
+    if (ExecuteFastKernal())
+        return true;
     if (PC == 0x8703 || PC == LOAD_TRAP) // READY
     {
+        ReadyReached();
         go_state = 0;
 
         if (startup_state == 0 && (StartupPRG != 0 || PC == LOAD_TRAP))
@@ -185,7 +219,7 @@ bool EmuTed::ExecutePatch()
         }
         else if (go_state == 1)
         {
-            main_go_num = (ushort)(GetMemory(0x14) + (GetMemory(0x15) << 8));
+            go_num = (ushort)(GetMemory(0x14) + (GetMemory(0x15) << 8));
             quit = true;
             return true;
         }
@@ -247,29 +281,54 @@ EmuTed::TedMemory::TedMemory(int size)
     else
         ram_size = 64 * 1024;
 
-    ram = new byte[ram_size];
-
-    basic_rom = new byte[basic_rom_length];
-    EmuCBM::File_ReadAllBytes(basic_rom, basic_rom_length, "roms/ted/basic");
-    kernal_rom = new byte[kernal_rom_length];
-    EmuCBM::File_ReadAllBytes(kernal_rom, kernal_rom_length, "roms/ted/kernal");
+    ram = new CowRam(ram_size);
 
-    for (int i = 0; i < ram_size; ++i)
-        ram[i] = 0;
+    roms = std::shared_ptr<byte>(new byte[basic_rom_length + kernal_rom_length], std::default_delete<byte[]>());
+    basic_rom = roms.get();
+    EmuCBM::File_ReadRom(basic_rom, basic_rom_length, "roms/ted/basic");
+    kernal_rom = basic_rom + basic_rom_length;
+    EmuCBM::File_ReadRom(kernal_rom, kernal_rom_length, "roms/ted/kernal");
 
     io = new byte[io_length];
     for (int i = 0; i < io_length; ++i)
         io[i] = 0;
+
+    RemapPages();
+}
+
+EmuTed::TedMemory::TedMemory(TedMemory* parent)
+{
+    rom_enabled = parent->rom_enabled;
+    rom_config = parent->rom_config;
+    ram_size = parent->ram_size;
+    ram = new CowRam(parent->ram);
+    roms = parent->roms;
+    basic_rom = parent->basic_rom;
+    kernal_rom = parent->kernal_rom;
+    io = new byte[io_length];
+    memcpy(io, parent->io, io_length);
+
+    RemapPages();
+    parent->RemapPages(); // parent no longer owns its pages either
 }
 
 EmuTed::TedMemory::~TedMemory()
 {
-    delete [] ram;
-    delete [] basic_rom;
-    delete [] kernal_rom;
+    delete ram;
     delete [] io;
 }
 
+bool EmuTed::TedMemory::SerializeState(Emu6502::StateIO& io)
+{
+    ram->SerializeState(io);
+    io.Bytes(this->io, io_length);
+    io.Value(rom_enabled);
+    io.Value(rom_config);
+    if (!io.IsSaving())
+        RemapPages();
+    return true;
+}
+
 byte EmuTed::TedMemory::read(ushort addr)
 {
     if (addr == 0xFF08) // key matrix
@@ -277,7 +336,7 @@ byte EmuTed::TedMemory::read(ushort addr)
     if (addr >= io_addr && addr < io_addr + io_length)
         return io[addr - io_addr];
     else if (!rom_enabled || addr < basic_addr)
-        return ram[addr & (ram_size - 1)]; // note RAM wraps around when less than 64K
+        return ram->Read(addr & (ram_size - 1)); // note RAM wraps around when less than 64K
     else if (((rom_config & 0x03) == 0) && rom_enabled && addr >= basic_addr && addr < basic_addr + basic_rom_length)
         return basic_rom[addr - basic_addr];
     else if (((rom_config & 0x0C) == 0) && rom_enabled && (addr >= kernal_addr && addr < kernal_addr + kernal_rom_length) || (addr >= nonbank_kernal && addr < nonbank_kernal + nonbank_len))
@@ -289,11 +348,20 @@ byte EmuTed::TedMemory::read(ushort addr)
 void EmuTed::TedMemory::write(ushort addr, byte value)
 {
     if (addr == 0xFF3E)
+    {
         rom_enabled = true;
+        RemapPages();
+    }
     else if (addr == 0xFF3F)
+    {
         rom_enabled = false;
+        RemapPages();
+    }
     else if (addr >= config_addr && addr < config_addr + config_len)
+    {
         rom_config = addr & 0xF;
+        RemapPages();
+    }
     else if (addr >= io_addr && addr < io_addr + io_length)
     {
         io[addr - io_addr] = value;
@@ -304,7 +372,9 @@ void EmuTed::TedMemory::write(ushort addr, byte value)
     }
     else
     {
-        ram[addr & (ram_size - 1)] = value; // includes writing under rom, note RAM wraps around when less than 64K
+        // includes writing under rom, note RAM wraps around when less than 64K
+        if (ram->Write(addr & (ram_size - 1), value)) // first write since fork, page copied
+            RemapPages();
         // if (addr == 194 || addr == 1339)
         //     ApplyColor();
         // else if (addr == 207)
@@ -419,3 +489,37 @@ enum TedColor
 //             return ConsoleColor.Black;
 //     }
 // }
+
+// Fast path pages follow rom_enabled/rom_config, same rules as read()/write()
+// Pages FD00-FFFF (I/O, banking registers) are never mapped
+void EmuTed::TedMemory::RemapPages()
+{
+    for (int page = 0; page < (io_addr >> 8); ++page)
+    {
+        int addr = page << 8;
+        byte* ram_page = ram->Page((addr & (ram_size - 1)) >> 8);
+        byte* read_page;
+        if (!rom_enabled || addr < basic_addr)
+            read_page = ram_page;
+        else if (addr >= nonbank_kernal)
+            read_page = &kernal_rom[addr - kernal_addr];
+        else if (addr < kernal_addr)
+            read_page = ((rom_config & 0x03) == 0) ? &basic_rom[addr - basic_addr] : 0;
+        else
+            read_page = ((rom_config & 0x0C) == 0) ? &kernal_rom[addr - kernal_addr] : 0;
+        MapPages(page, 1, read_page, ram->IsOwned((addr & (ram_size - 1)) >> 8) ? ram_page : 0); // shared pages copied by write()
+    }
+}
+
+// BASIC or KERNAL as rom_enabled and rom_config select them, not function or cartridge ROM
+bool EmuTed::TedMemory::IsRomPage(byte page)
+{
+    int addr = page << 8;
+    if (!rom_enabled || addr < basic_addr || addr >= io_addr)
+        return false; // RAM, or pages with I/O
+    if (addr >= nonbank_kernal)
+        return true;
+    if (addr < kernal_addr)
+        return (rom_config & 0x03) == 0;
+    return (rom_config & 0x0C) == 0;
+}
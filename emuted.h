@@ -1,6 +1,9 @@
 #pragma once
 
 #include "emucbm.h"
+#include "cowram.h"
+
+#include <memory>
 
 class EmuTed : public EmuCBM 
 {
@@ -9,13 +12,20 @@ public:
   {
     public:
       TedMemory(int ram_size);
+      TedMemory(TedMemory* parent); // fork, RAM shared copy-on-write, ROM shared
       virtual ~TedMemory();
       virtual byte read(ushort addr);
       virtual void write(ushort addr, byte value);
+      virtual bool SerializeState(Emu6502::StateIO& io);
+      virtual bool IsRomPage(byte page);
+
+    private:
+      void RemapPages();
 
     private:
       int ram_size;
-      byte* ram; // note if less than 64K, then addressing wraps around
+      CowRam* ram; // note if less than 64K, then addressing wraps around
+      std::shared_ptr<byte> roms; // basic, kernal in one block, shared with forks
       byte* basic_rom;
       byte* kernal_rom;
       byte* io;
@@ -28,8 +38,14 @@ public:
   };
 
 public:
-  EmuTed(int ram_size);
+  EmuTed(int ram_size, unsigned fast_paths = DefaultFastPaths);
   virtual ~EmuTed();
+  virtual Emu6502* Fork();
+  virtual const char* GetRegionName(ushort addr);
+  virtual int GetBasicLineAddress() { return 0x3B; }
+
+private:
+  EmuTed(TedMemory* memory); // for Fork()
 
 private:
   int startup_state;
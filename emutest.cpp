@@ -48,31 +48,31 @@
 #include <stdio.h>
 #include <string.h>
 
-extern const char* StartupPRG;
-
 #include "emutest.h"
+#include "emuc64.h"
 
-static bool start = true;
-static int last_test = -1;
-
-EmuTest::EmuTest(const char* filename)
-	: Emu6502(new TestMemory(filename))
+EmuTest::EmuTest(const char* filename, Engine engine)
+	: Emu6502(new TestMemory(filename), engine)
 {
     //trace = true;
+    SetAllTraps(); // test status is checked at every instruction
+    start = true;
+    last_test = -1;
+    start_clock = clock();
 }
 
 EmuTest::~EmuTest()
 {
 }
 
-byte EmuTest::GetMemory(ushort addr)
+// instructions per second, to compare engines
+void EmuTest::ReportSpeed()
 {
-	return memory->read(addr);
-}
-
-void EmuTest::SetMemory(ushort addr, byte value)
-{
-	memory->write(addr, value);
+    double seconds = (double)(clock() - start_clock) / CLOCKS_PER_SEC;
+    printf("%s engine: %llu instructions, %llu cycles in %.2f seconds", (engine == SwitchEngine) ? "switch" : (engine == BlockEngine) ? "block" : (engine == JitEngine) ? "jit" : (engine == RomEngine) ? "rom" : "table", GetInstructions(), GetCycles(), seconds);
+    if (seconds > 0)
+        printf(", %.0f instructions/second", GetInstructions() / seconds);
+    printf("\n");
 }
 
 bool EmuTest::ExecutePatch()
@@ -83,9 +83,10 @@ bool EmuTest::ExecutePatch()
 		start = false;
         return true;
 	}
-    if (GetMemory(PC) == 0xD0/*BNE*/ && !Z && GetMemory((ushort)(PC + 1)) == 0xFE)
+    if (GetMemory(PC) == 0xD0/*BNE*/ && !GetZ() && GetMemory((ushort)(PC + 1)) == 0xFE)
     {
         printf("%04X Test FAIL\n", PC);
+        ReportSpeed();
         quit = true;
         return false;
     }
@@ -95,6 +96,7 @@ bool EmuTest::ExecutePatch()
         )
     {
         printf("%04X COMPLETED SUCCESS\n", PC);
+        ReportSpeed();
         quit = true;
         return false;
     }
@@ -113,6 +115,8 @@ TestMemory::TestMemory(const char* filename)
 	ram = new unsigned char[ram_size];
 	memset(ram, 0, ram_size);
 	EmuCBM::File_ReadAllBytes(ram, ram_size, filename);
+	MapPages(0, 0x100, ram, 0);
+	MapPages(0, 0x80, ram, ram); // upper half is write protected
 }
 
 TestMemory::~TestMemory()
@@ -130,3 +134,124 @@ void TestMemory::write(ushort addr, byte value)
 	if (addr < 0x8000)
 		ram[addr] = value;
 }
+
+// phase 1, bank_test.asm style: cycle $01 through all eight LORAM/HIRAM/CHAREN
+// configurations, reading and writing $A000, $C800, $D800, $E000 in each
+static const byte bank_switch_code[] =
+{
+	0x78,             // C000 sei
+	0xA9, 0x10,       // C001 lda #16
+	0x85, 0xFC,       // C003 sta $fc      ; outer count, $fb middle count starts at 0
+	0xA0, 0x00,       // C005 ldy #0
+	0xA2, 0x00,       // C007 ldx #0       ; bank
+	0xA5, 0x01,       // C009 lda $01
+	0x29, 0xF8,       // C00B and #$f8
+	0x86, 0x02,       // C00D stx $02
+	0x05, 0x02,       // C00F ora $02
+	0x85, 0x01,       // C011 sta $01
+	0xAD, 0x00, 0xA0, // C013 lda $a000
+	0x8D, 0x00, 0xA0, // C016 sta $a000
+	0xAD, 0x00, 0xC8, // C019 lda $c800
+	0xAD, 0x00, 0xD8, // C01C lda $d800
+	0x8D, 0x00, 0xD8, // C01F sta $d800
+	0xAD, 0x00, 0xE0, // C022 lda $e000
+	0x8D, 0x00, 0xE0, // C025 sta $e000
+	0xE8,             // C028 inx
+	0x8A,             // C029 txa
+	0x29, 0x07,       // C02A and #7
+	0xAA,             // C02C tax
+	0x88,             // C02D dey
+	0xD0, 0xD9,       // C02E bne $c009
+	0xC6, 0xFB,       // C030 dec $fb
+	0xD0, 0xD5,       // C032 bne $c009
+	0xC6, 0xFC,       // C034 dec $fc
+	0xD0, 0xD1,       // C036 bne $c009
+	0xA5, 0x01,       // C038 lda $01
+	0x09, 0x07,       // C03A ora #7       ; back to normal banking
+	0x85, 0x01,       // C03C sta $01
+	0x4C, 0x01, 0x08, // C03E jmp $0801
+};
+
+// phase 2, BASIC style: code in program area reading BASIC and KERNAL ROM,
+// program text and variables, with a subroutine call per byte
+static const byte basic_style_code[] =
+{
+	0xA9, 0x10,       // 0801 lda #16
+	0x85, 0xFC,       // 0803 sta $fc
+	0xA0, 0x00,       // 0805 ldy #0
+	0xB9, 0x00, 0xA0, // 0807 lda $a000,y  ; BASIC ROM
+	0x59, 0x00, 0xE0, // 080A eor $e000,y  ; KERNAL ROM
+	0x99, 0x00, 0x40, // 080D sta $4000,y  ; variables
+	0xB9, 0x00, 0x08, // 0810 lda $0800,y  ; program text
+	0x99, 0x00, 0x90, // 0813 sta $9000,y  ; strings
+	0x20, 0x1E, 0x08, // 0816 jsr $081e
+	0x88,             // 0819 dey
+	0xD0, 0xEB,       // 081A bne $0807
+	0xF0, 0x05,       // 081C beq $0823
+	0xE6, 0x02,       // 081E inc $02
+	0xA5, 0x02,       // 0820 lda $02
+	0x60,             // 0822 rts
+	0xC6, 0xFB,       // 0823 dec $fb
+	0xD0, 0xE0,       // 0825 bne $0807
+	0xC6, 0xFC,       // 0827 dec $fc
+	0xD0, 0xDC,       // 0829 bne $0807
+	0x4C, 0x2B, 0x08, // 082B jmp $082b    ; done
+};
+
+EmuBankTest::EmuBankTest(Engine engine)
+	: Emu6502(new C64Memory(64 * 1024), engine)
+{
+	C64Memory* c64memory = (C64Memory*)memory;
+	memset(c64memory->basic_rom, 0xBA, C64Memory::basic_rom_size);
+	memset(c64memory->char_rom, 0xC4, C64Memory::char_rom_size);
+	memset(c64memory->kernal_rom, 0xEA, C64Memory::kernal_rom_size);
+	for (unsigned i = 0; i < sizeof(bank_switch_code); ++i)
+		SetMemory((ushort)(0xC000 + i), bank_switch_code[i]);
+	for (unsigned i = 0; i < sizeof(basic_style_code); ++i)
+		SetMemory((ushort)(0x0801 + i), basic_style_code[i]);
+	SetTrap((ushort)(GetMemory(0xFFFC) | (GetMemory(0xFFFD) << 8))); // RESET, start
+	SetTrap(0x0801);
+	SetTrap(0x082B);
+	start = true;
+	start_instructions = 0;
+	start_cycles = 0;
+	start_clock = clock();
+}
+
+EmuBankTest::~EmuBankTest()
+{
+}
+
+void EmuBankTest::ReportSpeed(const char* phase)
+{
+	double seconds = (double)(clock() - start_clock) / CLOCKS_PER_SEC;
+	unsigned long long instructions = GetInstructions() - start_instructions;
+	unsigned long long cycles = GetCycles() - start_cycles;
+	printf("%s: %llu instructions, %llu cycles in %.2f seconds", phase, instructions, cycles, seconds);
+	if (seconds > 0)
+		printf(", %.0f instructions/second", instructions / seconds);
+	printf("\n");
+	start_instructions = GetInstructions();
+	start_cycles = GetCycles();
+	start_clock = clock();
+}
+
+bool EmuBankTest::ExecutePatch()
+{
+	if (start)
+	{
+		PC = 0xC000;
+		start = false;
+		start_clock = clock();
+		return true;
+	}
+	if (PC == 0x0801)
+		ReportSpeed("bank switching");
+	else if (PC == 0x082B)
+	{
+		ReportSpeed("BASIC style");
+		quit = true;
+		return false;
+	}
+	return false;
+}
@@ -2,24 +2,55 @@
 
 #include "emu6502.h"
 
+#include <time.h>
+
 class EmuTest : public Emu6502
 {
 public:
-	EmuTest(const char* filename);
+	EmuTest(const char* filename, Engine engine = TableEngine);
 	virtual ~EmuTest();
 
 protected:
 	bool ExecutePatch();
 
 private:
-	byte GetMemory(ushort addr);
-	void SetMemory(ushort addr, byte value);
+	void ReportSpeed();
+
+private:
+	bool start;
+	int last_test;
+	clock_t start_clock;
 
 private:
 	EmuTest(const EmuTest& other); // disabled
 	bool operator==(const EmuTest& other) const; // disabled
 };
 
+// C64 memory banking benchmark, no ROMs required
+// phase 1 is bank_test.asm style switching of $01, phase 2 is BASIC style ROM/RAM traffic
+class EmuBankTest : public Emu6502
+{
+public:
+	EmuBankTest(Engine engine = TableEngine);
+	virtual ~EmuBankTest();
+
+protected:
+	bool ExecutePatch();
+
+private:
+	void ReportSpeed(const char* phase);
+
+private:
+	bool start;
+	unsigned long long start_instructions;
+	unsigned long long start_cycles;
+	clock_t start_clock;
+
+private:
+	EmuBankTest(const EmuBankTest& other); // disabled
+	bool operator==(const EmuBankTest& other) const; // disabled
+};
+
 class TestMemory : public Emu6502::Memory
 {
 public:
@@ -64,14 +64,28 @@
 
 #include "emuvic20.h"
 
-EmuVic20::EmuVic20(int ram_size) : EmuCBM(new Vic20Memory(ram_size * 1024))
+EmuVic20::EmuVic20(int ram_size, unsigned fast_paths) : EmuCBM(new Vic20Memory(ram_size * 1024), fast_paths)
 {
+	SetBootKey("vic20", ram_size);
+	SetTrap(0xC474); // READY
+	SetTrap(0xC815); // Execute after GO
+	SetChrget(0x0073);
+	TrapKernalLoops(0xE000, 0x10000);
 }
 
 EmuVic20::~EmuVic20()
 {
 }
 
+const char* EmuVic20::GetRegionName(ushort addr)
+{
+	if (addr >= 0xC000 && addr < 0xE000)
+		return "BASIC";
+	if (addr >= 0xE000)
+		return "KERNAL";
+	return 0;
+}
+
 static byte RamSizeToRamConfig(int ram_size)
 {
 	if (ram_size < 8 * 1024)
@@ -96,13 +110,15 @@ static byte RamSizeToRamConfig(int ram_size)
 		return 0x1F; // 40K = 1K LOW + 3K EXP + 4K BASE + 32K EXP (ALL NOT AVAILABLE TO BASIC)
 }
 
-static int go_state = 0;
-static int startup_state = 0;
-
 bool EmuVic20::ExecutePatch()
 {
+	if (ExecuteFastChrget())
+		return true;
+	if (ExecuteFastKernal())
+		return true;
 	if (PC == 0xC474 || PC == LOAD_TRAP) // READY
 	{
+		ReadyReached();
 		go_state = 0;
 
 		if (startup_state == 0 && (StartupPRG != 0 || PC == LOAD_TRAP))
@@ -208,8 +224,7 @@ bool EmuVic20::ExecutePatch()
 		}
 		else if (go_state == 2)
 		{
-			extern int main_go_num;
-			main_go_num = (ushort)(Y + (A << 8));
+			go_num = (ushort)(Y + (A << 8));
 			quit = true;
 			return true;
 		}
@@ -263,9 +278,11 @@ EmuVic20::Vic20Memory::Vic20Memory(byte size)
 	basic_rom = new byte[basic_size];
 	kernal_rom = new byte[kernal_size];
 
-	EmuCBM::File_ReadAllBytes(char_rom, char_size, "roms/vic20/chargen");
-	EmuCBM::File_ReadAllBytes(basic_rom, basic_size, "roms/vic20/basic");
-	EmuCBM::File_ReadAllBytes(kernal_rom, kernal_size, "roms/vic20/kernal");
+	EmuCBM::File_ReadRom(char_rom, char_size, "roms/vic20/chargen");
+	EmuCBM::File_ReadRom(basic_rom, basic_size, "roms/vic20/basic");
+	EmuCBM::File_ReadRom(kernal_rom, kernal_size, "roms/vic20/kernal");
+
+	RemapPages();
 }
 
 EmuVic20::Vic20Memory::~Vic20Memory()
@@ -277,6 +294,15 @@ EmuVic20::Vic20Memory::~Vic20Memory()
 	delete[] kernal_rom;
 }
 
+bool EmuVic20::Vic20Memory::SerializeState(Emu6502::StateIO& io)
+{
+	io.Bytes(ram, ram_size);
+	io.Bytes(this->io, io_size);
+	if (!io.IsSaving())
+		RemapPages();
+	return true;
+}
+
 byte EmuVic20::Vic20Memory::read(ushort addr)
 {
 	if (addr < ram3k_addr)
@@ -341,6 +367,33 @@ void EmuVic20::Vic20Memory::write(ushort addr, byte value)
 }
 
 
+// Fast path pages, fixed by RAM configuration.  I/O and missing RAM go through read()/write()
+void EmuVic20::Vic20Memory::RemapPages()
+{
+	MapPages(0, ram3k_addr >> 8, ram, ram);
+	byte* ram3k = ((ram_banks & 0x01) != 0) ? &ram[ram3k_addr] : 0;
+	MapPages(ram3k_addr >> 8, (ram4k_addr - ram3k_addr) >> 8, ram3k, ram3k);
+	MapPages(ram4k_addr >> 8, (ram8k1_addr - ram4k_addr) >> 8, &ram[ram4k_addr], &ram[ram4k_addr]);
+	byte* ram8k1 = ((ram_banks & 0x02) != 0) ? &ram[ram8k1_addr] : 0;
+	MapPages(ram8k1_addr >> 8, (ram8k2_addr - ram8k1_addr) >> 8, ram8k1, ram8k1);
+	byte* ram8k2 = ((ram_banks & 0x04) != 0) ? &ram[ram8k2_addr] : 0;
+	MapPages(ram8k2_addr >> 8, (ram8k3_addr - ram8k2_addr) >> 8, ram8k2, ram8k2);
+	byte* ram8k3 = ((ram_banks & 0x08) != 0) ? &ram[ram8k3_addr] : 0;
+	MapPages(ram8k3_addr >> 8, (char_addr - ram8k3_addr) >> 8, ram8k3, ram8k3);
+	MapPages(char_addr >> 8, char_size >> 8, char_rom, 0);
+	MapPages(io_addr >> 8, io_size >> 8, 0, 0);
+	byte* cart = ((ram_banks & 0x10) != 0) ? &ram[cart_addr] : 0;
+	MapPages(cart_addr >> 8, (basic_addr - cart_addr) >> 8, cart, cart);
+	MapPages(basic_addr >> 8, basic_size >> 8, basic_rom, 0);
+	MapPages(kernal_addr >> 8, kernal_size >> 8, kernal_rom, 0);
+}
+
+// BASIC and KERNAL, never banked
+bool EmuVic20::Vic20Memory::IsRomPage(byte page)
+{
+	return page >= (basic_addr >> 8);
+}
+
 /*static void ApplyColor()
 {
 	CBM_Console.Reverse = (this[199] != 0) ^ ((this[0x900F] & 0x8) == 1);
@@ -12,6 +12,9 @@ public:
 		virtual ~Vic20Memory();
 		byte read(ushort addr);
 		void write(ushort addr, byte value);
+		bool SerializeState(StateIO& io);
+		bool IsRomPage(byte page);
+		void RemapPages();
 
 		byte* ram;
 		// ram_lo;         // 1K: 0000-03FF
@@ -29,7 +32,13 @@ public:
 		int ram_size;
 	};
 
-	EmuVic20(int ram_size);
+	EmuVic20(int ram_size, unsigned fast_paths = DefaultFastPaths);
 	virtual ~EmuVic20();
 	virtual bool ExecutePatch();
+	virtual const char* GetRegionName(ushort addr);
+	virtual int GetBasicLineAddress() { return 0x39; }
+
+private:
+	int go_state = 0;
+	int startup_state = 0;
 };
\ No newline at end of file
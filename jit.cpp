@@ -0,0 +1,838 @@
+// jit.cpp - Jit - x86-64 translation of hot 6502 blocks
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "jit.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const size_t buffer_size = 4 * 1024 * 1024;
+
+// host registers, guest state in callee saved ones so it survives calls to helpers
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+enum { EMU = RBX, REG_A = R12, REG_X = R13, REG_Y = R14, REG_NZ = R15, REG_C = RBP };
+
+// condition codes for Jcc/SETcc
+enum { CondB = 2, CondAE = 3, CondE = 4, CondNE = 5 };
+
+// Prefix() flags
+enum { W = 1, BYTE_REG = 2, OP16 = 4, ESC = 8 }; // REX.W, byte register (forces REX so 4-7 are SPL-DIL), 0x66, 0x0F
+
+// operand addressing, see AddressMode()
+enum { ModeIM, ModeZP, ModeZPX, ModeZPY, ModeABS, ModeABSX, ModeABSY, ModeIndX, ModeIndY };
+
+// stack frame below pushed registers: [rsp+8] pointer low byte, [rsp+16] address across ReadSlow()
+static const int frame_size = 24; // keeps calls 16 byte aligned
+
+// operand addressing of memory instructions, from the regular opcode layout aaabbbcc
+static int AddressMode(byte opcode)
+{
+	static const int group_one[8] = { ModeIndX, ModeZP, ModeIM, ModeABS, ModeIndY, ModeZPX, ModeABSY, ModeABSX };
+	static const int others[8] = { ModeIM, ModeZP, ModeIM, ModeABS, ModeIM, ModeZPX, ModeIM, ModeABSX };
+	int bbb = (opcode >> 2) & 7;
+	if ((opcode & 3) == 1)
+		return group_one[bbb];
+	if (opcode == 0x96 || opcode == 0xB6) // STX/LDX zp,Y
+		return ModeZPY;
+	if (opcode == 0xBE) // LDX abs,Y
+		return ModeABSY;
+	return others[bbb];
+}
+
+Jit::Jit(Emu6502* emu)
+{
+	this->emu = emu;
+	// never writable and executable at once, Compile() makes pages writable only while copying in
+	void* p = mmap(0, buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p != MAP_FAILED && mprotect(p, buffer_size, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(p, buffer_size);
+		p = MAP_FAILED;
+	}
+	buffer = (p == MAP_FAILED) ? 0 : (byte*)p; // e.g. executable mappings denied, block engine only
+	used = 0;
+
+	const char* base = (const char*)emu;
+	layout.A = (int)((const char*)&emu->A - base);
+	layout.X = (int)((const char*)&emu->X - base);
+	layout.Y = (int)((const char*)&emu->Y - base);
+	layout.S = (int)((const char*)&emu->S - base);
+	layout.NZ = (int)((const char*)&emu->NZ - base);
+	layout.V = (int)((const char*)&emu->V - base);
+	layout.D = (int)((const char*)&emu->D - base);
+	layout.I = (int)((const char*)&emu->I - base);
+	layout.C = (int)((const char*)&emu->C - base);
+	layout.PC = (int)((const char*)&emu->PC - base);
+	layout.cycles = (int)((const char*)&emu->cycles - base);
+	layout.instructions = (int)((const char*)&emu->instructions - base);
+	layout.code_map = (int)((const char*)emu->code_map - base);
+	layout.block_exit = (int)((const char*)&emu->block_exit - base);
+
+	page = 0;
+	pc = 0;
+	next_pc = 0;
+	op_index = 0;
+	pending_cycles = 0;
+}
+
+Jit::~Jit()
+{
+	if (buffer != 0)
+		munmap(buffer, buffer_size);
+}
+
+void Jit::Clear()
+{
+	used = 0; // code still running returns without compiling, so may be overwritten afterwards
+}
+
+byte Jit::ReadSlow(Emu6502* emu, ushort addr)
+{
+	return emu->memory->read(addr);
+}
+
+void Jit::WriteSlow(Emu6502* emu, ushort addr, byte value)
+{
+	emu->SetMemory(addr, value); // sets block_exit for banking, quit or a rewritten opcode
+}
+
+void Jit::Handler(Emu6502* emu, byte opcode)
+{
+	(emu->*Emu6502::op_table[opcode])();
+}
+
+Jit::Code Jit::Compile(ushort pc, const byte* page, const Emu6502::BlockOp* ops, int count)
+{
+	if (buffer == 0)
+		return 0;
+
+	code.clear();
+	exits.clear();
+	this->page = page;
+
+	// prologue: save callee saved registers, emu in rbx, load guest registers
+	static const int saved[6] = { RBP, RBX, R12, R13, R14, R15 };
+	for (int i = 0; i < 6; ++i)
+		Prefix(0x50 + (saved[i] & 7), 0, -1, -1, saved[i]);
+	RegReg(0x83, 5, RSP, W); Byte(frame_size); // sub rsp, frame_size
+	RegReg(0x8B, EMU, RDI, W); // mov rbx, rdi
+	EmitLoadRegs();
+
+	pending_cycles = 0;
+	for (op_index = 0; op_index < count; ++op_index)
+	{
+		this->pc = pc;
+		pc = (ushort)(pc + Emu6502::InstructionLength(ops[op_index].opcode));
+		next_pc = pc;
+		pending_cycles += ops[op_index].cycles;
+		EmitOp(ops[op_index].opcode);
+	}
+	if (!Emu6502::EndsBlock(ops[count - 1].opcode))
+	{
+		--op_index;
+		EmitExit(pc); // ran off the end, e.g. page end or trap next
+	}
+
+	// epilogue, all exits come here with PC and counters updated
+	for (size_t i = 0; i < exits.size(); ++i)
+		Bind(exits[i]);
+	EmitStoreRegs();
+	RegReg(0x83, 0, RSP, W); Byte(frame_size); // add rsp, frame_size
+	for (int i = 5; i >= 0; --i)
+		Prefix(0x58 + (saved[i] & 7), 0, -1, -1, saved[i]);
+	Byte(0xC3); // ret
+
+	if (used + code.size() > buffer_size)
+		return 0;
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t start = used & ~(page_size - 1);
+	size_t end = (used + code.size() + page_size - 1) & ~(page_size - 1);
+	if (mprotect(buffer + start, end - start, PROT_READ | PROT_WRITE) != 0)
+		return 0;
+	Code result = (Code)(buffer + used);
+	memcpy(buffer + used, &code[0], code.size());
+	mprotect(buffer + start, end - start, PROT_READ | PROT_EXEC); // as the constructor had them, translations here run again
+	used += (code.size() + 15) & ~(size_t)15;
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////
+// x86-64 encoding
+
+void Jit::Byte(int value)
+{
+	code.push_back((byte)value);
+}
+
+void Jit::Dword(int value)
+{
+	for (int i = 0; i < 4; ++i)
+		Byte(value >> (8 * i));
+}
+
+void Jit::Qword(unsigned long long value)
+{
+	for (int i = 0; i < 8; ++i)
+		Byte((int)(value >> (8 * i)));
+}
+
+// legacy prefix, REX from register numbers (-1 for none), escape and opcode byte
+void Jit::Prefix(int op, int flags, int reg, int index, int base)
+{
+	if (flags & OP16)
+		Byte(0x66);
+	int rex = ((flags & W) ? 8 : 0) | ((reg >= 8) ? 4 : 0) | ((index >= 8) ? 2 : 0) | ((base >= 8) ? 1 : 0);
+	if (rex != 0 || (flags & BYTE_REG))
+		Byte(0x40 | rex);
+	if (flags & ESC)
+		Byte(0x0F);
+	Byte(op);
+}
+
+// op reg, [base + disp32]
+void Jit::RegMem(int op, int reg, int base, int disp, int flags)
+{
+	Prefix(op, flags, reg, -1, base);
+	Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+	if ((base & 7) == RSP)
+		Byte(0x24); // SIB, no index
+	Dword(disp);
+}
+
+// op reg, [base + index << scale + disp32]
+void Jit::RegMemIndex(int op, int reg, int base, int index, int scale, int disp, int flags)
+{
+	Prefix(op, flags, reg, index, base);
+	Byte(0x84 | ((reg & 7) << 3));
+	Byte((scale << 6) | ((index & 7) << 3) | (base & 7));
+	Dword(disp);
+}
+
+// op reg, rm with both registers
+void Jit::RegReg(int op, int reg, int rm, int flags)
+{
+	Prefix(op, flags, reg, -1, rm);
+	Byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// 32 bit group 1: 0 add, 1 or, 4 and, 5 sub, 6 xor, 7 cmp
+void Jit::AluImm(int ext, int rm, int imm)
+{
+	if (imm >= -128 && imm <= 127)
+	{
+		RegReg(0x83, ext, rm);
+		Byte(imm);
+	}
+	else
+	{
+		RegReg(0x81, ext, rm);
+		Dword(imm);
+	}
+}
+
+// 32 bit group 2: 4 shl, 5 shr
+void Jit::ShiftImm(int ext, int rm, int count)
+{
+	RegReg(0xC1, ext, rm);
+	Byte(count);
+}
+
+void Jit::MovImm(int reg, const void* ptr)
+{
+	Prefix(0xB8 + (reg & 7), W, -1, -1, reg);
+	Qword((unsigned long long)(uintptr_t)ptr);
+}
+
+void Jit::Call(const void* function)
+{
+	MovImm(RAX, function);
+	RegReg(0xFF, 2, RAX); // call rax
+}
+
+size_t Jit::Jcc(int cond)
+{
+	Byte(0x0F);
+	Byte(0x80 + cond);
+	Dword(0);
+	return code.size();
+}
+
+size_t Jit::Jmp()
+{
+	Byte(0xE9);
+	Dword(0);
+	return code.size();
+}
+
+void Jit::Bind(size_t fixup)
+{
+	int rel = (int)(code.size() - fixup);
+	for (int i = 0; i < 4; ++i)
+		code[fixup - 4 + i] = (byte)(rel >> (8 * i));
+}
+
+///////////////////////////////////////////////////////////////////////
+// 6502 translation, mirrors the table engine handlers
+
+void Jit::EmitLoadRegs()
+{
+	RegMem(0xB6, REG_A, EMU, layout.A, ESC); // movzx r12d, byte [A]
+	RegMem(0xB6, REG_X, EMU, layout.X, ESC);
+	RegMem(0xB6, REG_Y, EMU, layout.Y, ESC);
+	RegMem(0xB7, REG_NZ, EMU, layout.NZ, ESC); // movzx r15d, word [NZ]
+	RegMem(0xB6, REG_C, EMU, layout.C, ESC);
+}
+
+void Jit::EmitStoreRegs()
+{
+	RegMem(0x88, REG_A, EMU, layout.A, BYTE_REG); // mov [A], r12b
+	RegMem(0x88, REG_X, EMU, layout.X, BYTE_REG);
+	RegMem(0x88, REG_Y, EMU, layout.Y, BYTE_REG);
+	RegMem(0x89, REG_NZ, EMU, layout.NZ, OP16); // mov [NZ], r15w
+	RegMem(0x88, REG_C, EMU, layout.C, BYTE_REG);
+}
+
+// rax = host address of operand, read as executed so self-modified operands work
+void Jit::EmitOperandPtr()
+{
+	MovImm(RAX, page + (pc & 0xFF) + 1);
+}
+
+// esi = effective address, with page crossing penalty for reads like ReadABSX()/ReadIndY()
+void Jit::EmitAddress(int mode, bool read)
+{
+	EmitOperandPtr();
+	if (mode == ModeABS || mode == ModeABSX || mode == ModeABSY)
+		RegMem(0xB7, RSI, RAX, 0, ESC); // movzx esi, word [rax]
+	else
+		RegMem(0xB6, RSI, RAX, 0, ESC); // movzx esi, byte [rax]
+
+	int index = -1;
+	switch (mode)
+	{
+	case ModeZPX:
+	case ModeZPY:
+		RegReg(0x01, (mode == ModeZPX) ? REG_X : REG_Y, RSI); // add esi, reg
+		RegReg(0xB6, RSI, RSI, ESC | BYTE_REG); // movzx esi, sil: wraps within zero page
+		break;
+	case ModeIndX:
+		RegReg(0x01, REG_X, RSI);
+		RegReg(0xB6, RSI, RSI, ESC | BYTE_REG);
+		EmitRead();
+		RegMem(0x89, RAX, RSP, 8); // low byte
+		AluImm(0, RSI, 1);
+		RegReg(0xB6, RSI, RSI, ESC | BYTE_REG); // pointer high byte also within zero page
+		EmitRead();
+		ShiftImm(4, RAX, 8);
+		RegMem(0x0B, RAX, RSP, 8); // or eax, low byte
+		RegReg(0x8B, RSI, RAX); // mov esi, eax
+		break;
+	case ModeIndY:
+		EmitRead();
+		RegMem(0x89, RAX, RSP, 8);
+		AluImm(0, RSI, 1); // pointer high byte from (ushort)(zp + 1), like AddrIndY()
+		EmitRead();
+		ShiftImm(4, RAX, 8);
+		RegMem(0x0B, RAX, RSP, 8);
+		RegReg(0x8B, RSI, RAX);
+		index = REG_Y;
+		break;
+	case ModeABSX:
+		index = REG_X;
+		break;
+	case ModeABSY:
+		index = REG_Y;
+		break;
+	}
+	if (index < 0)
+		return;
+
+	if (read)
+		RegReg(0x8B, RDI, RSI); // mov edi, base
+	RegReg(0x01, index, RSI);
+	RegReg(0xB7, RSI, RSI, ESC); // movzx esi, si
+	if (read)
+	{
+		RegReg(0x31, RSI, RDI); // xor edi, esi
+		RegReg(0xF7, 0, RDI); Dword(0xFF00); // test edi, 0xFF00
+		size_t same_page = Jcc(CondE);
+		RegMem(0x81, 0, EMU, layout.cycles, W); Dword(1); // add qword [cycles], 1
+		Bind(same_page);
+	}
+}
+
+// eax = operand value
+void Jit::EmitValue(int mode)
+{
+	if (mode == ModeIM)
+	{
+		EmitOperandPtr();
+		RegMem(0xB6, RAX, RAX, 0, ESC); // movzx eax, byte [rax]
+		return;
+	}
+	EmitAddress(mode, true);
+	EmitRead();
+}
+
+// eax = GetMemory(esi), esi kept, other scratch registers lost
+void Jit::EmitRead()
+{
+	MovImm(RAX, &emu->memory->read_pages);
+	RegMem(0x8B, RAX, RAX, 0, W); // mov rax, [rax]: map may be switched by banking
+	RegReg(0x8B, RCX, RSI);
+	ShiftImm(5, RCX, 8);
+	RegMemIndex(0x8B, RAX, RAX, RCX, 3, 0, W); // mov rax, [rax + rcx * 8]
+	RegReg(0x85, RAX, RAX, W);
+	size_t slow = Jcc(CondE);
+	RegReg(0xB6, RCX, RSI, ESC | BYTE_REG); // movzx ecx, sil
+	RegMemIndex(0xB6, RAX, RAX, RCX, 0, 0, ESC); // movzx eax, byte [rax + rcx]
+	size_t done = Jmp();
+	Bind(slow);
+	RegMem(0x89, RSI, RSP, 16);
+	RegReg(0x8B, RDI, EMU, W);
+	Call((const void*)&ReadSlow);
+	RegReg(0xB6, RAX, RAX, ESC); // movzx eax, al
+	RegMem(0x8B, RSI, RSP, 16);
+	Bind(done);
+}
+
+// SetMemory(esi, dl), leaving if the block engine would end the block
+void Jit::EmitWrite()
+{
+	MovImm(RAX, &emu->memory->write_pages);
+	RegMem(0x8B, RAX, RAX, 0, W);
+	RegReg(0x8B, RCX, RSI);
+	ShiftImm(5, RCX, 8);
+	RegMemIndex(0x8B, RAX, RAX, RCX, 3, 0, W);
+	RegReg(0x85, RAX, RAX, W);
+	size_t unmapped = Jcc(CondE);
+	RegReg(0x8B, RCX, RSI);
+	ShiftImm(5, RCX, 3);
+	RegMemIndex(0xB6, RCX, EMU, RCX, 0, layout.code_map, ESC); // movzx ecx, byte [code_map + addr / 8]
+	RegReg(0x8B, RDI, RSI);
+	AluImm(4, RDI, 7);
+	RegReg(0xA3, RDI, RCX, ESC); // bt ecx, edi
+	size_t code_written = Jcc(CondB);
+	RegReg(0xB6, RCX, RSI, ESC | BYTE_REG);
+	RegMemIndex(0x88, RDX, RAX, RCX, 0, 0, BYTE_REG); // mov [rax + rcx], dl
+	size_t done = Jmp();
+	Bind(unmapped);
+	Bind(code_written);
+	RegMem(0xC7, 0, EMU, layout.PC, OP16); Byte(pc); Byte(pc >> 8); // mov word [PC], pc: SetMemory() compares PC's page
+	RegReg(0x8B, RDI, EMU, W);
+	Call((const void*)&WriteSlow);
+	RegMem(0x80, 7, EMU, layout.block_exit); Byte(0); // cmp byte [block_exit], 0
+	size_t stay = Jcc(CondE);
+	EmitExit(next_pc);
+	Bind(stay);
+	Bind(done);
+}
+
+// ASL, ROL, LSR, ROR of a register holding a byte, kind from opcode bits aaa
+void Jit::EmitShift(int kind, int reg)
+{
+	switch (kind)
+	{
+	case 0: // ASL
+		RegReg(0x8B, REG_C, reg);
+		ShiftImm(5, REG_C, 7);
+		ShiftImm(4, reg, 1);
+		AluImm(4, reg, 0xFF);
+		break;
+	case 1: // ROL
+		RegReg(0x8B, RCX, reg);
+		ShiftImm(5, RCX, 7);
+		ShiftImm(4, reg, 1);
+		RegReg(0x09, REG_C, reg);
+		AluImm(4, reg, 0xFF);
+		RegReg(0x8B, REG_C, RCX);
+		break;
+	case 2: // LSR
+		RegReg(0x8B, REG_C, reg);
+		AluImm(4, REG_C, 1);
+		ShiftImm(5, reg, 1);
+		break;
+	case 3: // ROR
+		RegReg(0x8B, RCX, reg);
+		AluImm(4, RCX, 1);
+		ShiftImm(4, REG_C, 7);
+		ShiftImm(5, reg, 1);
+		RegReg(0x09, REG_C, reg);
+		RegReg(0x8B, REG_C, RCX);
+		break;
+	}
+	RegReg(0x8B, REG_NZ, reg);
+}
+
+// CMP, CPX, CPY of eax, like SubtractWithoutOverflow()
+void Jit::EmitCompare(int reg)
+{
+	RegReg(0x8B, RCX, reg);
+	RegReg(0x29, RAX, RCX); // sub ecx, eax
+	RegReg(0x8B, REG_C, RCX);
+	RegReg(0xF7, 2, REG_C); // not
+	ShiftImm(5, REG_C, 31); // C = no borrow
+	RegReg(0xB6, REG_NZ, RCX, ESC | BYTE_REG); // movzx r15d, cl
+}
+
+// conditional branch ending the block, penalty cycles like Branch()
+void Jit::EmitBranch(byte opcode)
+{
+	int flag = opcode >> 6; // N, V, C, Z
+	bool if_set = (opcode & 0x20) != 0;
+	if (flag == 0)
+	{
+		RegReg(0xF7, 0, REG_NZ); Dword(0x180); // test r15d, 0x180: ZF if N clear
+	}
+	else if (flag == 1)
+	{
+		RegMem(0x80, 7, EMU, layout.V); Byte(0); // cmp byte [V], 0
+	}
+	else if (flag == 2)
+		RegReg(0x85, REG_C, REG_C);
+	else
+	{
+		RegReg(0xF7, 0, REG_NZ); Dword(0xFF); // ZF if Z set
+		if_set = !if_set;
+	}
+	size_t not_taken = Jcc(if_set ? CondE : CondNE);
+
+	EmitOperandPtr();
+	RegMem(0xBE, RAX, RAX, 0, ESC); // movsx eax, byte [rax]
+	AluImm(0, RAX, pc + 2);
+	RegReg(0xB7, RAX, RAX, ESC); // movzx eax, ax
+	RegMem(0x89, RAX, EMU, layout.PC, OP16);
+	RegReg(0x8B, RCX, RAX);
+	AluImm(6, RCX, pc + 2);
+	RegReg(0xF7, 0, RCX); Dword(0xFF00);
+	RegReg(0x95, 0, RCX, ESC | BYTE_REG); // setne cl
+	RegReg(0xB6, RCX, RCX, ESC | BYTE_REG);
+	AluImm(0, RCX, 1);
+	RegMem(0x01, RCX, EMU, layout.cycles, W); // add [cycles], rcx: 1 taken, 2 to another page
+	EmitExit(-1);
+
+	Bind(not_taken);
+	EmitExit(next_pc);
+}
+
+// run the table engine handler, with registers and counters as it expects
+void Jit::EmitHandler(byte opcode, bool ends_block)
+{
+	EmitStoreRegs();
+	RegMem(0xC7, 0, EMU, layout.PC, OP16); Byte(pc); Byte(pc >> 8);
+	RegMem(0x81, 0, EMU, layout.cycles, W); Dword(pending_cycles);
+	RegMem(0x81, 0, EMU, layout.instructions, W); Dword(op_index + 1);
+	RegReg(0x8B, RDI, EMU, W);
+	Prefix(0xB8 + RSI, 0, -1, -1, RSI); Dword(opcode); // mov esi, opcode
+	Call((const void*)&Handler);
+	RegMem(0x81, 5, EMU, layout.cycles, W); Dword(pending_cycles); // exit adds them again
+	RegMem(0x81, 5, EMU, layout.instructions, W); Dword(op_index + 1);
+	EmitLoadRegs();
+	if (ends_block)
+	{
+		EmitExit(-1);
+		return;
+	}
+	RegMem(0x80, 7, EMU, layout.block_exit); Byte(0);
+	size_t stay = Jcc(CondE);
+	EmitExit(-1);
+	Bind(stay);
+}
+
+// leave after current op, next_pc stored unless -1
+void Jit::EmitExit(int next_pc)
+{
+	if (next_pc >= 0)
+	{
+		RegMem(0xC7, 0, EMU, layout.PC, OP16); Byte(next_pc); Byte(next_pc >> 8);
+	}
+	RegMem(0x81, 0, EMU, layout.cycles, W); Dword(pending_cycles);
+	RegMem(0x81, 0, EMU, layout.instructions, W); Dword(op_index + 1);
+	exits.push_back(Jmp());
+}
+
+void Jit::EmitOp(byte opcode)
+{
+	if ((pc & 0xFF) + Emu6502::InstructionLength(opcode) > 0x100)
+	{
+		EmitHandler(opcode, Emu6502::EndsBlock(opcode)); // operand on next page, may be mapped elsewhere
+		return;
+	}
+
+	int mode = AddressMode(opcode);
+	switch (opcode)
+	{
+	case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9: case 0xA1: case 0xB1: // LDA
+	case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE: // LDX
+	case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC: // LDY
+	{
+		int reg = ((opcode & 3) == 1) ? REG_A : ((opcode & 3) == 2) ? REG_X : REG_Y;
+		EmitValue(mode);
+		RegReg(0x8B, reg, RAX);
+		RegReg(0x8B, REG_NZ, RAX);
+		break;
+	}
+
+	case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99: case 0x81: case 0x91: // STA
+	case 0x86: case 0x96: case 0x8E: // STX
+	case 0x84: case 0x94: case 0x8C: // STY
+		EmitAddress(mode, false);
+		RegReg(0x8B, RDX, ((opcode & 3) == 1) ? REG_A : ((opcode & 3) == 2) ? REG_X : REG_Y);
+		EmitWrite();
+		break;
+
+	case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19: case 0x01: case 0x11: // ORA
+	case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39: case 0x21: case 0x31: // AND
+	case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59: case 0x41: case 0x51: // EOR
+	{
+		static const int alu_ops[3] = { 0x09, 0x21, 0x31 }; // or, and, xor
+		EmitValue(mode);
+		RegReg(alu_ops[opcode >> 5], RAX, REG_A);
+		RegReg(0x8B, REG_NZ, REG_A);
+		break;
+	}
+
+	case 0x69: case 0x65: case 0x75: case 0x6D: case 0x7D: case 0x79: case 0x61: case 0x71: // ADC
+	case 0xE9: case 0xE5: case 0xF5: case 0xED: case 0xFD: case 0xF9: case 0xE1: case 0xF1: // SBC
+	{
+		RegMem(0x80, 7, EMU, layout.D); Byte(0);
+		size_t binary = Jcc(CondE);
+		EmitHandler(opcode, false); // decimal mode
+		size_t done = Jmp();
+		Bind(binary);
+		EmitValue(mode);
+		RegReg(0x8B, RCX, REG_A);
+		RegReg(0x8B, RDX, REG_A);
+		RegReg(0x31, RAX, RDX); // edx = A ^ value
+		if (opcode < 0x80)
+		{
+			RegReg(0x01, RAX, RCX); // ecx = A + value + C
+			RegReg(0x01, REG_C, RCX);
+			RegReg(0xF7, 2, RDX); // overflow if operands have same sign
+		}
+		else
+		{
+			RegReg(0x29, RAX, RCX); // ecx = A - value - !C
+			RegReg(0x01, REG_C, RCX);
+			AluImm(5, RCX, 1);
+		}
+		RegReg(0x8B, RDI, REG_A);
+		RegReg(0x31, RCX, RDI); // edi = A ^ result, and result sign differs from A
+		RegReg(0x21, RDI, RDX);
+		ShiftImm(5, RDX, 7);
+		AluImm(4, RDX, 1);
+		RegMem(0x88, RDX, EMU, layout.V, BYTE_REG);
+		RegReg(0x8B, REG_C, RCX);
+		if (opcode < 0x80)
+			ShiftImm(5, REG_C, 8); // carry out of bit 7
+		else
+		{
+			RegReg(0xF7, 2, REG_C);
+			ShiftImm(5, REG_C, 31); // no borrow
+		}
+		RegReg(0xB6, REG_A, RCX, ESC | BYTE_REG);
+		RegReg(0x8B, REG_NZ, REG_A);
+		Bind(done);
+		break;
+	}
+
+	case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9: case 0xC1: case 0xD1: // CMP
+		EmitValue(mode);
+		EmitCompare(REG_A);
+		break;
+	case 0xE0: case 0xE4: case 0xEC: // CPX
+		EmitValue(mode);
+		EmitCompare(REG_X);
+		break;
+	case 0xC0: case 0xC4: case 0xCC: // CPY
+		EmitValue(mode);
+		EmitCompare(REG_Y);
+		break;
+
+	case 0x24: case 0x2C: // BIT
+		EmitValue(mode);
+		RegReg(0x8B, RCX, RAX);
+		RegReg(0x21, REG_A, RCX);
+		RegReg(0x95, 0, RCX, ESC | BYTE_REG); // setne cl
+		RegReg(0xB6, RCX, RCX, ESC | BYTE_REG);
+		RegReg(0x8B, REG_NZ, RAX);
+		AluImm(4, REG_NZ, 0x80);
+		ShiftImm(4, REG_NZ, 1); // N is bit 8, like SetNZ()
+		RegReg(0x09, RCX, REG_NZ);
+		ShiftImm(5, RAX, 6);
+		AluImm(4, RAX, 1);
+		RegMem(0x88, RAX, EMU, layout.V, BYTE_REG);
+		break;
+
+	case 0x0A: case 0x2A: case 0x4A: case 0x6A: // ASL, ROL, LSR, ROR A
+		EmitShift(opcode >> 5, REG_A);
+		break;
+
+	case 0x06: case 0x16: case 0x0E: case 0x1E: // ASL
+	case 0x26: case 0x36: case 0x2E: case 0x3E: // ROL
+	case 0x46: case 0x56: case 0x4E: case 0x5E: // LSR
+	case 0x66: case 0x76: case 0x6E: case 0x7E: // ROR
+		EmitAddress(mode, false);
+		EmitRead();
+		EmitShift(opcode >> 5, RAX);
+		RegReg(0x8B, RDX, RAX);
+		EmitWrite();
+		break;
+
+	case 0xE6: case 0xF6: case 0xEE: case 0xFE: // INC
+	case 0xC6: case 0xD6: case 0xCE: case 0xDE: // DEC
+		EmitAddress(mode, false);
+		EmitRead();
+		AluImm((opcode >= 0xE0) ? 0 : 5, RAX, 1);
+		AluImm(4, RAX, 0xFF);
+		RegReg(0x8B, REG_NZ, RAX);
+		RegReg(0x8B, RDX, RAX);
+		EmitWrite();
+		break;
+
+	case 0xE8: case 0xC8: case 0xCA: case 0x88: // INX, INY, DEX, DEY
+	{
+		int reg = (opcode == 0xE8 || opcode == 0xCA) ? REG_X : REG_Y;
+		AluImm((opcode == 0xE8 || opcode == 0xC8) ? 0 : 5, reg, 1);
+		AluImm(4, reg, 0xFF);
+		RegReg(0x8B, REG_NZ, reg);
+		break;
+	}
+
+	case 0xAA: // TAX
+		RegReg(0x8B, REG_X, REG_A);
+		RegReg(0x8B, REG_NZ, REG_X);
+		break;
+	case 0x8A: // TXA
+		RegReg(0x8B, REG_A, REG_X);
+		RegReg(0x8B, REG_NZ, REG_A);
+		break;
+	case 0xA8: // TAY
+		RegReg(0x8B, REG_Y, REG_A);
+		RegReg(0x8B, REG_NZ, REG_Y);
+		break;
+	case 0x98: // TYA
+		RegReg(0x8B, REG_A, REG_Y);
+		RegReg(0x8B, REG_NZ, REG_A);
+		break;
+	case 0xBA: // TSX
+		RegMem(0xB6, REG_X, EMU, layout.S, ESC);
+		RegReg(0x8B, REG_NZ, REG_X);
+		break;
+	case 0x9A: // TXS
+		RegMem(0x88, REG_X, EMU, layout.S, BYTE_REG);
+		break;
+
+	case 0x18: // CLC
+		RegReg(0x31, REG_C, REG_C);
+		break;
+	case 0x38: // SEC
+		Prefix(0xB8 + REG_C, 0, -1, -1, REG_C); Dword(1);
+		break;
+	case 0xB8: // CLV
+		RegMem(0xC6, 0, EMU, layout.V); Byte(0);
+		break;
+	case 0xD8: case 0xF8: // CLD, SED
+		RegMem(0xC6, 0, EMU, layout.D); Byte(opcode == 0xF8);
+		break;
+	case 0x58: case 0x78: // CLI, SEI
+		RegMem(0xC6, 0, EMU, layout.I); Byte(opcode == 0x78);
+		break;
+	case 0xEA: // NOP
+		break;
+
+	case 0x48: // PHA
+		RegMem(0xB6, RSI, EMU, layout.S, ESC);
+		RegReg(0x8B, RCX, RSI);
+		AluImm(5, RCX, 1);
+		RegMem(0x88, RCX, EMU, layout.S, BYTE_REG);
+		AluImm(1, RSI, 0x100);
+		RegReg(0x8B, RDX, REG_A);
+		EmitWrite();
+		break;
+	case 0x68: // PLA
+		RegMem(0xB6, RSI, EMU, layout.S, ESC);
+		AluImm(0, RSI, 1);
+		RegMem(0x88, RSI, EMU, layout.S, BYTE_REG);
+		RegReg(0xB6, RSI, RSI, ESC | BYTE_REG);
+		AluImm(1, RSI, 0x100);
+		EmitRead();
+		RegReg(0x8B, REG_A, RAX);
+		RegReg(0x8B, REG_NZ, RAX);
+		break;
+
+	case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xB0: case 0xD0: case 0xF0:
+		EmitBranch(opcode);
+		break;
+
+	case 0x4C: // JMP
+		EmitOperandPtr();
+		RegMem(0xB7, RAX, RAX, 0, ESC);
+		RegMem(0x89, RAX, EMU, layout.PC, OP16);
+		EmitExit(-1);
+		break;
+
+	default: // PHP, PLP, JSR, RTS, RTI, BRK, JMP ()
+		EmitHandler(opcode, Emu6502::EndsBlock(opcode));
+		break;
+	}
+}
+
+#else // other hosts run JitEngine as BlockEngine
+
+Jit::Jit(Emu6502* emu)
+{
+	this->emu = emu;
+	buffer = 0;
+	used = 0;
+	page = 0;
+	pc = 0;
+	next_pc = 0;
+	op_index = 0;
+	pending_cycles = 0;
+}
+
+Jit::~Jit()
+{
+}
+
+void Jit::Clear()
+{
+}
+
+Jit::Code Jit::Compile(ushort pc, const byte* page, const Emu6502::BlockOp* ops, int count)
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <stddef.h>
+#include <vector>
+
+// JitEngine translator: a hot decoded block becomes x86-64 code doing exactly what the block
+// engine would, with A, X, Y, NZ and C in host registers.  Translated code leaves early where
+// the block engine would end the block: a write that banked, quit, or rewrote a decoded opcode.
+// Operands are still read from the block's host page as executed, I/O and other unmapped pages
+// go through Memory read()/write(), and instructions not translated call their table handler.
+// Only x86-64 Linux is supported, elsewhere IsAvailable() is false and nothing is compiled.
+class Jit
+{
+public:
+	typedef void (*Code)(Emu6502* emu);
+
+	Jit(Emu6502* emu);
+	~Jit();
+
+	bool IsAvailable() { return buffer != 0; }
+	Code Compile(ushort pc, const byte* page, const Emu6502::BlockOp* ops, int count); // 0 if buffer is full
+	void Clear(); // forget all translations, caller forgets its Code pointers
+
+private:
+	// called from translated code
+	static byte ReadSlow(Emu6502* emu, ushort addr);
+	static void WriteSlow(Emu6502* emu, ushort addr, byte value);
+	static void Handler(Emu6502* emu, byte opcode);
+
+	// x86-64 encoding
+	void Byte(int value);
+	void Dword(int value);
+	void Qword(unsigned long long value);
+	void Prefix(int op, int flags, int reg, int index, int base);
+	void RegMem(int op, int reg, int base, int disp, int flags = 0);
+	void RegMemIndex(int op, int reg, int base, int index, int scale, int disp, int flags = 0);
+	void RegReg(int op, int reg, int rm, int flags = 0);
+	void AluImm(int ext, int rm, int imm);
+	void ShiftImm(int ext, int rm, int count);
+	void MovImm(int reg, const void* ptr);
+	void Call(const void* function);
+	size_t Jcc(int cond); // forward, returns fixup for Bind()
+	size_t Jmp();
+	void Bind(size_t fixup);
+
+	// 6502 translation
+	void EmitLoadRegs();
+	void EmitStoreRegs();
+	void EmitOperandPtr();
+	void EmitAddress(int mode, bool read);
+	void EmitValue(int mode);
+	void EmitRead();
+	void EmitWrite();
+	void EmitShift(int kind, int reg);
+	void EmitCompare(int reg);
+	void EmitBranch(byte opcode);
+	void EmitHandler(byte opcode, bool ends_block);
+	void EmitExit(int next_pc); // -1 if PC already stored
+	void EmitOp(byte opcode);
+
+	Emu6502* emu;
+	byte* buffer; // read and execute, writable only within Compile(), 0 if unsupported
+	size_t used;
+
+	// byte offsets of CPU state within Emu6502
+	struct Layout
+	{
+		int A, X, Y, S, NZ, V, D, I, C, PC, cycles, instructions, code_map, block_exit;
+	} layout;
+
+	// current translation
+	std::vector<byte> code;
+	std::vector<size_t> exits; // jumps to epilogue
+	const byte* page;
+	ushort pc; // of op being translated
+	ushort next_pc; // following it
+	int op_index;
+	unsigned pending_cycles; // base cycles of ops so far including this one, added to cycles at exit
+
+private:
+	Jit(const Jit& other); // disabled
+	bool operator==(const Jit& other) const; // disabled
+};
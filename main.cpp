@@ -32,16 +32,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "emuc64.h"
-#include "emuc128.h"
-#include "emuted.h"
-#include "emuvic20.h"
-#include "emupet.h"
+#include "emucbm.h"
 #include "emutest.h"
 #include "emumin.h"
+#include "tracer.h"
+#include "profiler.h"
+#include "callgraph.h"
+#include "basicprofiler.h"
 #include <string.h>
-
-int main_go_num = 0;
+#include <algorithm>
+#include <vector>
 
 int fileExists(const char* filename)
 {
@@ -65,10 +65,104 @@ int main(int argc, char* argv[])
 	fprintf(stderr, "MIT License\n");
 	fprintf(stderr, "github.com/davervw\n");
 	fprintf(stderr, "\n");
+
+	// state carried from machine to machine, each emulator instance has its own copy while running
+	int main_go_num = 0;
+	const char* startup_prg = 0;
+	void* disk = 0;
+	Tracer* tracer = 0; // -trace file, binary trace of all machines run
+	FILE* profile_fp = 0; // -profile file, report appended as each machine exits
+	FILE* callgraph_fp = 0; // -callgraph file, collapsed stacks appended as each machine exits
+	FILE* basic_fp = 0; // -basicprofile file, report appended as each BASIC program ends
+	std::vector<ushort> breakpoints; // -break addr, hits logged to stderr
+	std::vector<ushort> write_watches; // -watch addr
+	std::vector<ushort> read_watches; // -watchread addr
+	bool blocks = false; // -blocks, BlockEngine for every machine
+	bool jit = false; // -jit, JitEngine for every machine
+	bool rom = false; // -rom, RomEngine for every machine
+
+	EmuCBM::BootSnapshots = true; // GO to a machine already booted this session restores it at READY
+
 	for (int i = 1; i < argc; ++i)
 	{
-		if (fileExists(argv[i]))
-			EmuCBM::StartupPRG = argv[i];
+		if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+		{
+			delete tracer;
+			tracer = new Tracer(argv[++i]);
+			if (!tracer->IsOpen())
+				return 1;
+		}
+		else if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc)
+		{
+			if (profile_fp != 0)
+				fclose(profile_fp);
+#ifdef WINDOWS
+			fopen_s(&profile_fp, argv[++i], "w");
+#else
+			profile_fp = fopen(argv[++i], "w");
+#endif
+			if (profile_fp == 0)
+			{
+				fprintf(stderr, "unable to write profile %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-callgraph") == 0 && i + 1 < argc)
+		{
+			if (callgraph_fp != 0)
+				fclose(callgraph_fp);
+#ifdef WINDOWS
+			fopen_s(&callgraph_fp, argv[++i], "w");
+#else
+			callgraph_fp = fopen(argv[++i], "w");
+#endif
+			if (callgraph_fp == 0)
+			{
+				fprintf(stderr, "unable to write call graph %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-basicprofile") == 0 && i + 1 < argc)
+		{
+			if (basic_fp != 0)
+				fclose(basic_fp);
+#ifdef WINDOWS
+			fopen_s(&basic_fp, argv[++i], "w");
+#else
+			basic_fp = fopen(argv[++i], "w");
+#endif
+			if (basic_fp == 0)
+			{
+				fprintf(stderr, "unable to write BASIC profile %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-break") == 0 && i + 1 < argc)
+			breakpoints.push_back((ushort)strtoul(argv[++i], 0, 16));
+		else if (strcmp(argv[i], "-watch") == 0 && i + 1 < argc)
+			write_watches.push_back((ushort)strtoul(argv[++i], 0, 16));
+		else if (strcmp(argv[i], "-watchread") == 0 && i + 1 < argc)
+			read_watches.push_back((ushort)strtoul(argv[++i], 0, 16));
+		else if (strcmp(argv[i], "-blocks") == 0)
+			blocks = true;
+		else if (strcmp(argv[i], "-jit") == 0)
+			jit = true;
+		else if (strcmp(argv[i], "-rom") == 0)
+			rom = true;
+		else if (strcmp(argv[i], "-fastfloat") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastFloat;
+		else if (strcmp(argv[i], "-fastchrget") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastChrget;
+		else if (strcmp(argv[i], "-faststrings") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastStrings;
+		else if (strcmp(argv[i], "-fastkernal") == 0)
+			EmuCBM::DefaultFastPaths |= EmuCBM::FastKernal;
+		else if (strcmp(argv[i], "-verifyfast") == 0)
+			EmuCBM::DefaultVerifyFastPaths = true;
+		else if (strcmp(argv[i], "-decode") == 0 && i + 1 < argc)
+			return Tracer::Decode(argv[++i], stdout) ? 0 : 1; // trace to text, no emulation
+		else if (fileExists(argv[i]))
+			startup_prg = argv[i];
 		else
 			main_go_num = atoi(argv[i]);
 	}
@@ -76,43 +170,107 @@ int main(int argc, char* argv[])
 	while (true)
 	{
 		Emu6502* emu;
+		EmuCBM* cbm = 0;
 
-		if (main_go_num == 128)
-			emu = new EmuC128();
-		else if (main_go_num == 4)
-			emu = new EmuTed(64);
-		else if (main_go_num == 16)
-			emu = new EmuTed(16);
-		else if (main_go_num == 20)
-			emu = new EmuVic20(5);
-		else if (main_go_num == 2001)
-			emu = new EmuPET(32);
-		else if (main_go_num == -1)
-			emu = new EmuTest(EmuCBM::StartupPRG);
+		if (main_go_num == -1)
+			emu = new EmuTest(startup_prg);
+		else if (main_go_num == -2)
+			emu = new EmuTest(startup_prg, Emu6502::SwitchEngine); // reference engine, compare speed with -1
+		else if (main_go_num == -3)
+			emu = new EmuBankTest(); // C64 banking benchmark
 		else if (main_go_num == 1)
 		{
 			char buffer[256];
-			bool unknown_filename = (EmuCBM::StartupPRG == 0 || *EmuCBM::StartupPRG == 0);
+			bool unknown_filename = (startup_prg == 0 || *startup_prg == 0);
 			if (unknown_filename)
 			{
 				puts("Minimum ROM Filename? ");
-				EmuCBM::StartupPRG = fgets(buffer, sizeof(buffer), stdin);
+				startup_prg = fgets(buffer, sizeof(buffer), stdin);
 				auto len = strlen(buffer);
 				if (len > 0 && buffer[len - 1] == '\n')
 					buffer[len - 1] = 0;
 			}
 
-			emu = new EmuMinimum(EmuCBM::StartupPRG, 0xFFF8, false);
+			emu = new EmuMinimum(startup_prg, 0xFFF8, false);
 		}
 		else
-			emu = new EmuC64(64 * 1024);
+			emu = cbm = EmuCBM::Create(main_go_num);
+
+		emu->go_num = main_go_num;
+		if (blocks && main_go_num != -2)
+			emu->SetEngine(Emu6502::BlockEngine);
+		if (jit && main_go_num != -2)
+			emu->SetEngine(Emu6502::JitEngine);
+		if (rom && main_go_num != -2)
+			emu->SetEngine(Emu6502::RomEngine);
+		if (tracer != 0)
+		{
+			emu->tracer = tracer;
+			emu->trace = true;
+		}
+		Profiler* profiler = (profile_fp != 0) ? new Profiler() : 0;
+		emu->profiler = profiler;
+		CallGraph* call_graph = (callgraph_fp != 0) ? new CallGraph() : 0;
+		emu->call_graph = call_graph;
+		BasicProfiler* basic_profiler = (basic_fp != 0 && cbm != 0 && cbm->GetBasicLineAddress() >= 0) ? new BasicProfiler((ushort)cbm->GetBasicLineAddress(), basic_fp) : 0;
+		emu->basic_profiler = basic_profiler;
+		for (size_t i = 0; i < breakpoints.size(); ++i)
+			emu->SetBreakpoint(breakpoints[i]);
+		for (size_t i = 0; i < write_watches.size(); ++i)
+			emu->SetWatchpoint(write_watches[i], false, true);
+		for (size_t i = 0; i < read_watches.size(); ++i)
+			emu->SetWatchpoint(read_watches[i], true, std::find(write_watches.begin(), write_watches.end(), read_watches[i]) != write_watches.end());
+		if (cbm != 0)
+		{
+			cbm->StartupPRG = startup_prg;
+			cbm->disk = disk;
+		}
 
 		emu->ResetRun();
+
+		if (profiler != 0)
+		{
+			fprintf(profile_fp, "machine %d\n", main_go_num);
+			profiler->Report(profile_fp, emu);
+			fprintf(profile_fp, "\n");
+			if (call_graph != 0)
+			{
+				call_graph->Report(profile_fp, emu);
+				fprintf(profile_fp, "\n");
+			}
+			fflush(profile_fp);
+			delete profiler;
+		}
+		if (basic_profiler != 0)
+		{
+			basic_profiler->ProgramEnded(); // program that ran GO
+			delete basic_profiler;
+		}
+		if (call_graph != 0)
+		{
+			call_graph->WriteCollapsed(callgraph_fp, emu);
+			fflush(callgraph_fp);
+			delete call_graph;
+		}
+
+		main_go_num = emu->go_num;
+		if (cbm != 0)
+		{
+			startup_prg = cbm->StartupPRG;
+			disk = cbm->disk;
+		}
 		delete emu;
 
-		if (main_go_num == -1)
+		if (main_go_num == -1 || main_go_num == -2 || main_go_num == -3)
 			break;
 	}
 
+	delete tracer; // flushes
+	if (profile_fp != 0)
+		fclose(profile_fp);
+	if (callgraph_fp != 0)
+		fclose(callgraph_fp);
+	if (basic_fp != 0)
+		fclose(basic_fp);
 	return 0;
 }
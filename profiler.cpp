@@ -0,0 +1,137 @@
+// profiler.cpp - Per-address execution profile and hotspot report
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+static const int address_count = 0x10000;
+static const int range_gap = 4; // unexecuted bytes allowed inside a range, more than an instruction's operands
+
+Profiler::Profiler()
+{
+	pc_instructions = new unsigned long long[address_count];
+	pc_cycles = new unsigned long long[address_count];
+	Clear();
+}
+
+Profiler::~Profiler()
+{
+	delete[] pc_instructions;
+	delete[] pc_cycles;
+}
+
+void Profiler::Stop(unsigned long long cycles)
+{
+	if (pending)
+		pc_cycles[last_pc] += cycles - last_cycles;
+	pending = false;
+}
+
+void Profiler::Clear()
+{
+	memset(pc_instructions, 0, address_count * sizeof(pc_instructions[0]));
+	memset(pc_cycles, 0, address_count * sizeof(pc_cycles[0]));
+	last_pc = 0;
+	last_cycles = 0;
+	pending = false;
+}
+
+struct ProfileRange
+{
+	int start;
+	int end; // inclusive
+	unsigned long long instructions;
+	unsigned long long cycles;
+};
+
+static const char* RegionName(Emu6502* emu, int addr)
+{
+	const char* name = emu->GetRegionName((ushort)addr);
+	return (name != 0) ? name : "";
+}
+
+void Profiler::Report(FILE* out, Emu6502* emu, int top)
+{
+	unsigned long long total_instructions = 0;
+	unsigned long long total_cycles = 0;
+	std::vector<int> hot;
+	for (int addr = 0; addr < address_count; ++addr)
+	{
+		if (pc_instructions[addr] == 0)
+			continue;
+		hot.push_back(addr);
+		total_instructions += pc_instructions[addr];
+		total_cycles += pc_cycles[addr];
+	}
+	double percent = (total_cycles > 0) ? 100.0 / total_cycles : 0;
+
+	fprintf(out, "profile: %llu instructions, %llu cycles, %u addresses\n", total_instructions, total_cycles, (unsigned)hot.size());
+
+	std::sort(hot.begin(), hot.end(), [this](int a, int b) { return pc_cycles[a] > pc_cycles[b] || (pc_cycles[a] == pc_cycles[b] && a < b); });
+	fprintf(out, "\nhot addresses:\n");
+	fprintf(out, "cycles%%       cycles instructions region  address\n");
+	for (int i = 0; i < (int)hot.size() && i < top; ++i)
+	{
+		int addr = hot[i];
+		bool conditional;
+		byte bytes;
+		ushort addr2;
+		char dis[13];
+		emu->DisassembleShort((ushort)addr, &conditional, &bytes, &addr2, dis, sizeof(dis));
+		fprintf(out, "%6.2f %12llu %12llu %-7s %04X %s\n", pc_cycles[addr] * percent, pc_cycles[addr], pc_instructions[addr], RegionName(emu, addr), addr, dis);
+	}
+
+	// runs of executed addresses, split at gaps and region boundaries
+	std::vector<ProfileRange> ranges;
+	for (int addr = 0; addr < address_count; ++addr)
+	{
+		if (pc_instructions[addr] == 0)
+			continue;
+		if (ranges.empty() || addr - ranges.back().end > range_gap || strcmp(RegionName(emu, addr), RegionName(emu, ranges.back().start)) != 0)
+		{
+			ProfileRange range = { addr, addr, 0, 0 };
+			ranges.push_back(range);
+		}
+		ProfileRange& range = ranges.back();
+		range.end = addr;
+		range.instructions += pc_instructions[addr];
+		range.cycles += pc_cycles[addr];
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](const ProfileRange& a, const ProfileRange& b) { return a.cycles > b.cycles || (a.cycles == b.cycles && a.start < b.start); });
+	fprintf(out, "\nhot ranges:\n");
+	fprintf(out, "cycles%%       cycles instructions region  range\n");
+	for (int i = 0; i < (int)ranges.size() && i < top; ++i)
+	{
+		const ProfileRange& range = ranges[i];
+		fprintf(out, "%6.2f %12llu %12llu %-7s %04X-%04X\n", range.cycles * percent, range.cycles, range.instructions, RegionName(emu, range.start), range.start, range.end);
+	}
+}
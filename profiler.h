@@ -0,0 +1,41 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <stdio.h>
+
+// Exact per-address execution profile: instructions and cycles counted for every PC.
+// Attaching a Profiler puts the CPU on its per-instruction slow path, like tracing,
+// so there is no cost when none is attached.
+class Profiler
+{
+public:
+	Profiler();
+	~Profiler();
+
+	inline void Count(ushort pc, unsigned long long cycles) // before each instruction
+	{
+		if (pending)
+			pc_cycles[last_pc] += cycles - last_cycles; // previous instruction, with page crossing and branch penalties
+		++pc_instructions[pc];
+		last_pc = pc;
+		last_cycles = cycles;
+		pending = true;
+	}
+	void Stop(unsigned long long cycles); // end of run, completes last instruction
+	void Clear();
+
+	// top hot addresses and hot address ranges by cycles, disassembled with emu's current memory map
+	void Report(FILE* out, Emu6502* emu, int top = 25);
+
+private:
+	unsigned long long* pc_instructions; // 64K entries
+	unsigned long long* pc_cycles; // 64K entries
+	ushort last_pc;
+	unsigned long long last_cycles;
+	bool pending; // last_pc executed, cycles not yet counted
+
+private:
+	Profiler(const Profiler& other); // disabled
+	bool operator==(const Profiler& other) const; // disabled
+};
@@ -0,0 +1,72 @@
+// romcode.cpp - RomCode - ROM blocks translated ahead of time by romxlate
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "romcode.h"
+
+#include <string.h>
+
+// generated by romxlate, see README.md, otherwise nothing is translated
+#if defined(__has_include)
+#if __has_include("romcode.inc")
+#include "romcode.inc"
+#define ROMCODE_INCLUDED
+#endif
+#endif
+
+#ifndef ROMCODE_INCLUDED
+static const byte rom_bytes[1] = { 0 };
+static const RomCode::Entry rom_entries[1] = { { 0, 0, 0, 0, 0 } };
+static const int rom_entry_count = 0;
+#endif
+
+// entries are sorted by pc, several may share one when machines' ROMs differ
+RomCode::Code RomCode::Find(ushort pc, const byte* page, int count)
+{
+	int low = 0;
+	int high = rom_entry_count;
+	while (low < high)
+	{
+		int mid = (low + high) / 2;
+		if (rom_entries[mid].pc < pc)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	for (int i = low; i < rom_entry_count && rom_entries[i].pc == pc; ++i)
+	{
+		const Entry& entry = rom_entries[i];
+		if (entry.count == count && memcmp(&page[pc & 0xFF], &rom_bytes[entry.offset], entry.length) == 0)
+			return entry.code;
+	}
+	return 0;
+}
+
+int RomCode::GetCount()
+{
+	return rom_entry_count;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "emu6502.h"
+
+// RomEngine blocks translated ahead of time: romxlate walks the ROMs of each machine and writes
+// romcode.inc, a C++ function per decoded block, compiled in by romcode.cpp when present.
+// A block runs translated only if it decodes at run time exactly as translated, same address,
+// same bytes and the same instruction count, so a trap set since (ExecutePatch() must see it)
+// or different ROMs fall back to the block engine.  Each function does exactly what the block
+// engine would, including leaving early where the block engine would end the block.
+class RomCode
+{
+public:
+	typedef void (*Code)(Emu6502* emu);
+
+	struct Entry
+	{
+		ushort pc;
+		byte count; // instructions
+		byte length; // bytes, all in pc's page
+		unsigned offset; // of bytes in rom_bytes
+		Code code;
+	};
+
+	static Code Find(ushort pc, const byte* page, int count); // 0 if not translated
+	static int GetCount(); // translated blocks compiled in
+
+	// generated code works on CPU state through these, counters are added once at exit
+	static inline byte Read(Emu6502* e, ushort addr) { return e->GetMemory(addr); }
+	static inline bool Write(Emu6502* e, ushort addr, byte value) // true if block ends here
+	{
+		e->SetMemory(addr, value);
+		return e->block_exit;
+	}
+	static inline void Exit(Emu6502* e, ushort pc, unsigned cycles, unsigned instructions)
+	{
+		e->PC = pc;
+		e->cycles += cycles;
+		e->instructions += instructions;
+	}
+	static inline void Handler(Emu6502* e, ushort pc, byte opcode, unsigned cycles, unsigned instructions) // ends block
+	{
+		Exit(e, pc, cycles, instructions);
+		(e->*Emu6502::op_table[opcode])();
+	}
+
+	// effective addresses, as the table engine computes them
+	static inline ushort ZPX(Emu6502* e, byte zp) { return (byte)(zp + e->X); }
+	static inline ushort ZPY(Emu6502* e, byte zp) { return (byte)(zp + e->Y); }
+	static inline ushort ABSX(Emu6502* e, ushort addr) { return (ushort)(addr + e->X); }
+	static inline ushort ABSY(Emu6502* e, ushort addr) { return (ushort)(addr + e->Y); }
+	static inline ushort IndX(Emu6502* e, byte zp)
+	{
+		byte zpaddr = (byte)(zp + e->X);
+		return (ushort)(e->GetMemory(zpaddr) | (e->GetMemory((byte)(zpaddr + 1)) << 8));
+	}
+	static inline ushort IndY(Emu6502* e, byte zp) { return (ushort)((e->GetMemory(zp) | (e->GetMemory((ushort)(zp + 1)) << 8)) + e->Y); }
+
+	// reads with page crossing penalty
+	static inline byte ReadIndexed(Emu6502* e, ushort addr, byte index)
+	{
+		ushort addr2 = (ushort)(addr + index);
+		if ((addr ^ addr2) & 0xFF00)
+			++e->cycles;
+		return e->GetMemory(addr2);
+	}
+	static inline byte ReadABSX(Emu6502* e, ushort addr) { return ReadIndexed(e, addr, e->X); }
+	static inline byte ReadABSY(Emu6502* e, ushort addr) { return ReadIndexed(e, addr, e->Y); }
+	static inline byte ReadIndY(Emu6502* e, byte zp) { return ReadIndexed(e, (ushort)(e->GetMemory(zp) | (e->GetMemory((ushort)(zp + 1)) << 8)), e->Y); }
+
+	static inline void LDA(Emu6502* e, byte value) { e->SetA(value); }
+	static inline void LDX(Emu6502* e, byte value) { e->SetX(value); }
+	static inline void LDY(Emu6502* e, byte value) { e->SetY(value); }
+	static inline bool STA(Emu6502* e, ushort addr) { return Write(e, addr, e->A); }
+	static inline bool STX(Emu6502* e, ushort addr) { return Write(e, addr, e->X); }
+	static inline bool STY(Emu6502* e, ushort addr) { return Write(e, addr, e->Y); }
+	static inline void ORA(Emu6502* e, byte value) { e->ORA(value); }
+	static inline void AND(Emu6502* e, byte value) { e->AND(value); }
+	static inline void EOR(Emu6502* e, byte value) { e->EOR(value); }
+	static inline void ADC(Emu6502* e, byte value) { e->ADC(value); }
+	static inline void SBC(Emu6502* e, byte value) { e->SBC(value); }
+	static inline void CMP(Emu6502* e, byte value) { e->CMP(value); }
+	static inline void CPX(Emu6502* e, byte value) { e->CPX(value); }
+	static inline void CPY(Emu6502* e, byte value) { e->CPY(value); }
+	static inline void BIT(Emu6502* e, byte value) { e->BIT(value); }
+
+	// read-modify-write, true if block ends here
+	static inline bool ASL(Emu6502* e, ushort addr) { return Write(e, addr, e->ASL(e->GetMemory(addr))); }
+	static inline bool LSR(Emu6502* e, ushort addr) { return Write(e, addr, e->LSR(e->GetMemory(addr))); }
+	static inline bool ROL(Emu6502* e, ushort addr) { return Write(e, addr, e->ROL(e->GetMemory(addr))); }
+	static inline bool ROR(Emu6502* e, ushort addr) { return Write(e, addr, e->ROR(e->GetMemory(addr))); }
+	static inline bool INC(Emu6502* e, ushort addr) { return Write(e, addr, e->INC(e->GetMemory(addr))); }
+	static inline bool DEC(Emu6502* e, ushort addr) { return Write(e, addr, e->DEC(e->GetMemory(addr))); }
+	static inline void ASLA(Emu6502* e) { e->SetA(e->ASL(e->A)); }
+	static inline void LSRA(Emu6502* e) { e->SetA(e->LSR(e->A)); }
+	static inline void ROLA(Emu6502* e) { e->SetA(e->ROL(e->A)); }
+	static inline void RORA(Emu6502* e) { e->SetA(e->ROR(e->A)); }
+
+	static inline void INX(Emu6502* e) { e->INX(); }
+	static inline void INY(Emu6502* e) { e->INY(); }
+	static inline void DEX(Emu6502* e) { e->DEX(); }
+	static inline void DEY(Emu6502* e) { e->DEY(); }
+	static inline void TAX(Emu6502* e) { e->TAX(); }
+	static inline void TXA(Emu6502* e) { e->TXA(); }
+	static inline void TAY(Emu6502* e) { e->TAY(); }
+	static inline void TYA(Emu6502* e) { e->TYA(); }
+	static inline void TSX(Emu6502* e) { e->TSX(); }
+	static inline void TXS(Emu6502* e) { e->TXS(); }
+	static inline void CLC(Emu6502* e) { e->CLC(); }
+	static inline void SEC(Emu6502* e) { e->SEC(); }
+	static inline void CLI(Emu6502* e) { e->CLI(); }
+	static inline void SEI(Emu6502* e) { e->SEI(); }
+	static inline void CLD(Emu6502* e) { e->CLD(); }
+	static inline void SED(Emu6502* e) { e->SED(); }
+	static inline void CLV(Emu6502* e) { e->CLV(); }
+	static inline bool PHA(Emu6502* e) { e->PHA(); return e->block_exit; }
+	static inline bool PHP(Emu6502* e) { e->PHP(); return e->block_exit; }
+	static inline void PLA(Emu6502* e) { e->PLA(); }
+	static inline void PLP(Emu6502* e) { e->PLP(); }
+
+	// branch conditions
+	static inline bool N(Emu6502* e) { return e->GetN(); }
+	static inline bool Z(Emu6502* e) { return e->GetZ(); }
+	static inline bool C(Emu6502* e) { return e->C; }
+	static inline bool V(Emu6502* e) { return e->V; }
+
+private:
+	RomCode(); // disabled
+	RomCode(const RomCode& other); // disabled
+	bool operator==(const RomCode& other) const; // disabled
+};
@@ -0,0 +1,458 @@
+// romxlate.cpp - RomTranslator - ahead of time translation of ROMs to C++
+//
+// writes romcode.inc for RomEngine, see romcode.h
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// c-simple-emu-cbm (C++ Portable Version)
+// C64/6502 Emulator for Microsoft Windows Console
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+
+
+#include "emucbm.h"
+
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Walks the code reachable in a machine's read only pages and translates each block to a C++
+// function.  Blocks are decoded exactly as Emu6502::DecodeBlock() would with the machine's
+// traps, so they end before any address ExecutePatch() must see.  Code is found from the 6502
+// vectors, runs of JMP instructions (jump tables), runs of words pointing into ROM (address
+// tables, including the address - 1 ones dispatched by RTS) and trapped addresses, then
+// followed through branches, jumps and subroutine calls.  Anything missed just isn't translated.
+class RomTranslator
+{
+public:
+	RomTranslator();
+
+	void Translate(Emu6502* emu, const char* machine); // adds blocks reachable in emu's ROMs
+	bool Write(const char* filename);
+
+private:
+	struct Block
+	{
+		ushort pc;
+		std::vector<byte> bytes;
+		int count;
+		std::string machines;
+		std::string source;
+	};
+
+	bool IsRom(ushort addr);
+	bool IsCode(ushort addr);
+	ushort Word(ushort addr);
+	void AddRoots(std::vector<ushort>& roots);
+	void TranslateBlock(ushort pc, const char* machine, std::vector<ushort>& next);
+	std::string Value(int mode, byte lo, byte hi);
+	std::string Address(int mode, byte lo, byte hi);
+	std::string Op(ushort addr, int index, unsigned cycles);
+
+	Emu6502* emu;
+	std::map<std::pair<ushort, std::vector<byte> >, Block> blocks; // by address and bytes, shared by machines with same ROM
+
+private:
+	RomTranslator(const RomTranslator& other); // disabled
+	bool operator==(const RomTranslator& other) const; // disabled
+};
+
+// operand addressing, as Jit
+enum { ModeIM, ModeZP, ModeZPX, ModeZPY, ModeABS, ModeABSX, ModeABSY, ModeIndX, ModeIndY };
+
+static int AddressMode(byte opcode)
+{
+	static const int group_one[8] = { ModeIndX, ModeZP, ModeIM, ModeABS, ModeIndY, ModeZPX, ModeABSY, ModeABSX };
+	static const int others[8] = { ModeIM, ModeZP, ModeIM, ModeABS, ModeIM, ModeZPX, ModeIM, ModeABSX };
+	int bbb = (opcode >> 2) & 7;
+	if ((opcode & 3) == 1)
+		return group_one[bbb];
+	if (opcode == 0x96 || opcode == 0xB6) // STX/LDX zp,Y
+		return ModeZPY;
+	if (opcode == 0xBE) // LDX abs,Y
+		return ModeABSY;
+	return others[bbb];
+}
+
+static std::string Format(const char* format, int a = 0, int b = 0, int c = 0, int d = 0)
+{
+	char buffer[256];
+	snprintf(buffer, sizeof(buffer), format, a, b, c, d);
+	return buffer;
+}
+
+RomTranslator::RomTranslator()
+{
+	emu = 0;
+}
+
+// machine's ROM, also mapped for the fast path so DecodeBlock() would decode there
+bool RomTranslator::IsRom(ushort addr)
+{
+	return emu->memory->IsRomPage((byte)(addr >> 8)) && emu->memory->read_pages[addr >> 8] != 0;
+}
+
+bool RomTranslator::IsCode(ushort addr)
+{
+	return IsRom(addr) && Emu6502::op_table[emu->GetMemory(addr)] != &Emu6502::OpInvalid;
+}
+
+ushort RomTranslator::Word(ushort addr)
+{
+	return (ushort)(emu->GetMemory(addr) | (emu->GetMemory((ushort)(addr + 1)) << 8));
+}
+
+void RomTranslator::AddRoots(std::vector<ushort>& roots)
+{
+	for (int vector = 0xFFFA; vector < 0x10000; vector += 2) // NMI, RESET, IRQ/BRK
+		roots.push_back(Word((ushort)vector));
+	for (int addr = 0; addr < 0x10000; ++addr)
+	{
+		if (!IsRom((ushort)addr))
+			continue;
+		if (Emu6502::TestBit(emu->trap_map, (ushort)addr))
+			roots.push_back((ushort)addr); // runs on when ExecutePatch() declines
+
+		int jumps = 0;
+		while (jumps < 256 && IsRom((ushort)(addr + jumps * 3)) && emu->GetMemory((ushort)(addr + jumps * 3)) == 0x4C && IsCode(Word((ushort)(addr + jumps * 3 + 1))))
+			++jumps;
+		if (jumps >= 3) // jump table, e.g. KERNAL's
+			for (int i = 0; i < jumps; ++i)
+				roots.push_back((ushort)(addr + i * 3));
+
+		int words = 0;
+		while (words < 256 && IsRom((ushort)(addr + words * 2 + 1)) && IsCode((ushort)(Word((ushort)(addr + words * 2)) + 1)))
+			++words;
+		if (words >= 6) // address table, e.g. BASIC statements, or vectors copied to RAM
+		{
+			for (int i = 0; i < words; ++i)
+			{
+				ushort target = Word((ushort)(addr + i * 2));
+				roots.push_back(target);
+				roots.push_back((ushort)(target + 1));
+			}
+		}
+	}
+}
+
+void RomTranslator::Translate(Emu6502* emu, const char* machine)
+{
+	this->emu = emu;
+	if (!IsCode(Word(0xFFFC)))
+	{
+		fprintf(stderr, "%s: no ROM at reset vector, skipped\n", machine);
+		return;
+	}
+	size_t before = blocks.size();
+
+	std::vector<ushort> work;
+	AddRoots(work);
+	std::vector<bool> seen(0x10000);
+	while (!work.empty())
+	{
+		ushort pc = work.back();
+		work.pop_back();
+		if (seen[pc] || !IsCode(pc))
+			continue;
+		seen[pc] = true;
+		TranslateBlock(pc, machine, work);
+	}
+
+	fprintf(stderr, "%s: %d blocks\n", machine, (int)(blocks.size() - before));
+}
+
+// decode as DecodeBlock(), add successors to next, then translate unless operands cross into next page
+void RomTranslator::TranslateBlock(ushort pc, const char* machine, std::vector<ushort>& next)
+{
+	std::vector<ushort> addrs;
+	ushort addr = pc;
+	while ((int)addrs.size() < Emu6502::max_block_ops)
+	{
+		byte opcode = emu->GetMemory(addr);
+		if (Emu6502::op_table[opcode] == &Emu6502::OpInvalid)
+			break;
+		addrs.push_back(addr);
+		if (Emu6502::EndsBlock(opcode))
+			break;
+		addr = (ushort)(addr + Emu6502::InstructionLength(opcode));
+		if ((addr >> 8) != (pc >> 8) || Emu6502::TestBit(emu->trap_map, addr))
+			break;
+	}
+	if (addrs.empty())
+		return;
+
+	ushort last = addrs.back();
+	byte opcode = emu->GetMemory(last);
+	int length = (last - pc) + Emu6502::InstructionLength(opcode);
+	if ((opcode & 0x1F) == 0x10) // branch
+	{
+		next.push_back((ushort)(last + 2 + (sbyte)emu->GetMemory((ushort)(last + 1))));
+		next.push_back((ushort)(last + 2));
+	}
+	else if (opcode == 0x4C) // JMP
+		next.push_back(Word((ushort)(last + 1)));
+	else if (opcode == 0x20) // JSR, and where it returns
+	{
+		next.push_back(Word((ushort)(last + 1)));
+		next.push_back((ushort)(last + 3));
+	}
+	else if (opcode == 0x6C) // JMP (ind), through a ROM vector
+	{
+		ushort vector = Word((ushort)(last + 1));
+		if (IsRom(vector) && IsRom((ushort)((vector & 0xFF00) | ((vector + 1) & 0xFF))))
+			next.push_back((ushort)(emu->GetMemory(vector) | (emu->GetMemory((ushort)((vector & 0xFF00) | ((vector + 1) & 0xFF))) << 8)));
+	}
+	else if (!Emu6502::EndsBlock(opcode))
+		next.push_back(addr); // page end, trap, or longest block
+
+	if ((pc & 0xFF) + length > 0x100)
+		return; // operands on next page, may be mapped elsewhere
+
+	Block block;
+	block.pc = pc;
+	for (int i = 0; i < length; ++i)
+		block.bytes.push_back(emu->GetMemory((ushort)(pc + i)));
+	std::pair<ushort, std::vector<byte> > key(pc, block.bytes);
+	std::map<std::pair<ushort, std::vector<byte> >, Block>::iterator found = blocks.find(key);
+	if (found != blocks.end())
+	{
+		found->second.machines += std::string(" ") + machine;
+		return;
+	}
+	block.count = (int)addrs.size();
+	block.machines = machine;
+
+	unsigned cycles = 0;
+	for (int i = 0; i < block.count; ++i)
+	{
+		cycles += Emu6502::cycle_table[emu->GetMemory(addrs[i])];
+		block.source += Op(addrs[i], i, cycles);
+	}
+	if (!Emu6502::EndsBlock(opcode))
+		block.source += Format("\tRomCode::Exit(e, 0x%04X, %u, %d);\n", addr, cycles, block.count);
+	blocks[key] = block;
+}
+
+// operand value of a read instruction, with page crossing penalty where the table engine has one
+std::string RomTranslator::Value(int mode, byte lo, byte hi)
+{
+	switch (mode)
+	{
+	case ModeIM: return Format("0x%02X", lo);
+	case ModeABSX: return Format("RomCode::ReadABSX(e, 0x%04X)", lo | (hi << 8));
+	case ModeABSY: return Format("RomCode::ReadABSY(e, 0x%04X)", lo | (hi << 8));
+	case ModeIndY: return Format("RomCode::ReadIndY(e, 0x%02X)", lo);
+	default: return "RomCode::Read(e, " + Address(mode, lo, hi) + ")";
+	}
+}
+
+std::string RomTranslator::Address(int mode, byte lo, byte hi)
+{
+	switch (mode)
+	{
+	case ModeZP: return Format("0x%04X", lo);
+	case ModeZPX: return Format("RomCode::ZPX(e, 0x%02X)", lo);
+	case ModeZPY: return Format("RomCode::ZPY(e, 0x%02X)", lo);
+	case ModeABS: return Format("0x%04X", lo | (hi << 8));
+	case ModeABSX: return Format("RomCode::ABSX(e, 0x%04X)", lo | (hi << 8));
+	case ModeABSY: return Format("RomCode::ABSY(e, 0x%04X)", lo | (hi << 8));
+	case ModeIndX: return Format("RomCode::IndX(e, 0x%02X)", lo);
+	case ModeIndY: return Format("RomCode::IndY(e, 0x%02X)", lo);
+	default: return "?";
+	}
+}
+
+// C++ for instruction at addr, index'th of block, cycles of block so far including this one
+std::string RomTranslator::Op(ushort addr, int index, unsigned cycles)
+{
+	static const char* const group_one[8] = { "ORA", "AND", "EOR", "ADC", "STA", "LDA", "CMP", "SBC" };
+	static const char* const group_two[8] = { "ASL", "ROL", "LSR", "ROR", "STX", "LDX", "DEC", "INC" };
+	static const char* const branches[4] = { "N", "V", "C", "Z" };
+
+	byte opcode = emu->GetMemory(addr);
+	byte lo = emu->GetMemory((ushort)(addr + 1));
+	byte hi = emu->GetMemory((ushort)(addr + 2));
+	ushort next_pc = (ushort)(addr + Emu6502::InstructionLength(opcode));
+	int mode = AddressMode(opcode);
+	int aaa = opcode >> 5;
+	int bbb = (opcode >> 2) & 7;
+	int cc = opcode & 3;
+
+	bool conditional;
+	byte bytes;
+	ushort addr2;
+	char dis[13];
+	emu->DisassembleShort(addr, &conditional, &bytes, &addr2, dis, sizeof(dis));
+	std::string source = Format("\t// %04X ", addr) + dis + "\n";
+	std::string exit = Format(" { RomCode::Exit(e, 0x%04X, %u, %d); return; }\n", next_pc, cycles, index + 1);
+
+	if ((opcode & 0x1F) == 0x10)
+	{
+		ushort target = (ushort)(addr + 2 + (sbyte)lo);
+		bool if_set = (opcode & 0x20) != 0;
+		source += std::string("\tif (") + (if_set ? "" : "!") + "RomCode::" + branches[opcode >> 6] + "(e))";
+		source += Format(" { RomCode::Exit(e, 0x%04X, %u, %d); return; }\n", target, cycles + ((((addr + 2) ^ target) & 0xFF00) ? 2 : 1), index + 1);
+		return source + Format("\tRomCode::Exit(e, 0x%04X, %u, %d);\n", next_pc, cycles, index + 1);
+	}
+	switch (opcode)
+	{
+	case 0x4C: return source + Format("\tRomCode::Exit(e, 0x%04X, %u, %d);\n", lo | (hi << 8), cycles, index + 1);
+	case 0x00: case 0x20: case 0x40: case 0x60: case 0x6C: // BRK, JSR, RTI, RTS, JMP (ind)
+		return source + Format("\tRomCode::Handler(e, 0x%04X, 0x%02X, %u, %d);\n", addr, opcode, cycles, index + 1);
+	case 0x08: return source + "\tif (RomCode::PHP(e))" + exit;
+	case 0x48: return source + "\tif (RomCode::PHA(e))" + exit;
+	case 0x28: return source + "\tRomCode::PLP(e);\n";
+	case 0x68: return source + "\tRomCode::PLA(e);\n";
+	case 0x18: return source + "\tRomCode::CLC(e);\n";
+	case 0x38: return source + "\tRomCode::SEC(e);\n";
+	case 0x58: return source + "\tRomCode::CLI(e);\n";
+	case 0x78: return source + "\tRomCode::SEI(e);\n";
+	case 0xB8: return source + "\tRomCode::CLV(e);\n";
+	case 0xD8: return source + "\tRomCode::CLD(e);\n";
+	case 0xF8: return source + "\tRomCode::SED(e);\n";
+	case 0x88: return source + "\tRomCode::DEY(e);\n";
+	case 0xC8: return source + "\tRomCode::INY(e);\n";
+	case 0xCA: return source + "\tRomCode::DEX(e);\n";
+	case 0xE8: return source + "\tRomCode::INX(e);\n";
+	case 0x98: return source + "\tRomCode::TYA(e);\n";
+	case 0xA8: return source + "\tRomCode::TAY(e);\n";
+	case 0x8A: return source + "\tRomCode::TXA(e);\n";
+	case 0xAA: return source + "\tRomCode::TAX(e);\n";
+	case 0x9A: return source + "\tRomCode::TXS(e);\n";
+	case 0xBA: return source + "\tRomCode::TSX(e);\n";
+	case 0xEA: return source;
+	case 0x0A: return source + "\tRomCode::ASLA(e);\n";
+	case 0x2A: return source + "\tRomCode::ROLA(e);\n";
+	case 0x4A: return source + "\tRomCode::LSRA(e);\n";
+	case 0x6A: return source + "\tRomCode::RORA(e);\n";
+	case 0x24: case 0x2C: return source + "\tRomCode::BIT(e, " + Value(mode, lo, hi) + ");\n";
+	case 0x84: case 0x8C: case 0x94: return source + "\tif (RomCode::STY(e, " + Address(mode, lo, hi) + "))" + exit;
+	case 0xA0: case 0xA4: case 0xAC: case 0xB4: case 0xBC: return source + "\tRomCode::LDY(e, " + Value(mode, lo, hi) + ");\n";
+	case 0xC0: case 0xC4: case 0xCC: return source + "\tRomCode::CPY(e, " + Value(mode, lo, hi) + ");\n";
+	case 0xE0: case 0xE4: case 0xEC: return source + "\tRomCode::CPX(e, " + Value(mode, lo, hi) + ");\n";
+	}
+	if (cc == 1 && aaa == 4) // STA
+		return source + "\tif (RomCode::STA(e, " + Address(mode, lo, hi) + "))" + exit;
+	if (cc == 1)
+		return source + "\tRomCode::" + group_one[aaa] + "(e, " + Value(mode, lo, hi) + ");\n";
+	if (cc == 2 && aaa == 5) // LDX
+		return source + "\tRomCode::LDX(e, " + Value(mode, lo, hi) + ");\n";
+	if (cc == 2 && bbb != 2 && bbb != 6) // STX, or read-modify-write
+		return source + "\tif (RomCode::" + group_two[aaa] + "(e, " + Address(mode, lo, hi) + "))" + exit;
+	return source + Format("\tRomCode::Handler(e, 0x%04X, 0x%02X, %u, %d);\n", addr, opcode, cycles, index + 1); // not reached, valid opcodes are all above
+}
+
+bool RomTranslator::Write(const char* filename)
+{
+#ifdef WINDOWS
+	FILE* fp;
+	fopen_s(&fp, filename, "w");
+#else
+	FILE* fp = fopen(filename, "w");
+#endif
+	if (fp == 0)
+	{
+		fprintf(stderr, "unable to write %s\n", filename);
+		return false;
+	}
+	fprintf(fp, "// romcode.inc - generated by romxlate, do not edit\n");
+	fprintf(fp, "// ROM blocks translated ahead of time for RomEngine, see romcode.h\n\n");
+
+	int index = 0;
+	std::vector<std::string> names;
+	for (std::map<std::pair<ushort, std::vector<byte> >, Block>::iterator i = blocks.begin(); i != blocks.end(); ++i, ++index)
+	{
+		names.push_back(Format("rom_%04X_%d", i->second.pc, index));
+		fprintf(fp, "// %s\n", i->second.machines.c_str());
+		fprintf(fp, "static void %s(Emu6502* e)\n{\n%s}\n\n", names.back().c_str(), i->second.source.c_str());
+	}
+
+	fprintf(fp, "static const byte rom_bytes[] =\n{\n");
+	unsigned offset = 0;
+	for (std::map<std::pair<ushort, std::vector<byte> >, Block>::iterator i = blocks.begin(); i != blocks.end(); ++i)
+	{
+		fprintf(fp, "\t");
+		for (size_t j = 0; j < i->second.bytes.size(); ++j)
+			fprintf(fp, "0x%02X, ", i->second.bytes[j]);
+		fprintf(fp, "\n");
+	}
+	fprintf(fp, "\t0\n};\n\n");
+
+	fprintf(fp, "static const RomCode::Entry rom_entries[] =\n{\n");
+	index = 0;
+	for (std::map<std::pair<ushort, std::vector<byte> >, Block>::iterator i = blocks.begin(); i != blocks.end(); ++i, ++index)
+	{
+		fprintf(fp, "\t{ 0x%04X, %d, %d, %u, %s },\n", i->second.pc, i->second.count, (int)i->second.bytes.size(), offset, names[index].c_str());
+		offset += (unsigned)i->second.bytes.size();
+	}
+	fprintf(fp, "\t{ 0, 0, 0, 0, 0 }\n};\n\n");
+	fprintf(fp, "static const int rom_entry_count = %d;\n", index);
+
+	bool ok = (fclose(fp) == 0);
+	fprintf(stderr, "%d blocks written to %s\n", index, filename);
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s output [machine...]\n", argv[0]);
+		fprintf(stderr, "  output   C++ to compile into romcode.cpp, normally romcode.inc\n");
+		fprintf(stderr, "  machine  64, 128, 4, 16, 20, or 2001, default all with ROMs, read from roms/ as when running\n");
+		return 1;
+	}
+
+	// machine and a ROM it can't start without, 16 has the same ROMs as 4
+	static const int all[] = { 64, 128, 4, 20, 2001 };
+	static const char* const all_roms[] = { "roms/c64/kernal", "roms/c128/kernal", "roms/ted/kernal", "roms/vic20/kernal", "roms/pet/kernal1" };
+	std::vector<int> machines;
+	for (int i = 2; i < argc; ++i)
+		machines.push_back(atoi(argv[i]));
+	for (int i = 0; argc == 2 && i < (int)(sizeof(all) / sizeof(all[0])); ++i)
+	{
+#ifdef WINDOWS
+		FILE* fp;
+		fopen_s(&fp, all_roms[i], "rb");
+#else
+		FILE* fp = fopen(all_roms[i], "rb");
+#endif
+		if (fp != 0)
+		{
+			fclose(fp);
+			machines.push_back(all[i]);
+		}
+		else
+			fprintf(stderr, "%d: no %s, skipped\n", all[i], all_roms[i]);
+	}
+
+	RomTranslator translator;
+	for (size_t i = 0; i < machines.size(); ++i)
+	{
+		EmuCBM* cbm = EmuCBM::Create(machines[i]);
+		char name[16];
+		snprintf(name, sizeof(name), "%d", machines[i]);
+		translator.Translate(cbm, name);
+		delete cbm;
+	}
+	return translator.Write(argv[1]) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+// tracer.cpp - Binary instruction trace
+//
+// Ring buffer drained to file by a background thread, and offline decoder to text
+//
+// MIT License
+//
+// Copyright (c) 2024 by David R. Van Wagner
+// davevw.com
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include "tracer.h"
+
+#include <chrono>
+#include <string.h>
+
+static const char trace_magic[8] = { 'T', 'R', 'C', '6', '5', '0', '2', '1' };
+
+Tracer::Tracer(const char* filename, int buffer_records)
+{
+	capacity = 1;
+	while (capacity < (size_t)buffer_records)
+		capacity <<= 1;
+	records = new TraceRecord[capacity];
+	head = 0;
+	tail = 0;
+	stopping = false;
+
+#ifdef WINDOWS
+	fopen_s(&fp, filename, "wb");
+#else
+	fp = fopen(filename, "wb");
+#endif
+	if (fp == 0)
+	{
+		fprintf(stderr, "unable to write trace %s\n", filename);
+		return;
+	}
+	unsigned record_size = (unsigned)sizeof(TraceRecord); // decoder checks layout matches
+	fwrite(trace_magic, 1, sizeof(trace_magic), fp);
+	fwrite(&record_size, sizeof(record_size), 1, fp);
+	writer = std::thread(&Tracer::Drain, this);
+}
+
+Tracer::~Tracer()
+{
+	if (fp != 0)
+	{
+		stopping.store(true, std::memory_order_release);
+		writer.join();
+		fclose(fp);
+	}
+	delete[] records;
+}
+
+void Tracer::Drain()
+{
+	while (true)
+	{
+		bool stop = stopping.load(std::memory_order_acquire); // before head, so nothing written after is missed
+		size_t first = tail.load(std::memory_order_relaxed);
+		size_t last = head.load(std::memory_order_acquire);
+		if (first == last)
+		{
+			if (stop)
+				return;
+			fflush(fp); // caught up, so little is lost if process is killed
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		size_t start = first & (capacity - 1);
+		size_t count = last - first;
+		if (start + count > capacity)
+			count = capacity - start; // up to wrap, rest next time around
+		fwrite(&records[start], sizeof(TraceRecord), count, fp);
+		tail.store(first + count, std::memory_order_release);
+	}
+}
+
+// just enough machine to run the disassembler over bytes from the trace
+class TraceDecoder : public Emu6502
+{
+public:
+	class TraceMemory : public Emu6502::Memory
+	{
+	public:
+		TraceMemory() { memset(ram, 0, sizeof(ram)); }
+		virtual byte read(ushort addr) { return ram[addr]; }
+		virtual void write(ushort addr, byte value) { ram[addr] = value; }
+
+	private:
+		byte ram[0x10000];
+	};
+
+	TraceDecoder() : Emu6502(new TraceMemory()) {}
+
+	void Line(const TraceRecord& record, char* text, int text_size)
+	{
+		for (int i = 0; i < 3; ++i)
+			memory->write((ushort)(record.pc + i), record.bytes[i]);
+		A = record.a;
+		X = record.x;
+		Y = record.y;
+		S = record.s;
+		SetP(record.p);
+
+		bool conditional;
+		byte bytes;
+		ushort addr2;
+		char line[27];
+		char dis[13];
+		DisassembleLong(record.pc, &conditional, &bytes, &addr2, dis, sizeof(dis), line, sizeof(line));
+		char state[33];
+		GetDisplayState(state, sizeof(state));
+		snprintf(text, text_size, "%-30s%s %llu\n", line, state, record.cycles);
+	}
+
+protected:
+	virtual bool ExecutePatch() { return false; }
+};
+
+bool Tracer::Decode(const char* filename, FILE* out)
+{
+#ifdef WINDOWS
+	FILE* in;
+	fopen_s(&in, filename, "rb");
+#else
+	FILE* in = fopen(filename, "rb");
+#endif
+	if (in == 0)
+	{
+		fprintf(stderr, "unable to read trace %s\n", filename);
+		return false;
+	}
+
+	char magic[sizeof(trace_magic)];
+	unsigned record_size;
+	if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, trace_magic, sizeof(magic)) != 0
+		|| fread(&record_size, sizeof(record_size), 1, in) != 1 || record_size != sizeof(TraceRecord))
+	{
+		fprintf(stderr, "%s is not a trace from this build\n", filename);
+		fclose(in);
+		return false;
+	}
+
+	TraceDecoder decoder;
+	TraceRecord chunk[4096];
+	size_t count;
+	while ((count = fread(chunk, sizeof(TraceRecord), sizeof(chunk) / sizeof(chunk[0]), in)) > 0)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			char text[96];
+			decoder.Line(chunk[i], text, sizeof(text));
+			fputs(text, out);
+		}
+	}
+	fclose(in);
+	return true;
+}
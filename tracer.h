@@ -0,0 +1,58 @@
+#pragma once
+
+#include "emu6502.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+// one executed instruction, captured before it runs
+struct TraceRecord
+{
+	unsigned long long cycles;
+	ushort pc;
+	byte bytes[3]; // opcode and operands as read at PC, unused bytes included
+	byte a;
+	byte x;
+	byte y;
+	byte s;
+	byte p; // NV-BDIZC
+};
+
+// Binary instruction trace: the emulator thread appends records to a lock-free
+// single producer ring buffer, a background thread drains it to a file.
+// Records are never dropped, the producer waits if the writer falls behind.
+class Tracer
+{
+public:
+	Tracer(const char* filename, int buffer_records = 1 << 20); // rounded up to power of 2
+	~Tracer(); // drains remaining records and closes file
+	bool IsOpen() { return fp != 0; }
+
+	inline void Record(const TraceRecord& record)
+	{
+		size_t next = head.load(std::memory_order_relaxed);
+		while (next - tail.load(std::memory_order_acquire) >= capacity)
+			std::this_thread::yield(); // full
+		records[next & (capacity - 1)] = record;
+		head.store(next + 1, std::memory_order_release);
+	}
+
+	// trace file to text, same columns as text tracing, plus cycles
+	static bool Decode(const char* filename, FILE* out);
+
+private:
+	void Drain();
+
+	FILE* fp;
+	TraceRecord* records;
+	size_t capacity;
+	alignas(64) std::atomic<size_t> head; // next record to write, only producer stores
+	alignas(64) std::atomic<size_t> tail; // next record to drain, only writer stores
+	std::atomic<bool> stopping;
+	std::thread writer;
+
+private:
+	Tracer(const Tracer& other); // disabled
+	bool operator==(const Tracer& other) const; // disabled
+};